@@ -0,0 +1,381 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	bandwidth.c - Token buckets pacing the file data the server sends
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		bandwidth_init (struct bandwidth *bw, long long egress_rate, long long client_rate);
+--					bandwidth_join (struct bandwidth *bw, struct in_addr addr);
+--					bandwidth_leave (struct bandwidth *bw, struct client_share *share);
+--					bandwidth_allowance (struct bandwidth *bw, struct client_share *share, long long want, int *wait_ms);
+--					bandwidth_charge (struct bandwidth *bw, struct client_share *share, long long bytes);
+--					bandwidth_limited (const struct bandwidth *bw);
+--					bucket_init (struct token_bucket *bucket, long long rate, long long now);
+--					bucket_refill (struct token_bucket *bucket, long long now);
+--					bucket_wait (const struct token_bucket *bucket, long long want);
+--					addr_hash (struct in_addr addr);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The buckets are described in bandwidth.h. Without any rate the allowance and charge
+-- calls return at once, without taking the lock, so only joining and leaving cost
+-- anything.
+---------------------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "bandwidth.h"
+#include "connect_retry.h"
+
+#define TRUE	1
+#define FALSE	0
+
+void bucket_init (struct token_bucket *bucket, long long rate, long long now);
+void bucket_refill (struct token_bucket *bucket, long long now);
+int bucket_wait (const struct token_bucket *bucket, long long want);
+unsigned int addr_hash (struct in_addr addr);
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bandwidth_init
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void bandwidth_init (struct bandwidth *bw, long long egress_rate, long long client_rate)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sets up an empty table of shares. egress_rate caps the bytes a second sent to all
+ * clients together and client_rate those sent to each; 0 leaves either unlimited.
+ * -----------------------------------------------------------------------*/
+void bandwidth_init (struct bandwidth *bw, long long egress_rate, long long client_rate)
+{
+	memset(bw, 0, sizeof(*bw));
+	pthread_mutex_init(&bw->lock, NULL);
+	bucket_init(&bw->egress, egress_rate, now_ns());
+	bw->client_rate = client_rate;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bandwidth_join
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      struct client_share *bandwidth_join (struct bandwidth *bw, struct in_addr addr)
+ *
+ * RETURNS:        struct client_share * - the client's share, NULL if out of memory
+ *
+ * NOTES:
+ * Counts a transfer starting to send to a client, and returns the client's share until
+ * the transfer leaves it with bandwidth_leave. Idle shares met on the way whose buckets
+ * have filled up are freed.
+ * -----------------------------------------------------------------------*/
+struct client_share *bandwidth_join (struct bandwidth *bw, struct in_addr addr)
+{
+	struct client_share	**link, *share;
+	long long			now = now_ns();
+
+	pthread_mutex_lock(&bw->lock);
+	link = &bw->shares[addr_hash(addr) & (BANDWIDTH_BUCKETS - 1)];
+	while ((share = *link) != NULL)
+	{
+		if (share->addr.s_addr == addr.s_addr)
+		{
+			break;
+		}
+		if (share->transfers == 0)
+		{
+			bucket_refill(&share->bucket, now);
+			if (share->bucket.tokens >= share->bucket.burst)
+			{
+				*link = share->next;
+				free(share);
+				continue;
+			}
+		}
+		link = &share->next;
+	}
+	if (share == NULL && (share = calloc(1, sizeof(*share))) != NULL)
+	{
+		share->addr = addr;
+		bucket_init(&share->bucket, bw->client_rate, now);
+		share->next = *link;
+		*link = share;
+	}
+	if (share != NULL)
+	{
+		share->transfers++;
+	}
+	pthread_mutex_unlock(&bw->lock);
+	return share;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bandwidth_leave
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void bandwidth_leave (struct bandwidth *bw, struct client_share *share)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Ends a transfer's use of its client's share. A share without a bucket goes with its
+ * last transfer; one with a bucket waits for a later join to find it full.
+ * -----------------------------------------------------------------------*/
+void bandwidth_leave (struct bandwidth *bw, struct client_share *share)
+{
+	struct client_share	**link;
+
+	pthread_mutex_lock(&bw->lock);
+	if (--share->transfers == 0 && share->bucket.rate == 0)
+	{
+		for (link = &bw->shares[addr_hash(share->addr) & (BANDWIDTH_BUCKETS - 1)]; *link != share; link = &(*link)->next)
+		{
+		}
+		*link = share->next;
+		free(share);
+	}
+	pthread_mutex_unlock(&bw->lock);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bandwidth_allowance
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      long long bandwidth_allowance (struct bandwidth *bw, struct client_share *share,
+ *                                                long long want, int *wait_ms)
+ *
+ * RETURNS:        long long - bytes that may be sent now, at most want; 0 if none
+ *
+ * NOTES:
+ * Refills the egress bucket and the client's, and allows as many of want bytes as the
+ * emptier one holds. Rather than trickle out a few bytes at a time, a sender is allowed
+ * nothing until BANDWIDTH_MIN_SEND tokens (or want, if less) are there; *wait_ms is then
+ * set to how long that takes. A NULL share is only held to the egress rate.
+ * -----------------------------------------------------------------------*/
+long long bandwidth_allowance (struct bandwidth *bw, struct client_share *share, long long want, int *wait_ms)
+{
+	long long	now, allowed = want, least = want < BANDWIDTH_MIN_SEND ? want : BANDWIDTH_MIN_SEND;
+	int			wait;
+
+	*wait_ms = 0;
+	if (bw->egress.rate == 0 && (share == NULL || share->bucket.rate == 0))
+	{
+		return want;
+	}
+	now = now_ns();
+	pthread_mutex_lock(&bw->lock);
+	if (bw->egress.rate > 0)
+	{
+		bucket_refill(&bw->egress, now);
+		allowed = bw->egress.tokens < allowed ? (long long)bw->egress.tokens : allowed;
+		*wait_ms = bucket_wait(&bw->egress, least);
+	}
+	if (share != NULL && share->bucket.rate > 0)
+	{
+		bucket_refill(&share->bucket, now);
+		allowed = share->bucket.tokens < allowed ? (long long)share->bucket.tokens : allowed;
+		wait = bucket_wait(&share->bucket, least);
+		*wait_ms = wait > *wait_ms ? wait : *wait_ms;
+	}
+	pthread_mutex_unlock(&bw->lock);
+	return allowed < least ? 0 : allowed;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bandwidth_charge
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void bandwidth_charge (struct bandwidth *bw, struct client_share *share, long long bytes)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Takes bytes just sent out of the buckets they count against
+ * -----------------------------------------------------------------------*/
+void bandwidth_charge (struct bandwidth *bw, struct client_share *share, long long bytes)
+{
+	if (bw->egress.rate == 0 && (share == NULL || share->bucket.rate == 0))
+	{
+		return;
+	}
+	pthread_mutex_lock(&bw->lock);
+	bw->egress.tokens -= bw->egress.rate > 0 ? bytes : 0;
+	if (share != NULL && share->bucket.rate > 0)
+	{
+		share->bucket.tokens -= bytes;
+	}
+	pthread_mutex_unlock(&bw->lock);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bandwidth_limited
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int bandwidth_limited (const struct bandwidth *bw)
+ *
+ * RETURNS:        int - TRUE if either rate is set
+ *
+ * NOTES:
+ * The rates never change after bandwidth_init, so no lock is needed
+ * -----------------------------------------------------------------------*/
+int bandwidth_limited (const struct bandwidth *bw)
+{
+	return bw->egress.rate > 0 || bw->client_rate > 0 ? TRUE : FALSE;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bucket_init
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void bucket_init (struct token_bucket *bucket, long long rate, long long now)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sets up a full bucket of rate bytes a second, or an unlimited one for rate 0
+ * -----------------------------------------------------------------------*/
+void bucket_init (struct token_bucket *bucket, long long rate, long long now)
+{
+	bucket->rate = rate;
+	bucket->burst = rate / (1000 / BANDWIDTH_BURST_MS);
+	bucket->burst = bucket->burst < BANDWIDTH_MIN_BURST ? BANDWIDTH_MIN_BURST : bucket->burst;
+	bucket->tokens = bucket->burst;
+	bucket->last = now;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bucket_refill
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void bucket_refill (struct token_bucket *bucket, long long now)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Adds the tokens earned since the last refill, up to the bucket's burst
+ * -----------------------------------------------------------------------*/
+void bucket_refill (struct token_bucket *bucket, long long now)
+{
+	if (now > bucket->last)
+	{
+		bucket->tokens += (double)(now - bucket->last) * bucket->rate / 1000000000.0;
+		bucket->tokens = bucket->tokens > bucket->burst ? bucket->burst : bucket->tokens;
+		bucket->last = now;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bucket_wait
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int bucket_wait (const struct token_bucket *bucket, long long want)
+ *
+ * RETURNS:        int - milliseconds until the bucket holds want tokens, 0 if it does now
+ *
+ * NOTES:
+ * Rounds up, so a sender woken after the wait finds the tokens there
+ * -----------------------------------------------------------------------*/
+int bucket_wait (const struct token_bucket *bucket, long long want)
+{
+	double missing = want - bucket->tokens;
+
+	if (missing <= 0)
+	{
+		return 0;
+	}
+	return (int)(missing * 1000.0 / bucket->rate) + 1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       addr_hash
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      unsigned int addr_hash (struct in_addr addr)
+ *
+ * RETURNS:        unsigned int - hash of a client's address
+ *
+ * NOTES:
+ * Multiplicative hash; the high bits are folded down since the table uses the low ones
+ * -----------------------------------------------------------------------*/
+unsigned int addr_hash (struct in_addr addr)
+{
+	unsigned int hash = addr.s_addr * 2654435761u;
+
+	return hash ^ (hash >> 16);
+}
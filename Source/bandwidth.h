@@ -0,0 +1,78 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	bandwidth.h - Token buckets pacing the file data the server sends
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		bandwidth_init (struct bandwidth *bw, long long egress_rate, long long client_rate);
+--					bandwidth_join (struct bandwidth *bw, struct in_addr addr);
+--					bandwidth_leave (struct bandwidth *bw, struct client_share *share);
+--					bandwidth_allowance (struct bandwidth *bw, struct client_share *share, long long want, int *wait_ms);
+--					bandwidth_charge (struct bandwidth *bw, struct client_share *share, long long bytes);
+--					bandwidth_limited (const struct bandwidth *bw);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- Every client address sending transfers has a share, which counts its transfers so the
+-- server can divide a client's turn among them. With a client rate the share also holds a
+-- token bucket filling at that many bytes a second; with an egress rate one more bucket is
+-- shared by all clients. A sender asks for its allowance (the tokens in the emptier of
+-- the buckets that apply), sends at most that much and is charged for what went out; a
+-- bucket may go into debt when several threads send at once, which later waits pay back.
+-- Each bucket holds at most BANDWIDTH_BURST_MS worth of its rate, so an idle client can't
+-- save up more than that.
+--
+-- A share outlives its last transfer until its bucket has filled up again, so a client
+-- can't get a fresh bucket by reconnecting. The table is shared by all worker threads.
+---------------------------------------------------------------------------------------*/
+#ifndef BANDWIDTH_H
+#define BANDWIDTH_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <netinet/in.h>
+
+#define BANDWIDTH_BUCKETS		256		// Must be a power of two
+#define BANDWIDTH_BURST_MS		100		// Most of its rate a bucket saves up
+#define BANDWIDTH_MIN_BURST		(64 * 1024)
+#define BANDWIDTH_MIN_SEND		(16 * 1024)	// Tokens a throttled sender waits for
+
+struct token_bucket
+{
+	long long	rate;			// Bytes a second; 0 for no limit
+	long long	burst;			// Most tokens the bucket holds
+	double		tokens;			// Negative while in debt
+	long long	last;			// now_ns() of the last refill
+};
+
+struct client_share
+{
+	struct in_addr		addr;
+	_Atomic int			transfers;		// Transfers of the client sending now
+	struct token_bucket	bucket;
+	struct client_share	*next;
+};
+
+struct bandwidth
+{
+	pthread_mutex_t		lock;
+	struct token_bucket	egress;			// Shared by every client
+	long long			client_rate;	// Rate of each client's bucket; 0 for no limit
+	struct client_share	*shares[BANDWIDTH_BUCKETS];
+};
+
+void bandwidth_init (struct bandwidth *bw, long long egress_rate, long long client_rate);
+struct client_share *bandwidth_join (struct bandwidth *bw, struct in_addr addr);
+void bandwidth_leave (struct bandwidth *bw, struct client_share *share);
+long long bandwidth_allowance (struct bandwidth *bw, struct client_share *share, long long want, int *wait_ms);
+void bandwidth_charge (struct bandwidth *bw, struct client_share *share, long long bytes);
+int bandwidth_limited (const struct bandwidth *bw);
+
+#endif
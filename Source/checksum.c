@@ -0,0 +1,358 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	checksum.c - CRC32C checksums of transferred data
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		crc32c (uint32_t crc, const void *data, size_t len);
+--					crc32c_setup (void);
+--					crc32c_table (uint32_t crc, const unsigned char *p, size_t len);
+--					crc32c_sse42 (uint32_t crc, const unsigned char *p, size_t len);
+--					crc32c_zeros (uint32_t zeros[][256], size_t len);
+--					crc32c_shift (uint32_t zeros[][256], uint32_t crc);
+--					gf2_matrix_times (const uint32_t *mat, uint32_t vec);
+--					gf2_matrix_square (uint32_t *square, const uint32_t *mat);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The implementation is picked once, on the first call, from what the processor supports.
+--
+-- One crc32 instruction can start every cycle but takes three to finish, so the SSE4.2
+-- version runs three CRCs over neighbouring stretches of the data at once and then merges
+-- them: shifting a CRC past n bytes is a linear operator, precomputed as tables for the
+-- two stretch lengths used.
+---------------------------------------------------------------------------------------*/
+#include <string.h>
+#include <pthread.h>
+
+#include "checksum.h"
+
+// Reflected Castagnoli polynomial
+#define CRC32C_POLY		0x82F63B78
+
+// Stretch lengths of the three-way SSE4.2 loop; both must be powers of two
+#define CRC32C_LONG		8192
+#define CRC32C_SHORT	256
+
+void crc32c_setup (void);
+uint32_t crc32c_table (uint32_t crc, const unsigned char *p, size_t len);
+#if defined(__x86_64__)
+uint32_t crc32c_sse42 (uint32_t crc, const unsigned char *p, size_t len);
+#endif
+void crc32c_zeros (uint32_t zeros[][256], size_t len);
+uint32_t crc32c_shift (uint32_t zeros[][256], uint32_t crc);
+uint32_t gf2_matrix_times (const uint32_t *mat, uint32_t vec);
+void gf2_matrix_square (uint32_t *square, const uint32_t *mat);
+
+pthread_once_t	crc32c_once = PTHREAD_ONCE_INIT;
+uint32_t		(*crc32c_impl) (uint32_t crc, const unsigned char *p, size_t len);
+uint32_t		crc32c_tables[8][256];
+uint32_t		crc32c_long[4][256];		// Shift past CRC32C_LONG zero bytes
+uint32_t		crc32c_short[4][256];		// Shift past CRC32C_SHORT zero bytes
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       crc32c
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint32_t crc32c (uint32_t crc, const void *data, size_t len)
+ *
+ * RETURNS:        uint32_t - the CRC of everything passed so far
+ *
+ * NOTES:
+ * Extends crc, the CRC32C of the data before, with len more bytes; start with 0
+ * -----------------------------------------------------------------------*/
+uint32_t crc32c (uint32_t crc, const void *data, size_t len)
+{
+	pthread_once(&crc32c_once, crc32c_setup);
+	return crc32c_impl(crc, data, len);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       crc32c_setup
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void crc32c_setup (void)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Picks the implementation, building the lookup tables if it needs them
+ * -----------------------------------------------------------------------*/
+void crc32c_setup (void)
+{
+	uint32_t	c;
+	int			i, j;
+
+#if defined(__x86_64__)
+	if (__builtin_cpu_supports("sse4.2"))
+	{
+		crc32c_zeros(crc32c_long, CRC32C_LONG);
+		crc32c_zeros(crc32c_short, CRC32C_SHORT);
+		crc32c_impl = crc32c_sse42;
+		return;
+	}
+#endif
+	for (i = 0; i < 256; i++)
+	{
+		for (c = i, j = 0; j < 8; j++)
+		{
+			c = c & 1 ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+		}
+		crc32c_tables[0][i] = c;
+	}
+	for (i = 0; i < 256; i++)
+	{
+		for (j = 1; j < 8; j++)
+		{
+			crc32c_tables[j][i] = (crc32c_tables[j - 1][i] >> 8) ^ crc32c_tables[0][crc32c_tables[j - 1][i] & 0xFF];
+		}
+	}
+	crc32c_impl = crc32c_table;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       crc32c_table
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint32_t crc32c_table (uint32_t crc, const unsigned char *p, size_t len)
+ *
+ * RETURNS:        uint32_t
+ *
+ * NOTES:
+ * Portable CRC32C, eight bytes per step through eight tables
+ * -----------------------------------------------------------------------*/
+uint32_t crc32c_table (uint32_t crc, const unsigned char *p, size_t len)
+{
+	uint32_t	(*t)[256] = crc32c_tables;
+	uint32_t	lo, hi;
+
+	crc = ~crc;
+	for (; len >= 8; len -= 8, p += 8)
+	{
+		lo = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+		hi = (uint32_t)p[4] | (uint32_t)p[5] << 8 | (uint32_t)p[6] << 16 | (uint32_t)p[7] << 24;
+		crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+			t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+	}
+	for (; len > 0; len--, p++)
+	{
+		crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+	}
+	return ~crc;
+}
+
+#if defined(__x86_64__)
+/*--------------------------------------------------------------------------
+ * FUNCTION:       crc32c_sse42
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint32_t crc32c_sse42 (uint32_t crc, const unsigned char *p, size_t len)
+ *
+ * RETURNS:        uint32_t
+ *
+ * NOTES:
+ * CRC32C with the SSE4.2 crc32 instruction, eight bytes at a time and three streams at once
+ * -----------------------------------------------------------------------*/
+__attribute__((target("sse4.2")))
+uint32_t crc32c_sse42 (uint32_t crc, const unsigned char *p, size_t len)
+{
+	unsigned long long	c = ~crc & 0xFFFFFFFFu, c1, c2, word;
+	const unsigned char	*end;
+	size_t				stretch;
+
+	for (stretch = CRC32C_LONG; stretch >= CRC32C_SHORT; stretch = stretch == CRC32C_LONG ? CRC32C_SHORT : 0)
+	{
+		for (; len >= 3 * stretch; len -= 3 * stretch, p += 2 * stretch)
+		{
+			for (c1 = c2 = 0, end = p + stretch; p < end; p += 8)
+			{
+				memcpy(&word, p, 8);
+				c = __builtin_ia32_crc32di(c, word);
+				memcpy(&word, p + stretch, 8);
+				c1 = __builtin_ia32_crc32di(c1, word);
+				memcpy(&word, p + 2 * stretch, 8);
+				c2 = __builtin_ia32_crc32di(c2, word);
+			}
+			c = crc32c_shift(stretch == CRC32C_LONG ? crc32c_long : crc32c_short, c) ^ c1;
+			c = crc32c_shift(stretch == CRC32C_LONG ? crc32c_long : crc32c_short, c) ^ c2;
+		}
+	}
+	for (; len >= 8; len -= 8, p += 8)
+	{
+		memcpy(&word, p, 8);
+		c = __builtin_ia32_crc32di(c, word);
+	}
+	for (; len > 0; len--, p++)
+	{
+		c = __builtin_ia32_crc32qi((unsigned int)c, *p);
+	}
+	return ~(uint32_t)c;
+}
+#endif
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       crc32c_zeros
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void crc32c_zeros (uint32_t zeros[][256], size_t len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Builds the tables crc32c_shift uses to move a CRC (without its pre and post inversion)
+ * past len zero bytes; len must be a power of two
+ * -----------------------------------------------------------------------*/
+void crc32c_zeros (uint32_t zeros[][256], size_t len)
+{
+	uint32_t	odd[32], even[32], row;
+	int			n;
+
+	// Operator for one zero bit, then squared up to one zero byte
+	odd[0] = CRC32C_POLY;
+	for (n = 1, row = 1; n < 32; n++, row <<= 1)
+	{
+		odd[n] = row;
+	}
+	gf2_matrix_square(even, odd);
+	gf2_matrix_square(odd, even);
+	gf2_matrix_square(even, odd);
+
+	// Each squaring doubles the number of zero bytes
+	for (; len > 1; len >>= 1)
+	{
+		gf2_matrix_square(odd, even);
+		memcpy(even, odd, sizeof(even));
+	}
+	for (n = 0; n < 256; n++)
+	{
+		zeros[0][n] = gf2_matrix_times(even, n);
+		zeros[1][n] = gf2_matrix_times(even, n << 8);
+		zeros[2][n] = gf2_matrix_times(even, n << 16);
+		zeros[3][n] = gf2_matrix_times(even, (uint32_t)n << 24);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       crc32c_shift
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint32_t crc32c_shift (uint32_t zeros[][256], uint32_t crc)
+ *
+ * RETURNS:        uint32_t
+ *
+ * NOTES:
+ * Moves a CRC past the zero bytes zeros was built for
+ * -----------------------------------------------------------------------*/
+uint32_t crc32c_shift (uint32_t zeros[][256], uint32_t crc)
+{
+	return zeros[0][crc & 0xFF] ^ zeros[1][(crc >> 8) & 0xFF] ^ zeros[2][(crc >> 16) & 0xFF] ^ zeros[3][crc >> 24];
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       gf2_matrix_times
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint32_t gf2_matrix_times (const uint32_t *mat, uint32_t vec)
+ *
+ * RETURNS:        uint32_t
+ *
+ * NOTES:
+ * Multiplies a 32x32 matrix over GF(2), one column per word, by a vector
+ * -----------------------------------------------------------------------*/
+uint32_t gf2_matrix_times (const uint32_t *mat, uint32_t vec)
+{
+	uint32_t sum = 0;
+
+	for (; vec != 0; vec >>= 1, mat++)
+	{
+		if (vec & 1)
+		{
+			sum ^= *mat;
+		}
+	}
+	return sum;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       gf2_matrix_square
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void gf2_matrix_square (uint32_t *square, const uint32_t *mat)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Squares a 32x32 matrix over GF(2)
+ * -----------------------------------------------------------------------*/
+void gf2_matrix_square (uint32_t *square, const uint32_t *mat)
+{
+	int n;
+
+	for (n = 0; n < 32; n++)
+	{
+		square[n] = gf2_matrix_times(mat, mat[n]);
+	}
+}
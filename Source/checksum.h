@@ -0,0 +1,30 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	checksum.h - CRC32C checksums of transferred data
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		crc32c (uint32_t crc, const void *data, size_t len);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- CRC32C (Castagnoli) is computed with the SSE4.2 crc32 instruction on x86-64 processors
+-- that have it, at several GB/s, and with slicing-by-8 tables everywhere else. Both give
+-- the same result, so either side of a transfer may use either.
+---------------------------------------------------------------------------------------*/
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t crc32c (uint32_t crc, const void *data, size_t len);
+
+#endif
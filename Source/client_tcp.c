@@ -3,18 +3,69 @@
 --
 --	PROGRAM:		tclient
 --
---	FUNCTIONS:		init_client_control_channel (int *client_socket, int option, struct sockaddr_in client);
+--	FUNCTIONS:		init_client_control_channel (int *client_socket, int option);
 --					connect_to_server (int client_socket, struct sockaddr_in server, struct hostent *hp);
---					connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_entity_len);
 --					send_request (int client_socket, char *request, char *ack_request);
 --					init_client_data_channel (int *client_socket, int option, struct sockaddr_in *client, int client_len);
---					process_request (char *ack_request, int client_socket, struct sockaddr_in server, struct hostent *hp);
+--					process_request (char *ack_request, int option, struct sockaddr_in server, struct hostent *hp);
 --					send_file (FILE *fp, int sockfd);
---					write_file(int sockfd);
+--					write_file(int sockfd, const char *filename);
+--					process_mux_requests (struct sockaddr_in server, struct hostent *hp, char **requests, int count);
+--					send_data_frames (int sockfd, int fd, off_t offset, off_t len, struct compressor *compressor, uint32_t *crc);
+--					send_end (int sockfd, uint32_t crc);
+--					read_requests (FILE *fp, int *count);
+--					open_mux_session (struct sockaddr_in server, struct hostent *hp);
+--					parallel_transfer (struct sockaddr_in server, struct hostent *hp, char *command, int streams, off_t min_chunk);
+--					resume_transfer (struct mux_client *client, char *command);
+--					query_file_size (struct mux_client *client, char *command);
+--					recv_ack (int sockfd, struct request *ack);
+--					delta_send (int sockfd, char *command);
+--					send_copy (int sockfd, uint32_t index, uint32_t count);
+--					parse_size (const char *text);
+--					send_file_data (int fd, int sockfd, off_t offset, off_t len);
+--					write_all (int fd, const char *data, size_t len, off_t offset);
+--					run_bench (struct sockaddr_in server, struct hostent *hp, char **requests, int count, int clients, int seconds, long long operations);
+--					bench_client (void *arg);
+--					bench_operation (struct bench *bench, char *command);
+--					query_stats (struct sockaddr_in server, struct hostent *hp);
+--					send_frame (int sockfd, int type, int flags, const char *payload, uint32_t len);
+--					recv_frame (int sockfd, struct frame_header *header, char *payload, int payload_len);
+--					send_all (int sockfd, const char *data, size_t len);
+--					recv_all (int sockfd, char *data, size_t len);
+--					expand_command (const char *command);
+--					is_local_host (struct hostent *hp);
+--					local_transfer (char *request);
+--					copy_local_file (int from_fd, int to_fd);
+--					open_mux_client (struct mux_client *client, struct sockaddr_in *server);
+--					mux_command_done (struct mux_transfer *transfer, void *arg);
+--					fill_server_address (struct sockaddr_in *server, struct hostent *hp);
+--					wait_mux_clients (struct mux_client **clients, int count);
+--					transfer_failed (const struct mux_transfer *transfer, const char *request);
+--					range_done (struct mux_transfer *transfer, void *arg);
+--					receive_file_data (int sockfd, int fd);
 --
 --	DATE:			October 4, 2020
 --
---	REVISIONS:		N/A
+--	REVISIONS:		October 16, 2026 - Files are sent with sendfile(2)
+--					October 16, 2026 - Downloads are written byte-exact
+--					October 16, 2026 - Framed single-connection (MUX) protocol mode
+--					October 16, 2026 - Connects use bounded exponential backoff
+--					October 16, 2026 - Batches of commands pipelined over one session
+--					October 16, 2026 - Large files split into ranges moved over parallel streams
+--					October 16, 2026 - Interrupted transfers can be resumed
+--					October 16, 2026 - Optional compression of file data
+--					October 16, 2026 - Delta uploads
+--					October 16, 2026 - CRC32C-checked framed transfers
+--					October 16, 2026 - Load generator mode with latency histograms
+--					October 16, 2026 - STATS command
+--					October 16, 2026 - GET and SEND of named files
+--					October 16, 2026 - Uploads announce their size
+--					October 16, 2026 - Single transfers ask the server for a data port of their own
+--					October 16, 2026 - Single transfers to this machine go over the server's local socket
+--					October 16, 2026 - Legacy GETs are spliced from the socket to the file
+--					October 16, 2026 - Batches run on the non-blocking client library (mux_client.h)
+--					October 16, 2026 - Local socket found per user; the server's user is checked first
+--					October 16, 2026 - Parallel, resumed and load generator transfers run on the client library too
 
 --
 --	DESIGNERS:		Derek Wong
@@ -28,7 +79,74 @@
 -- send the server a request that will be echoed back.  Once the request 
 -- is confirmed, the client will open up a new TCP connection to the 
 -- server with their respective data channel sockets to get or send a file. 
+--
+-- With -m the client instead asks for a multiplexed (MUX) session: the request, its
+-- acknowledgement and the file all travel over the one control connection, framed
+-- as described in protocol.h, and no local ports are bound.
+--
+-- Several commands (or - to read them from stdin) always run as one multiplexed session.
+-- They are pipelined: all requests go out up front, SEND files included, and the replies
+-- are read back in order, so a batch pays for one connection and one round trip. The
+-- session is run by the client library in mux_client.c from a single poll loop; a GET's
+-- local file is only cut to the server's size once it has arrived, so a rejected GET
+-- leaves it as it was.
+--
+-- With -p N each GET or SEND is split into up to N byte ranges of at least -c bytes
+-- (16m by default), each moved over its own multiplexed session at the same time, so one
+-- connection's congestion window no longer limits a large transfer. Both ends read and
+-- write the ranges in place with positional I/O. One poll loop drives all the sessions.
+--
+-- With -r each GET or SEND resumes from the bytes the receiver already has instead of
+-- starting over: get.txt is appended to from its current size, and send.txt is sent from
+-- the size of the server's copy. The file already there is trusted to be a prefix of the
+-- one being transferred. Parallel transfers size their files up front, so -r can't resume them.
+--
+-- With -z level file data is compressed on the wire in both directions; blocks that don't
+-- compress are sent as they are. Like -r it needs a multiplexed session.
+--
+-- With -d a SEND only uploads what changed: the server signs the blocks of its copy of
+-- send.txt, and the client sends the blocks it finds there as references and only the
+-- rest as data (see delta.h).
+--
+-- Every multiplexed mode but -d runs on the client library, so there is one implementation
+-- of the framing, compression, CRCs and pipelining. Delta uploads stay on blocking sockets
+-- (send_frame, recv_frame): the client can only build its COPY and DATA frames after it has
+-- read the server's signatures, a dialogue in the middle of the transfer that the library's
+-- request-then-data pipeline doesn't have, and one upload at a time gains nothing from
+-- polling.
+--
+-- Framed transfers carry the CRC32C of their data (see protocol.h), which the receiving
+-- side checks; a mismatch fails the transfer. Files are then read through a buffer
+-- instead of sendfile, since the CRC needs the bytes; -n turns the check off.
+--
+-- With -b N the client becomes a load generator: N threads act as separate clients, each
+-- running operations back to back for -t seconds (10 by default), or until -o operations
+-- have run between them. Every operation picks one of the commands at random, so GET GET
+-- SEND is a two to one mix, and runs it over a new multiplexed session; the legacy mode's
+-- fixed client ports can't be shared by concurrent clients. The time each operation spends
+-- connecting, getting the MUX echo, getting its request acknowledged and moving the file is
+-- recorded in a histogram per phase (see histogram.h), and the run ends with a report of
+-- throughput and p50/p99/p99.9 latencies. GETs are written to /dev/null; SENDs upload
+-- their file. An operation whose connection fails counts as failed; errors the other
+-- modes exit on still end the run.
+--
+-- GET:name and SEND:name transfer the named file instead of get.txt or send.txt, under the
+-- same name at both ends: GET:name writes the server's file to name here, and SEND:name
+-- uploads name to the server's root directory (see protocol.h for the names allowed).
+--
+-- The STATS command asks the server for its counters and prints them as the server sends
+-- them, one "name value" line each (see protocol.h).
+--
+-- A single GET or SEND to a host that is this machine goes over the server's Unix domain
+-- socket instead of TCP (see protocol.h): the file is passed as a descriptor and copied
+-- from file to file in the kernel, so none of it crosses a socket. The socket is found as
+-- the server finds it, from $TSERVER_SOCKET or the user's runtime directory. A server without
+-- the socket, or running as another user, gets the transfer over TCP as usual, and -T always
+-- uses TCP.
+--
+-- Build: gcc -Wall -o tclient client_tcp.c mux_client.c protocol.c connect_retry.c compress.c delta.c checksum.c histogram.c -pthread
 ---------------------------------------------------------------------------------------*/
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,49 +155,165 @@
 #include <netdb.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <sys/mman.h>
 #include <errno.h>
 
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <ifaddrs.h>
+#include <poll.h>
 
-// Default ports
-#define SERVER_CONTROL_CHANNEL_PORT		7005
-#define CLIENT_CONTROL_CHANNEL_PORT		4611
-#define SERVER_DATA_CHANNEL_PORT		7006
-#define CLIENT_DATA_CHANNEL_PORT		4612
+#include "protocol.h"
+#include "connect_retry.h"
+#include "compress.h"
+#include "delta.h"
+#include "checksum.h"
+#include "histogram.h"
+#include "mux_client.h"
 
 // Buffer length
-#define REQ_BUFLEN			80
-#define FILE_BUFLEN			1024
+#define TRANSFER_BUFLEN		(256 * 1024)		// Socket/file copy buffer for transfers
+#define SENDFILE_CHUNK		(4 * 1024 * 1024)	// Most bytes handed to one sendfile call
+
+// Parallel transfers
+#define MAX_STREAMS			64
+#define DEFAULT_MIN_CHUNK	(16 * 1024 * 1024)	// Smallest range worth its own stream
 
-// Default strings
-#define GET_COMMAND_NAME		"GET"
-#define SEND_COMMAND_NAME		"SEND"
-#define SEND_FILE_NAME			"send.txt"
-#define GET_FILE_NAME			"get.txt"
+// Load generator
+#define MAX_BENCH_CLIENTS	1024
+#define DEFAULT_BENCH_SECS	10
+
+// Phases of a benchmark operation, each timed into its own histogram
+#define PHASE_CONNECT		0		// TCP connect to the control port
+#define PHASE_ACK			1		// MUX request echoed back
+#define PHASE_SETUP			2		// GET or SEND request acknowledged
+#define PHASE_TRANSFER		3		// File moved and, for a SEND, stored
+#define PHASE_TOTAL			4
+#define BENCH_PHASES		5
 
 #define TRUE					1
-#define NOT_CONNECTED			1
-#define DEFAULT_SLEEP_TIME		1
+#define FALSE					0
+
+#define USAGE		"Usage: %s [-m] [-r] [-d] [-n] [-T] [-z level] [-p streams] [-c min_chunk] [-b clients [-t seconds | -o operations]] host {GET,SEND}[:name]... | - | STATS\n"
+
+// One command of a batch, run as a transfer of the client library
+struct mux_command
+{
+	struct mux_transfer	transfer;
+	char				*request;
+	int					created;		// A GET's local file didn't exist before
+	int					*failed;		// Failures of the batch
+};
+
+// One byte range of a parallel transfer, moved over its own session
+struct range_transfer
+{
+	struct mux_client	client;
+	struct mux_transfer	transfer;
+	char				*command;
+	off_t				offset;
+	off_t				length;
+	int					failed;
+};
+
+// A load generator run, shared by its client threads
+struct bench
+{
+	struct sockaddr_in	server;
+	char				**requests;
+	int					count;
+	long long			deadline;		// now_ns() value the run stops at; 0 to stop after operations
+	long long			operations;
+	_Atomic long long	started;
+	_Atomic long long	completed;
+	_Atomic long long	failed;
+	_Atomic long long	bytes;			// File bytes moved by completed operations
+	struct histogram	phases[BENCH_PHASES];
+};
+
+// One client thread of a load generator run
+struct bench_client
+{
+	struct bench	*bench;
+	unsigned int	seed;
+};
 
 // Function prototypes
-void init_client_control_channel (int *client_socket, int option, struct sockaddr_in client);
+void init_client_control_channel (int *client_socket, int option);
 void connect_to_server (int client_socket, struct sockaddr_in server, struct hostent *hp);
-void connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_entity_len);
 void send_request (int client_socket, char *request, char *ack_request);
 void init_client_data_channel (int *client_socket, int option, struct sockaddr_in *client, int client_len);
-void process_request (char *ack_request, int client_socket, struct sockaddr_in server, struct hostent *hp);
+void process_request (char *ack_request, int option, struct sockaddr_in server, struct hostent *hp);
 void send_file (FILE *fp, int sockfd);
-void write_file(int sockfd);
+void write_file(int sockfd, const char *filename);
+int process_mux_requests (struct sockaddr_in server, struct hostent *hp, char **requests, int count);
+void send_data_frames (int sockfd, int fd, off_t offset, off_t len, struct compressor *compressor, uint32_t *crc);
+void send_end (int sockfd, uint32_t crc);
+char **read_requests (FILE *fp, int *count);
+int open_mux_session (struct sockaddr_in server, struct hostent *hp);
+int parallel_transfer (struct sockaddr_in server, struct hostent *hp, char *command, int streams, off_t min_chunk);
+int resume_transfer (struct mux_client *client, char *command);
+off_t query_file_size (struct mux_client *client, char *command);
+int recv_ack (int sockfd, struct request *ack);
+int delta_send (int sockfd, char *command);
+void send_copy (int sockfd, uint32_t index, uint32_t count);
+long long parse_size (const char *text);
+void send_file_data (int fd, int sockfd, off_t offset, off_t len);
+int write_all (int fd, const char *data, size_t len, off_t offset);
+int run_bench (struct sockaddr_in server, struct hostent *hp, char **requests, int count, int clients, int seconds, long long operations);
+void *bench_client (void *arg);
+int bench_operation (struct bench *bench, char *command);
+int query_stats (struct sockaddr_in server, struct hostent *hp);
+void send_frame (int sockfd, int type, int flags, const char *payload, uint32_t len);
+void recv_frame (int sockfd, struct frame_header *header, char *payload, int payload_len);
+void send_all (int sockfd, const char *data, size_t len);
+void recv_all (int sockfd, char *data, size_t len);
+char *expand_command (const char *command);
+int is_local_host (struct hostent *hp);
+int local_transfer (char *request);
+void copy_local_file (int from_fd, int to_fd);
+int open_mux_client (struct mux_client *client, struct sockaddr_in *server);
+void mux_command_done (struct mux_transfer *transfer, void *arg);
+void fill_server_address (struct sockaddr_in *server, struct hostent *hp);
+void wait_mux_clients (struct mux_client **clients, int count);
+int transfer_failed (const struct mux_transfer *transfer, const char *request);
+void range_done (struct mux_transfer *transfer, void *arg);
+int receive_file_data (int sockfd, int fd);
+
+// Compression level asked for with -z; 0 leaves file data uncompressed
+int compress_level = 0;
+
+// Framed transfers are checked with CRC32C trailers unless -n is given
+int use_crc = TRUE;
 
 /*--------------------------------------------------------------------------
  * FUNCTION:       main
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Added the -m multiplexed mode
+ *                 October 16th, 2026 - Takes a batch of commands from the arguments or stdin
+ *                 October 16th, 2026 - Added -p/-c parallel range transfers
+ *                 October 16th, 2026 - Added -r to resume interrupted transfers
+ *                 October 16th, 2026 - Added -z to compress file data
+ *                 October 16th, 2026 - Added -d for delta uploads
+ *                 October 16th, 2026 - Added -n to skip CRC checks
+ *                 October 16th, 2026 - Added -b/-t/-o load generator mode
+ *                 October 16th, 2026 - Added the STATS command
+ *                 October 16th, 2026 - Commands may name their file (GET:name, SEND:name)
+ *                 October 16th, 2026 - A legacy SEND announces the size of its file
+ *                 October 16th, 2026 - Asks the server for a data port for a single GET or SEND
+ *                 October 16th, 2026 - Added -T; transfers to this machine use the local socket otherwise
+ *                 October 16th, 2026 - Resumes transfers over a session of the client library
  *
  * DESIGNER:       Derek Wong
  *
@@ -94,16 +328,112 @@ void write_file(int sockfd);
  * -----------------------------------------------------------------------*/
 int main (int argc, char **argv)
 {
-	int 		client_socket = 0, option = 1;
+	int 		client_socket = 0, option = 1, mux_mode = FALSE, count = 0, failed, i;
+	int			streams = 1, resume = FALSE, delta = FALSE, clients = 0, seconds = DEFAULT_BENCH_SECS;
+	int			local = TRUE;
+	long long	min_chunk = DEFAULT_MIN_CHUNK, operations = 0;
 	struct 		hostent	*hp = NULL;
-	struct 		sockaddr_in server = {0}, client = {0};
+	struct 		sockaddr_in server = {0};
 	char  		*host = NULL;
-	char 		request[REQ_BUFLEN], ack_request[REQ_BUFLEN];
+	char 		request[REQ_BUFLEN] = {0}, ack_request[REQ_BUFLEN];
+	char		**requests = NULL;
+	struct		request req;
+	struct		stat st;
+	struct		mux_client client;
 
 	// Get user parameters
+	while ((option = getopt(argc, argv, "mrdnTz:p:c:b:t:o:")) != -1)
+	{
+		switch (option)
+		{
+			case 'm':
+				mux_mode = TRUE;
+			break;
+			case 'r':
+				resume = TRUE;
+			break;
+			case 'd':
+				delta = TRUE;
+			break;
+			case 'n':
+				use_crc = FALSE;
+			break;
+			case 'T':
+				local = FALSE;
+			break;
+			case 'z':
+				if ((compress_level = atoi(optarg)) < 1 || compress_level > COMPRESS_MAX_LEVEL)
+				{
+					fprintf(stderr, "[-]Compression level must be between 1 and %d\n", COMPRESS_MAX_LEVEL);
+					exit(1);
+				}
+			break;
+			case 'p':
+				if ((streams = atoi(optarg)) < 1 || streams > MAX_STREAMS)
+				{
+					fprintf(stderr, "[-]Streams must be between 1 and %d\n", MAX_STREAMS);
+					exit(1);
+				}
+			break;
+			case 'c':
+				if ((min_chunk = parse_size(optarg)) <= 0)
+				{
+					fprintf(stderr, "[-]Invalid chunk size: %s\n", optarg);
+					exit(1);
+				}
+			break;
+			case 'b':
+				if ((clients = atoi(optarg)) < 1 || clients > MAX_BENCH_CLIENTS)
+				{
+					fprintf(stderr, "[-]Clients must be between 1 and %d\n", MAX_BENCH_CLIENTS);
+					exit(1);
+				}
+			break;
+			case 't':
+				if ((seconds = atoi(optarg)) < 1)
+				{
+					fprintf(stderr, "[-]Invalid duration: %s\n", optarg);
+					exit(1);
+				}
+			break;
+			case 'o':
+				if ((operations = atoll(optarg)) < 1)
+				{
+					fprintf(stderr, "[-]Invalid operation count: %s\n", optarg);
+					exit(1);
+				}
+			break;
+			default:
+				fprintf(stderr, USAGE, argv[0]);
+				exit(1);
+		}
+	}
+	if (resume && streams > 1)
+	{
+		fprintf(stderr, "[-]Parallel transfers can't be resumed.\n");
+		exit(1);
+	}
+	if (delta && (resume || streams > 1))
+	{
+		fprintf(stderr, "[-]Delta uploads can't be resumed or split over streams.\n");
+		exit(1);
+	}
+	if (clients > 0 && (resume || delta || streams > 1))
+	{
+		fprintf(stderr, "[-]The load generator runs plain transfers only.\n");
+		exit(1);
+	}
+	option = 1;
+	argc -= optind - 1;
+	argv += optind - 1;
+
 	switch(argc)
 	{
-		case 3:
+		case 1:
+		case 2:
+			fprintf(stderr, USAGE, argv[0]);
+			exit(1);
+		default:
 			// Get server IP either using FQDN or IP address
 			host =	argv[1];
 			if ((hp = gethostbyname(host)) == NULL)
@@ -112,28 +442,137 @@ int main (int argc, char **argv)
 				exit(1);
 			}
 			printf("[+]Host found.\n");
-			// Validate request commands are valid
-			if (strcmp(argv[2], GET_COMMAND_NAME) == 0 || strcmp(argv[2], SEND_COMMAND_NAME) == 0) 
+			if (argc == 3 && strcmp(argv[2], STATS_COMMAND_NAME) == 0)
+			{
+				return query_stats(server, hp);
+			}
+			if (argc == 3 && strcmp(argv[2], "-") == 0)
+			{
+				requests = read_requests(stdin, &count);
+			}
+			else
+			{
+				requests = argv + 2;
+				count = argc - 2;
+			}
+			// Validate request commands are valid, and turn them into requests
+			for (i = 0; i < count; i++)
 			{
-				strcpy(request, argv[2]);
-			} 
-			else 
+				if ((requests[i] = expand_command(requests[i])) == NULL)
+				{
+					fprintf(stderr, USAGE, argv[0]);
+					exit(1);
+				}
+			}
+			if (count == 0)
 			{
-				fprintf(stderr, "Usage: %s host {GET,SEND}\n", argv[0]);
+				fprintf(stderr, "[-]No commands given.\n");
 				exit(1);
 			}
-		break;
-		default:
-			fprintf(stderr, "Usage: %s host {GET,SEND}\n", argv[0]);
+			for (i = 0; delta && i < count; i++)
+			{
+				if (strncmp(requests[i], SEND_COMMAND_NAME, strlen(SEND_COMMAND_NAME)) != 0)
+				{
+					fprintf(stderr, "[-]Delta mode only applies to SEND.\n");
+					exit(1);
+				}
+			}
+			strcpy(request, requests[0]);
+	}
+
+	// Many simulated clients repeat the commands until the run is over
+	if (clients > 0)
+	{
+		return run_bench(server, hp, requests, count, clients, seconds, operations);
+	}
+
+	// Each file is split over several connections
+	if (streams > 1)
+	{
+		for (failed = 0, i = 0; i < count; i++)
+		{
+			failed += parallel_transfer(server, hp, requests[i], streams, min_chunk);
+		}
+		if (count > 1)
+		{
+			printf("[+]%d of %d commands completed successfully.\n", count - failed, count);
+		}
+		return (failed == 0 ? 0 : 1);
+	}
+
+	// Each upload only sends what the server's copy lacks
+	if (delta)
+	{
+		client_socket = open_mux_session(server, hp);
+		for (failed = 0, i = 0; i < count; i++)
+		{
+			failed += delta_send(client_socket, requests[i]);
+		}
+		close (client_socket);
+		if (count > 1)
+		{
+			printf("[+]%d of %d commands completed successfully.\n", count - failed, count);
+		}
+		return (failed == 0 ? 0 : 1);
+	}
+
+	// Each transfer picks up where the last one stopped
+	if (resume)
+	{
+		fill_server_address(&server, hp);
+		if (open_mux_client(&client, &server) == -1)
+		{
+			perror("[-]Can't connect to server");
 			exit(1);
+		}
+		printf("[+]Connected to server successfully.\n");
+		for (failed = 0, i = 0; i < count; i++)
+		{
+			failed += resume_transfer(&client, requests[i]);
+		}
+		mux_client_close(&client);
+		if (count > 1)
+		{
+			printf("[+]%d of %d commands completed successfully.\n", count - failed, count);
+		}
+		return (failed == 0 ? 0 : 1);
+	}
+
+	// One connection carries the requests, acknowledgements and files
+	if (mux_mode || count > 1 || compress_level > 0)
+	{
+		failed = process_mux_requests(server, hp, requests, count);
+		if (count > 1)
+		{
+			printf("[+]%d of %d commands completed successfully.\n", count - failed, count);
+		}
+		return (failed == 0 ? 0 : 1);
 	}
 	
-	init_client_control_channel(&client_socket, option, client);
+	// The transfer gets a data port of its own, so other clients on this host don't hold it
+	// up; the server sets an upload's space aside before the data arrives
+	if (parse_request(request, &req) == 0 &&
+		(strcmp(req.command, GET_COMMAND_NAME) == 0 || strcmp(req.command, SEND_COMMAND_NAME) == 0))
+	{
+		req.port = 0;
+		if (strcmp(req.command, SEND_COMMAND_NAME) == 0 && stat(request_file_name(&req), &st) == 0)
+		{
+			req.size = st.st_size;
+		}
+		format_request(request, sizeof(request), &req);
+	}
+
+	// A server on this machine takes the file itself over its local socket
+	if (local && is_local_host(hp) && local_transfer(request) == 0)
+	{
+		return (0);
+	}
+
+	init_client_control_channel(&client_socket, option);
 	connect_to_server (client_socket, server, hp);
 	send_request(client_socket, request, ack_request);
-	init_client_data_channel(&client_socket, option, &client, sizeof(client));
-	process_request (ack_request, client_socket, server, hp);
 	close (client_socket);
+	process_request (ack_request, option, server, hp);
 	
 	return (0);
 }
@@ -145,20 +584,20 @@ int main (int argc, char **argv)
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Connects from an ephemeral port, so clients on one host don't collide
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void init_client_control_channel (int *client_socket, int option, struct sockaddr_in client)
+ * INTERFACE:      void init_client_control_channel (int *client_socket, int option)
  *
  * RETURNS:        void
  *
  * NOTES:
- * Creates client control channel socket, sets socket options to allow for reuseable addreses, binds address to socket
+ * Creates client control channel socket, sets socket options to allow for reuseable addreses
  * -----------------------------------------------------------------------*/
-void init_client_control_channel (int *client_socket, int option, struct sockaddr_in client)
+void init_client_control_channel (int *client_socket, int option)
 {
 	// Create the socket
 	if ((*client_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
@@ -174,20 +613,6 @@ void init_client_control_channel (int *client_socket, int option, struct sockadd
 		perror("[-]setsockopt failed");
 		exit(1);
 	}
-	
-	// Bind an address to the socket
-	bzero((char *)&client, sizeof(struct sockaddr_in));
-	client.sin_family = AF_INET;
-	client.sin_port = htons(CLIENT_CONTROL_CHANNEL_PORT); 
-	client.sin_addr.s_addr = htonl(INADDR_ANY); // Accept connections from any server
-	
-	// Bind address to socket
-	if (bind(*client_socket, (struct sockaddr *)&client, sizeof(client)) == -1)
-	{
-		perror("[-]Can't bind name to socket");
-		exit(1);
-	}
-	printf("[+]Client socket binded successfully.\n");
 }
 
 /*--------------------------------------------------------------------------
@@ -195,7 +620,7 @@ void init_client_control_channel (int *client_socket, int option, struct sockadd
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Gives up once the retry policy is exhausted
  *
  * DESIGNER:       Derek Wong
  *
@@ -210,6 +635,8 @@ void init_client_control_channel (int *client_socket, int option, struct sockadd
  * -----------------------------------------------------------------------*/
 void connect_to_server (int client_socket, struct sockaddr_in server,  struct hostent *hp)
 {
+	struct retry_policy policy = DEFAULT_RETRY_POLICY;
+
 	bzero((char *)&server, sizeof(struct sockaddr_in));
 	server.sin_family = AF_INET;
 	server.sin_port = htons(SERVER_CONTROL_CHANNEL_PORT);
@@ -217,48 +644,13 @@ void connect_to_server (int client_socket, struct sockaddr_in server,  struct ho
 	bcopy(hp->h_addr, (char *)&server.sin_addr, hp->h_length);
 
 	// Connecting to the server
-	connect_with_retry(client_socket, (struct sockaddr *)&server, sizeof(server));
-	printf("[+]Connected to server successfully.\n");
-	printf("[+]Connected:\tServer Name: %s\n", hp->h_name);
-}
-
-/*--------------------------------------------------------------------------
- * FUNCTION:       connect_with_retry
- *
- * DATE:           October 6th, 2020
- *
- * REVISIONS:      N/A
- *
- * DESIGNER:       Derek Wong
- *
- * PROGRAMMER:     Derek Wong
- *
- * INTERFACE:      void connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_entity_len)
- *
- * RETURNS:        void
- *
- * NOTES:
- * Utility function to help establish a connection between a remote entity and a client; Retries upon failure with a polling rate
- * -----------------------------------------------------------------------*/
-void connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_entity_len)
-{
-	// Connect to client, sleep when address is currently in use
-	int sleep_time = DEFAULT_SLEEP_TIME;
-	int interval = 1;
-	
-	while (NOT_CONNECTED)
+	if (connect_with_retry(client_socket, (struct sockaddr *)&server, sizeof(server), &policy) == -1)
 	{
-		if (connect (socket, remote_entity, remote_entity_len) == -1)
-		{
-			perror("[-]Can't connect to server");
-			sleep(sleep_time);
-			sleep_time += interval;
-		} 
-		else 
-		{
-			break;
-		}
+		perror("[-]Can't connect to server");
+		exit(1);
 	}
+	printf("[+]Connected to server successfully.\n");
+	printf("[+]Connected:\tServer Name: %s\n", hp->h_name);
 }
 
 /*--------------------------------------------------------------------------
@@ -266,7 +658,7 @@ void connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Leaves the socket open for the caller; stops on a closed connection
  *
  * DESIGNER:       Derek Wong
  *
@@ -277,7 +669,7 @@ void connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_
  * RETURNS:        void
  *
  * NOTES:
- * Sends a request with a command in a buffer to be read by the server; Receives an echo of acknoledged command 
+ * Sends a request with a command in a REQ_BUFLEN buffer to be read by the server; Receives an echo of acknoledged command 
  * -----------------------------------------------------------------------*/
 void send_request (int client_socket, char *request, char *ack_request)
 {
@@ -293,16 +685,20 @@ void send_request (int client_socket, char *request, char *ack_request)
 	bp = ack_request;
 	bytes_to_read = REQ_BUFLEN;
 	n = 0;
-	while ((n = recv (client_socket, bp, bytes_to_read, 0)) < REQ_BUFLEN)
+	while (bytes_to_read > 0)
 	{
+		if ((n = recv (client_socket, bp, bytes_to_read, 0)) <= 0)
+		{
+			perror("[-]Server closed the control connection");
+			exit(1);
+		}
 		bp += n;
 		bytes_to_read -= n;
 	}
+	ack_request[REQ_BUFLEN - 1] = '\0';
 	
-	printf("[+]Received %d bytes.\n", bytes_to_read);
+	printf("[+]Received %d bytes.\n", REQ_BUFLEN - bytes_to_read);
 	printf ("[+]%s command received.\n", ack_request);
-	
-	close (client_socket);	
 }
 
 /*--------------------------------------------------------------------------
@@ -360,30 +756,109 @@ void init_client_data_channel (int *client_socket, int option, struct sockaddr_i
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Gives up once the retry policy is exhausted
+ *                 October 16th, 2026 - Transfers the file the request names
+ *                 October 16th, 2026 - Connects to the data port the server opened for the transfer, if any
+ *                 October 16th, 2026 - Gives up on a server that never connects back after DATA_PORT_TIMEOUT_MS
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void process_request (char *ack_request, int client_socket, struct sockaddr_in server, struct hostent *hp)
+ * INTERFACE:      void process_request (char *ack_request, int option, struct sockaddr_in server, struct hostent *hp)
  *
  * RETURNS:        void
  *
  * NOTES:
  * Depending on what the acknowledged request command is, the client will either send/receive a file to/from server
+ * When the acknowledgement names a data port the client connects there from an ephemeral port in either
+ * direction; otherwise it uses the fixed data ports, and a GET waits up to DATA_PORT_TIMEOUT_MS
+ * for the server to connect back.
  * -----------------------------------------------------------------------*/
-void process_request (char *ack_request, int client_socket, struct sockaddr_in server, struct hostent *hp)
+void process_request (char *ack_request, int option, struct sockaddr_in server, struct hostent *hp)
 {
+	struct request		req;
+	struct sockaddr_in	client;
+	int					client_socket;
+
+	if (parse_request(ack_request, &req) == -1)
+	{
+		fprintf(stderr, "[-]Malformed acknowledgement from server\n");
+		exit(1);
+	}
+
+	// Connect to the transfer's own data port
+	if (req.port > 0 && (strcmp(req.command, GET_COMMAND_NAME) == 0 || strcmp(req.command, SEND_COMMAND_NAME) == 0))
+	{
+		FILE *fp = NULL;
+		struct retry_policy policy = DEFAULT_RETRY_POLICY;
+
+		if ((client_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+		{
+			perror("[-]Cannot create socket");
+			exit(1);
+		}
+		bzero((char *)&server, sizeof(struct sockaddr_in));
+		server.sin_family = AF_INET;
+		server.sin_port = htons(req.port);
+		bcopy(hp->h_addr, (char *)&server.sin_addr, hp->h_length);
+		if (connect_with_retry(client_socket, (struct sockaddr *)&server, sizeof(server), &policy) == -1)
+		{
+			perror("[-]Can't connect to server");
+			exit(1);
+		}
+		printf("[+]Connected to server data port %lld.\n", req.port);
+
+		if (strcmp(req.command, GET_COMMAND_NAME) == 0)
+		{
+			printf("[+]Client will now retrieve %s from server\n", request_file_name(&req));
+			write_file(client_socket, request_file_name(&req));
+			printf("[+]Data written locally in the file, %s, successfully.\n", request_file_name(&req));
+		}
+		else
+		{
+			printf("[+]Client will now send %s to Server\n", request_file_name(&req));
+			if ((fp = fopen(request_file_name(&req), "r")) == NULL)
+			{
+				perror("[-]Error in reading file.");
+				exit(1);
+			}
+			send_file(fp, client_socket);
+			fclose(fp);
+			printf("[+]File data sent successfully.\n");
+		}
+		close(client_socket);
+		return;
+	}
+
+	init_client_data_channel(&client_socket, option, &client, sizeof(client));
+
 	// Retrieve file from server
-	if (strcmp(ack_request, GET_COMMAND_NAME) == 0) 
+	if (strcmp(req.command, GET_COMMAND_NAME) == 0) 
 	{
 		if(listen(client_socket, 5) == -1)
 		{
 			perror("[-]Error in listening");
 			exit(1);
 		}
-		
+
+		// A server from before port=0 never connects back, so the wait is bounded
+		struct pollfd pfd = { .fd = client_socket, .events = POLLIN };
+		int ready;
+		while ((ready = poll(&pfd, 1, DATA_PORT_TIMEOUT_MS)) == -1 && errno == EINTR)
+		{
+		}
+		if (ready == -1)
+		{
+			perror("[-]Error in poll");
+			exit(1);
+		}
+		if (ready == 0)
+		{
+			fprintf(stderr, "[-]Server never connected to the data port; it may not support port=0.\n");
+			exit(1);
+		}
+
 		socklen_t server_len = sizeof(server);
 		int data_channel_socket = 0;
 		if ((data_channel_socket = accept (client_socket, (struct sockaddr *)&server, &server_len)) == -1)
@@ -393,16 +868,17 @@ void process_request (char *ack_request, int client_socket, struct sockaddr_in s
 		}
 		printf("[+]Server connected successfully.\n");
 		printf("[+]Server Address:  %s\n", inet_ntoa(server.sin_addr));
-		printf("[+]Client will now retrieve %s from server\n", GET_FILE_NAME);
-		write_file(data_channel_socket);
-		printf("[+]Data written locally in the file, %s, successfully.\n", GET_FILE_NAME);
+		printf("[+]Client will now retrieve %s from server\n", request_file_name(&req));
+		write_file(data_channel_socket, request_file_name(&req));
+		printf("[+]Data written locally in the file, %s, successfully.\n", request_file_name(&req));
 		close(data_channel_socket);
 		close(client_socket);
 	}
 	// Send file to server
-	else if (strcmp(ack_request, SEND_COMMAND_NAME) == 0)
+	else if (strcmp(req.command, SEND_COMMAND_NAME) == 0)
 	{
 		FILE *fp = NULL;
+		struct retry_policy policy = DEFAULT_RETRY_POLICY;
 		
 		bzero((char *)&server, sizeof(struct sockaddr_in));
 		server.sin_family = AF_INET;
@@ -411,12 +887,16 @@ void process_request (char *ack_request, int client_socket, struct sockaddr_in s
 		
 		
 		// Connect to server
-		connect_with_retry(client_socket, (struct sockaddr *)&server, sizeof(server));
+		if (connect_with_retry(client_socket, (struct sockaddr *)&server, sizeof(server), &policy) == -1)
+		{
+			perror("[-]Can't connect to server");
+			exit(1);
+		}
 		printf("[+]Connected to server successfully.\n");
 		printf("[+]Server Address:  %s\n", inet_ntoa(server.sin_addr));
-		printf("[+]Client will now send %s to Server\n", SEND_FILE_NAME);
+		printf("[+]Client will now send %s to Server\n", request_file_name(&req));
 		
-		fp = fopen(SEND_FILE_NAME, "r");
+		fp = fopen(request_file_name(&req), "r");
 		if (fp == NULL)
 		{
 			perror("[-]Error in reading file.");
@@ -434,7 +914,7 @@ void process_request (char *ack_request, int client_socket, struct sockaddr_in s
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Zero-copy with sendfile, falling back to a large copy buffer
  *
  * DESIGNER:       Derek Wong
  *
@@ -449,15 +929,7 @@ void process_request (char *ack_request, int client_socket, struct sockaddr_in s
  * -----------------------------------------------------------------------*/
 void send_file (FILE *fp, int sockfd)
 {
-  char data[FILE_BUFLEN] = {0};
-
-  while (fgets(data, FILE_BUFLEN, fp) != NULL) {
-    if (send(sockfd, data, sizeof(data), 0) == -1) {
-      perror("[-]Error in sending file.");
-      exit(1);
-    }
-    bzero(data, FILE_BUFLEN);
-  }
+	send_file_data(fileno(fp), sockfd, 0, -1);
 }
 
 /*--------------------------------------------------------------------------
@@ -465,36 +937,2086 @@ void send_file (FILE *fp, int sockfd)
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Writes exactly the bytes received, so binary files survive
+ *                 October 16th, 2026 - Writes to the file it is given
+ *                 October 16th, 2026 - Splices the data into the file, falling back to a buffer
+ *                 October 16th, 2026 - Receives into a temporary file and only replaces the old one once complete
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void write_file(int sockfd)
+ * INTERFACE:      void write_file(int sockfd, const char *filename)
  *
  * RETURNS:        void
  *
  * NOTES:
- * Receives file data through a specified socket and file descriptor to write locally to a file called get.txt
- * -----------------------------------------------------------------------*/
-void write_file(int sockfd)
-{
-  int n;
-  FILE *fp;
-  char *filename = GET_FILE_NAME;
-  char buffer[FILE_BUFLEN];
-
-  fp = fopen(filename, "w");
-  while (TRUE) {
-    n = recv(sockfd, buffer, FILE_BUFLEN, 0);
-    if (n <= 0){
-      break;
-      return;
-    }
-    fprintf(fp, "%s", buffer);
-	fflush(fp);
-    bzero(buffer, FILE_BUFLEN);
-  }
-  return;	
-}
\ No newline at end of file
+ * Receives file data through a specified socket and file descriptor to write locally to a file called filename
+ * The data goes to a hidden temporary file beside it, which is renamed over filename once the
+ * server has sent all of it, so a failed GET leaves the old file alone.
+ * -----------------------------------------------------------------------*/
+void write_file(int sockfd, const char *filename)
+{
+	char	temp_name[FILE_NAME_LEN + 8];
+	int		fd;
+
+	// Names can't start with '.', so no request names the hidden temporary file
+	snprintf(temp_name, sizeof(temp_name), ".%s.XXXXXX", filename);
+	if ((fd = mkstemp(temp_name)) == -1)
+	{
+		perror("[-]Error in opening file.");
+		exit(1);
+	}
+	fchmod(fd, 0644);
+	if (receive_file_data(sockfd, fd) == -1)
+	{
+		close(fd);
+		unlink(temp_name);
+		exit(1);
+	}
+	if (close(fd) == -1 || rename(temp_name, filename) == -1)
+	{
+		perror("[-]Error in writing file.");
+		unlink(temp_name);
+		exit(1);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       process_mux_requests
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Runs a batch of requests, pipelined instead of one at a time
+ *                 October 16th, 2026 - Parses the parameters of the acknowledgement
+ *                 October 16th, 2026 - Writes a GET to the file its request names
+ *                 October 16th, 2026 - Runs the batch on the client library from one thread
+ *                 October 16th, 2026 - A command whose file can't be opened or queued fails alone instead of ending the batch
+ *                 October 16th, 2026 - Waits with wait_mux_clients
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int process_mux_requests (struct sockaddr_in server, struct hostent *hp,
+ *                                           char **requests, int count)
+ *
+ * RETURNS:        int - number of requests the server rejected or failed
+ *
+ * NOTES:
+ * Opens a multiplexed session and runs GET and SEND requests over it. Every request is
+ * queued up front with the client library, which pipelines them; this thread only polls
+ * the session until the last one is done. A command whose local file can't be opened, or
+ * that can't be queued, is reported and counted as failed on the spot, removing a file it
+ * created.
+ * -----------------------------------------------------------------------*/
+int process_mux_requests (struct sockaddr_in server, struct hostent *hp, char **requests, int count)
+{
+	struct mux_client	client, *clients = &client;
+	struct mux_command	*commands;
+	struct request		req;
+	int					i, fd, sending, error, failed = 0;
+
+	fill_server_address(&server, hp);
+	if (open_mux_client(&client, &server) == -1)
+	{
+		perror("[-]Can't connect to server");
+		exit(1);
+	}
+	printf("[+]Connected to server successfully.\n");
+	printf("[+]Connected:\tServer Name: %s\n", hp->h_name);
+
+	if ((commands = calloc(count, sizeof(*commands))) == NULL)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+	for (i = 0; i < count; i++)
+	{
+		parse_request(requests[i], &req);
+		sending = strcmp(req.command, SEND_COMMAND_NAME) == 0;
+		commands[i].request = requests[i];
+		commands[i].failed = &failed;
+		if (sending)
+		{
+			fd = open(request_file_name(&req), O_RDONLY);
+		}
+		else if ((fd = open(request_file_name(&req), O_WRONLY | O_CREAT | O_EXCL, 0644)) != -1)
+		{
+			commands[i].created = TRUE;
+		}
+		else if (errno == EEXIST)
+		{
+			fd = open(request_file_name(&req), O_WRONLY);
+		}
+
+		// A command that can't be queued fails on its own; the rest of the batch goes on
+		if (fd == -1 || mux_transfer_init(&commands[i].transfer, req.name, fd, mux_command_done, &commands[i]) == -1 ||
+			(sending ? mux_client_send(&client, &commands[i].transfer) : mux_client_get(&client, &commands[i].transfer)) == -1)
+		{
+			error = errno;
+			fprintf(stderr, "[-]%s failed: %s\n", requests[i], strerror(error));
+			if (fd != -1)
+			{
+				close(fd);
+			}
+			if (commands[i].created)
+			{
+				unlink(request_file_name(&req));
+			}
+			failed++;
+			continue;
+		}
+		printf("[+]Transmitting command %s\n", requests[i]);
+	}
+
+	wait_mux_clients(&clients, 1);
+	mux_client_close(&client);
+	free(commands);
+	return failed;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_data_frames
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Adds the data to a CRC
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void send_data_frames (int sockfd, int fd, off_t offset, off_t len,
+ *                                        struct compressor *compressor, uint32_t *crc)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sends len bytes of a file from offset as DATA frames. The blocks the compressor picks are
+ * read and sent compressed; the rest go out through sendfile. With a crc every block is read,
+ * added to it and sent from the buffer.
+ * -----------------------------------------------------------------------*/
+void send_data_frames (int sockfd, int fd, off_t offset, off_t len, struct compressor *compressor, uint32_t *crc)
+{
+	char	*block = NULL, *packed = NULL;
+	off_t	n;
+	int		packed_len, compress;
+
+	for (; len > 0; len -= n, offset += n)
+	{
+		n = len < MAX_FRAME_PAYLOAD ? len : MAX_FRAME_PAYLOAD;
+		compress = compress_next(compressor);
+		if (!compress && crc == NULL)
+		{
+			send_frame(sockfd, FRAME_DATA, 0, NULL, n);
+			send_file_data(fd, sockfd, offset, n);
+			continue;
+		}
+		if (block == NULL && ((block = malloc(MAX_FRAME_PAYLOAD)) == NULL || (packed = malloc(MAX_FRAME_PAYLOAD)) == NULL))
+		{
+			perror("[-]Out of memory");
+			exit(1);
+		}
+		if (pread(fd, block, n, offset) != n)
+		{
+			fprintf(stderr, "[-]Error in reading file.\n");
+			exit(1);
+		}
+		if (crc != NULL)
+		{
+			*crc = crc32c(*crc, block, n);
+		}
+		if (compress && (packed_len = compress_block(compressor, block, n, packed, MAX_FRAME_PAYLOAD)) > 0)
+		{
+			send_frame(sockfd, FRAME_DATA, FRAME_FLAG_COMPRESSED, packed, packed_len);
+		}
+		else
+		{
+			send_frame(sockfd, FRAME_DATA, 0, block, n);
+		}
+	}
+	free(block);
+	free(packed);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_end
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void send_end (int sockfd, uint32_t crc)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sends the END frame closing a transfer's data, carrying crc unless -n is given
+ * -----------------------------------------------------------------------*/
+void send_end (int sockfd, uint32_t crc)
+{
+	crc = htonl(crc);
+	if (use_crc)
+	{
+		send_frame(sockfd, FRAME_END, 0, (char *)&crc, CHECKSUM_LEN);
+	}
+	else
+	{
+		send_frame(sockfd, FRAME_END, 0, NULL, 0);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       read_requests
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      char **read_requests (FILE *fp, int *count)
+ *
+ * RETURNS:        char ** - the commands read, *count of them
+ *
+ * NOTES:
+ * Reads whitespace separated commands (e.g. one per line) until the end of the input
+ * -----------------------------------------------------------------------*/
+char **read_requests (FILE *fp, int *count)
+{
+	char	**requests = NULL, word[REQ_BUFLEN];
+	int		size = 0;
+
+	*count = 0;
+	while (fscanf(fp, "%79s", word) == 1)
+	{
+		if (*count == size)
+		{
+			size = size == 0 ? 64 : size * 2;
+			if ((requests = realloc(requests, size * sizeof(char *))) == NULL)
+			{
+				perror("[-]Out of memory");
+				exit(1);
+			}
+		}
+		if ((requests[(*count)++] = strdup(word)) == NULL)
+		{
+			perror("[-]Out of memory");
+			exit(1);
+		}
+	}
+	return requests;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       open_mux_session
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int open_mux_session (struct sockaddr_in server, struct hostent *hp)
+ *
+ * RETURNS:        int - the session's socket
+ *
+ * NOTES:
+ * Connects to the server and switches the connection to multiplexed mode
+ * -----------------------------------------------------------------------*/
+int open_mux_session (struct sockaddr_in server, struct hostent *hp)
+{
+	char	mux_request[REQ_BUFLEN] = MUX_COMMAND_NAME, ack_request[REQ_BUFLEN];
+	int		client_socket, option = 1;
+
+	if ((client_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+	{
+		perror("[-]Cannot create socket");
+		exit(1);
+	}
+	setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+	connect_to_server (client_socket, server, hp);
+	send_request(client_socket, mux_request, ack_request);
+	return client_socket;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       parallel_transfer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Moves the file the command names
+ *                 October 16th, 2026 - Runs the ranges on the client library from one thread
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int parallel_transfer (struct sockaddr_in server, struct hostent *hp, char *command,
+ *                                        int streams, off_t min_chunk)
+ *
+ * RETURNS:        int - 0 on success, 1 if any range failed
+ *
+ * NOTES:
+ * Splits a GET or SEND into equal ranges of at least min_chunk bytes, at most streams of them,
+ * and moves each over its own session, all polled together. A GET first learns the file's
+ * size, then sizes its local file so every range can be written in place. A SEND's ranges
+ * all announce the whole file's size, so the stored file ends up the same length whichever
+ * arrives first.
+ * -----------------------------------------------------------------------*/
+int parallel_transfer (struct sockaddr_in server, struct hostent *hp, char *command, int streams, off_t min_chunk)
+{
+	struct range_transfer	*ranges;
+	struct mux_client		*clients[MAX_STREAMS];
+	struct request			req;
+	struct stat				st;
+	off_t					size, chunk;
+	int						fd, i, count, sending, failed = 0;
+
+	parse_request(command, &req);
+	sending = strcmp(req.command, SEND_COMMAND_NAME) == 0;
+	fill_server_address(&server, hp);
+	if ((ranges = calloc(streams, sizeof(*ranges))) == NULL)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+	if (!sending)
+	{
+		if (open_mux_client(&ranges[0].client, &server) == -1)
+		{
+			perror("[-]Can't connect to server");
+			exit(1);
+		}
+		size = query_file_size(&ranges[0].client, command);
+		mux_client_close(&ranges[0].client);
+		if (size == -1)
+		{
+			free(ranges);
+			return 1;
+		}
+
+		printf("[+]Client will now retrieve %s from server\n", request_file_name(&req));
+		if ((fd = open(request_file_name(&req), O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1 || ftruncate(fd, size) == -1)
+		{
+			perror("[-]Error in opening file.");
+			exit(1);
+		}
+	}
+	else
+	{
+		if ((fd = open(request_file_name(&req), O_RDONLY)) == -1 || fstat(fd, &st) == -1)
+		{
+			perror("[-]Error in reading file.");
+			exit(1);
+		}
+		size = st.st_size;
+		printf("[+]Client will now send %s to Server\n", request_file_name(&req));
+	}
+
+	// Never split a file into ranges smaller than min_chunk
+	count = (size + min_chunk - 1) / min_chunk;
+	count = count < 1 ? 1 : (count > streams ? streams : count);
+	chunk = (size + count - 1) / count;
+	printf("[+]Moving %lld bytes over %d streams.\n", (long long)size, count);
+
+	for (i = 0; i < count; i++)
+	{
+		ranges[i].command = command;
+		ranges[i].offset = i * chunk < size ? i * chunk : size;
+		ranges[i].length = size - ranges[i].offset < chunk ? size - ranges[i].offset : chunk;
+		if (open_mux_client(&ranges[i].client, &server) == -1)
+		{
+			perror("[-]Can't connect to server");
+			exit(1);
+		}
+		mux_transfer_init(&ranges[i].transfer, req.name, fd, range_done, &ranges[i]);
+		mux_transfer_range(&ranges[i].transfer, ranges[i].offset, ranges[i].length);
+		if ((sending ? mux_client_send(&ranges[i].client, &ranges[i].transfer)
+			: mux_client_get(&ranges[i].client, &ranges[i].transfer)) == -1)
+		{
+			perror("[-]Can't start transfer");
+			exit(1);
+		}
+		clients[i] = &ranges[i].client;
+	}
+	wait_mux_clients(clients, count);
+	for (i = 0; i < count; i++)
+	{
+		mux_client_close(&ranges[i].client);
+		failed |= ranges[i].failed;
+	}
+	close(fd);
+	free(ranges);
+
+	if (failed)
+	{
+		fprintf(stderr, "[-]%s of %s failed.\n", req.command, request_file_name(&req));
+		return 1;
+	}
+	if (!sending)
+	{
+		printf("[+]Data written locally in the file, %s, successfully.\n", request_file_name(&req));
+	}
+	else
+	{
+		printf("[+]Server stored %s successfully.\n", request_file_name(&req));
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       resume_transfer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Resumes the file the command names
+ *                 October 16th, 2026 - A whole-file upload announces its size
+ *                 October 16th, 2026 - Runs as ranged transfers of the client library
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int resume_transfer (struct mux_client *client, char *command)
+ *
+ * RETURNS:        int - 0 on success, 1 if the server rejected or failed the transfer
+ *
+ * NOTES:
+ * Runs a GET or SEND over a multiplexed session, moving only the bytes the receiver lacks.
+ * A GET asks for the range past the end of its local file and cuts that to the server's size
+ * afterwards. A SEND asks for the size of the server's copy first; a copy longer than the
+ * local file can't be a prefix of it, so the whole file is sent again.
+ * -----------------------------------------------------------------------*/
+int resume_transfer (struct mux_client *client, char *command)
+{
+	struct mux_transfer	transfer;
+	struct request		req;
+	struct stat			st;
+	char				name[FILE_NAME_LEN];
+	off_t				have;
+	int					fd, sending;
+
+	parse_request(command, &req);
+	strcpy(name, request_file_name(&req));
+	sending = strcmp(req.command, SEND_COMMAND_NAME) == 0;
+	if ((fd = open(name, sending ? O_RDONLY : O_WRONLY | O_CREAT, 0644)) == -1 || fstat(fd, &st) == -1)
+	{
+		perror(sending ? "[-]Error in reading file." : "[-]Error in opening file.");
+		exit(1);
+	}
+	if (!sending)
+	{
+		have = st.st_size;
+	}
+	else if ((have = query_file_size(client, command)) == -1)
+	{
+		close(fd);
+		return 1;
+	}
+	else if (have > st.st_size)
+	{
+		have = -1;
+	}
+
+	mux_transfer_init(&transfer, req.name, fd, NULL, NULL);
+	mux_transfer_range(&transfer, have, -1);
+	printf("[+]Transmitting command %s\n", command);
+	if ((sending ? mux_client_send(client, &transfer) : mux_client_get(client, &transfer)) == -1)
+	{
+		fprintf(stderr, "[-]%s failed: %s\n", command, strerror(errno));
+		close(fd);
+		return 1;
+	}
+	wait_mux_clients(&client, 1);
+	if (transfer_failed(&transfer, command))
+	{
+		close(fd);
+		return 1;
+	}
+	printf("[+]Resumed %s at byte %lld of %lld.\n", name,
+		(long long)(transfer.range_offset > 0 ? transfer.range_offset : 0), (long long)transfer.size);
+	if (sending)
+	{
+		close(fd);
+		printf("[+]Server stored %s successfully.\n", name);
+		return 0;
+	}
+	if (ftruncate(fd, transfer.range_offset + transfer.range_length) == -1)
+	{
+		perror("[-]Error in writing file.");
+		exit(1);
+	}
+	close(fd);
+	printf("[+]Data written locally in the file, %s, successfully.\n", name);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       query_file_size
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Asks about the file the command names
+ *                 October 16th, 2026 - Asks with mux_client_stat
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      off_t query_file_size (struct mux_client *client, char *command)
+ *
+ * RETURNS:        off_t - size of the server's file, -1 if the server rejected the request
+ *
+ * NOTES:
+ * Learns the size of the file a GET reads or a SEND writes on the server, with an empty
+ * transfer whose acknowledgement carries the size
+ * -----------------------------------------------------------------------*/
+off_t query_file_size (struct mux_client *client, char *command)
+{
+	struct mux_transfer	transfer;
+	struct request		req;
+
+	parse_request(command, &req);
+	mux_transfer_init(&transfer, req.name, -1, NULL, NULL);
+	if (mux_client_stat(client, &transfer, strcmp(req.command, SEND_COMMAND_NAME) == 0) == -1)
+	{
+		fprintf(stderr, "[-]%s failed: %s\n", command, strerror(errno));
+		return -1;
+	}
+	wait_mux_clients(&client, 1);
+	if (transfer_failed(&transfer, command))
+	{
+		return -1;
+	}
+	if (transfer.size < 0)
+	{
+		fprintf(stderr, "[-]Server failed to report the size of its file.\n");
+		return -1;
+	}
+	return transfer.size;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       recv_ack
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int recv_ack (int sockfd, struct request *ack)
+ *
+ * RETURNS:        int - 0 once a request is acknowledged, -1 if the server rejected it
+ *
+ * NOTES:
+ * Receives the server's reply to a REQUEST frame and parses the acknowledged request
+ * -----------------------------------------------------------------------*/
+int recv_ack (int sockfd, struct request *ack)
+{
+	struct frame_header	header;
+	char				text[MAX_REQUEST_LEN];
+
+	recv_frame(sockfd, &header, text, sizeof(text));
+	if (header.type == FRAME_ERROR)
+	{
+		fprintf(stderr, "[-]Server rejected the request: %s\n", text);
+		return -1;
+	}
+	if (header.type != FRAME_ACK)
+	{
+		fprintf(stderr, "[-]Unexpected frame type %d from server\n", header.type);
+		exit(1);
+	}
+	printf ("[+]%s command received.\n", text);
+	if (parse_request(text, ack) == -1)
+	{
+		fprintf(stderr, "[-]Malformed acknowledgement from server\n");
+		exit(1);
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       delta_send
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Ends with the CRC of the whole file
+ *                 October 16th, 2026 - Uploads the file the command names
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int delta_send (int sockfd, char *command)
+ *
+ * RETURNS:        int - 0 on success, 1 if the server rejected or failed the upload
+ *
+ * NOTES:
+ * Uploads the SEND command's file as a delta against the server's copy. The block size grows
+ * with the file (about its square root) so large files don't need huge signature lists. Every
+ * block-sized window of the file is looked up among the server's signatures; found blocks are sent as
+ * COPY frames, runs of consecutive blocks as one, and the bytes between them as DATA. The
+ * END carries the CRC of the whole file, which the server checks against the file it built.
+ * -----------------------------------------------------------------------*/
+int delta_send (int sockfd, char *command)
+{
+	struct signature_table	table;
+	struct compressor		compressor = {0};
+	struct frame_header		header;
+	struct request			req;
+	struct stat				st;
+	unsigned char			*data = NULL;
+	char					*signatures = NULL, text[MAX_REQUEST_LEN], name[FILE_NAME_LEN];
+	off_t					pos, anchor, literal = 0;
+	uint32_t				weak = 0, run_index = 0, run_count = 0;
+	int						fd, block, count = 0, index;
+
+	parse_request(command, &req);
+	strcpy(name, request_file_name(&req));
+	if ((fd = open(name, O_RDONLY)) == -1 || fstat(fd, &st) == -1 ||
+		(st.st_size > 0 && (data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED))
+	{
+		perror("[-]Error in reading file.");
+		exit(1);
+	}
+	for (block = DELTA_MIN_BLOCK * 2; block < DELTA_MAX_BLOCK && (off_t)block * block < st.st_size; block *= 2)
+	{
+	}
+
+	req.delta = block;
+	req.compress = compress_level > 0 ? compress_level : -1;
+	req.crc = use_crc ? 1 : -1;
+	format_request(text, sizeof(text), &req);
+	printf("[+]Transmitting command %s\n", text);
+	send_frame(sockfd, FRAME_REQUEST, 0, text, strlen(text));
+	if (recv_ack(sockfd, &req) == -1)
+	{
+		if (data != NULL)
+		{
+			munmap(data, st.st_size);
+		}
+		close(fd);
+		return 1;
+	}
+	block = req.delta;
+
+	// Signatures of the server's copy, up to END
+	while (TRUE)
+	{
+		recv_frame(sockfd, &header, text, sizeof(text));
+		if (header.type == FRAME_END)
+		{
+			break;
+		}
+		if (header.type != FRAME_SIGNATURES || header.length % SIGNATURE_LEN != 0)
+		{
+			fprintf(stderr, "[-]Unexpected frame type %d from server\n", header.type);
+			exit(1);
+		}
+		if ((signatures = realloc(signatures, (size_t)count * SIGNATURE_LEN + header.length)) == NULL)
+		{
+			perror("[-]Out of memory");
+			exit(1);
+		}
+		recv_all(sockfd, signatures + (size_t)count * SIGNATURE_LEN, header.length);
+		count += header.length / SIGNATURE_LEN;
+	}
+	printf("[+]Server has %d blocks of %d bytes.\n", count, block);
+	if (signature_table_init(&table, signatures, count) == -1 || compressor_init(&compressor, compress_level) == -1)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+
+	// Slide a block-sized window over the file a byte at a time
+	pos = anchor = 0;
+	if (st.st_size >= block)
+	{
+		weak = weak_checksum(data, block);
+	}
+	while (pos + block <= st.st_size)
+	{
+		if ((index = signature_table_find(&table, weak, data + pos, block)) == -1)
+		{
+			if (pos + block < st.st_size)
+			{
+				weak = weak_roll(weak, block, data[pos], data[pos + block]);
+			}
+			pos++;
+			continue;
+		}
+		if (run_count > 0 && (anchor < pos || (uint32_t)index != run_index + run_count))
+		{
+			send_copy(sockfd, run_index, run_count);
+			run_count = 0;
+		}
+		if (anchor < pos)
+		{
+			send_data_frames(sockfd, fd, anchor, pos - anchor, &compressor, NULL);
+			literal += pos - anchor;
+		}
+		if (run_count++ == 0)
+		{
+			run_index = index;
+		}
+		pos += block;
+		anchor = pos;
+		if (pos + block <= st.st_size)
+		{
+			weak = weak_checksum(data + pos, block);
+		}
+	}
+	if (run_count > 0)
+	{
+		send_copy(sockfd, run_index, run_count);
+	}
+	send_data_frames(sockfd, fd, anchor, st.st_size - anchor, &compressor, NULL);
+	literal += st.st_size - anchor;
+	send_end(sockfd, use_crc ? crc32c(0, data, st.st_size) : 0);
+	printf("[+]Sent %lld of %lld bytes; the rest is in the server's copy.\n", (long long)literal, (long long)st.st_size);
+
+	signature_table_free(&table);
+	compressor_free(&compressor);
+	free(signatures);
+	if (data != NULL)
+	{
+		munmap(data, st.st_size);
+	}
+	close(fd);
+
+	recv_frame(sockfd, &header, text, sizeof(text));
+	if (header.type != FRAME_END)
+	{
+		fprintf(stderr, "[-]Server failed to store %s\n", name);
+		return 1;
+	}
+	printf("[+]Server stored %s successfully.\n", name);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_copy
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void send_copy (int sockfd, uint32_t index, uint32_t count)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sends a COPY frame naming count of the server's blocks from index
+ * -----------------------------------------------------------------------*/
+void send_copy (int sockfd, uint32_t index, uint32_t count)
+{
+	char payload[COPY_PAYLOAD_LEN];
+
+	index = htonl(index);
+	count = htonl(count);
+	memcpy(payload, &index, 4);
+	memcpy(payload + 4, &count, 4);
+	send_frame(sockfd, FRAME_COPY, 0, payload, COPY_PAYLOAD_LEN);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       parse_size
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      long long parse_size (const char *text)
+ *
+ * RETURNS:        long long - the size in bytes, -1 if text isn't one
+ *
+ * NOTES:
+ * Parses a byte count with an optional k, m or g suffix
+ * -----------------------------------------------------------------------*/
+long long parse_size (const char *text)
+{
+	char		*end;
+	long long	size;
+
+	size = strtoll(text, &end, 10);
+	if (end == text || size < 0)
+	{
+		return -1;
+	}
+	switch (*end)
+	{
+		case 'g': case 'G':
+			size *= 1024;
+		// Fall through
+		case 'm': case 'M':
+			size *= 1024;
+		// Fall through
+		case 'k': case 'K':
+			size *= 1024;
+			end++;
+		break;
+	}
+	return *end == '\0' ? size : -1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_file_data
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Reads from an explicit offset, so threads can share the file
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void send_file_data (int fd, int sockfd, off_t offset, off_t len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sends len bytes (or up to the end of the file when len is negative) from offset. Uses
+ * sendfile and falls back to a large copy buffer when the file can't be mapped.
+ * -----------------------------------------------------------------------*/
+void send_file_data (int fd, int sockfd, off_t offset, off_t len)
+{
+	int		zero_copy = TRUE;
+	size_t	want;
+	ssize_t	n;
+	char	*data = NULL;
+
+	while (len != 0)
+	{
+		want = (len < 0 || len > SENDFILE_CHUNK) ? SENDFILE_CHUNK : (size_t)len;
+		if (zero_copy)
+		{
+			// Let the kernel move the file from the page cache straight to the socket
+			n = sendfile(sockfd, fd, &offset, want);
+			if (n == -1 && (errno == EINVAL || errno == ENOSYS))
+			{
+				zero_copy = FALSE;
+				continue;
+			}
+		}
+		else
+		{
+			if (data == NULL && (data = malloc(TRANSFER_BUFLEN)) == NULL)
+			{
+				perror("[-]Out of memory");
+				exit(1);
+			}
+			if ((n = pread(fd, data, want < TRANSFER_BUFLEN ? want : TRANSFER_BUFLEN, offset)) > 0)
+			{
+				send_all(sockfd, data, n);
+				offset += n;
+			}
+		}
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1)
+		{
+			perror("[-]Error in sending file.");
+			exit(1);
+		}
+		if (n == 0)
+		{
+			break;
+		}
+		if (len > 0)
+		{
+			len -= n;
+		}
+	}
+	free(data);
+	if (len > 0)
+	{
+		fprintf(stderr, "[-]File shrank while it was being sent.\n");
+		exit(1);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_frame
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Takes the frame's flags
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void send_frame (int sockfd, int type, int flags, const char *payload, uint32_t len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sends a frame header and its payload; with a NULL payload the caller sends the len bytes itself
+ * -----------------------------------------------------------------------*/
+void send_frame (int sockfd, int type, int flags, const char *payload, uint32_t len)
+{
+	struct frame_header	header;
+	char				buf[FRAME_HEADER_LEN];
+
+	header.type = type;
+	header.flags = flags;
+	header.length = len;
+	encode_frame_header(buf, &header);
+	send_all(sockfd, buf, FRAME_HEADER_LEN);
+	if (payload != NULL)
+	{
+		send_all(sockfd, payload, len);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       recv_frame
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void recv_frame (int sockfd, struct frame_header *header, char *payload, int payload_len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Receives a frame header. The payload of any frame but DATA and SIGNATURES is read into
+ * payload as a string; those are left on the socket for the caller.
+ * -----------------------------------------------------------------------*/
+void recv_frame (int sockfd, struct frame_header *header, char *payload, int payload_len)
+{
+	char buf[FRAME_HEADER_LEN];
+
+	recv_all(sockfd, buf, FRAME_HEADER_LEN);
+	decode_frame_header(buf, header);
+	if (header->type == FRAME_DATA || header->type == FRAME_SIGNATURES)
+	{
+		return;
+	}
+	if (header->length >= (uint32_t)payload_len && header->length > 0)
+	{
+		fprintf(stderr, "[-]Frame of %u bytes is too long\n", header->length);
+		exit(1);
+	}
+	recv_all(sockfd, payload, header->length);
+	if (payload != NULL)
+	{
+		payload[header->length] = '\0';
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_all
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void send_all (int sockfd, const char *data, size_t len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sends len bytes, retrying short and interrupted sends
+ * -----------------------------------------------------------------------*/
+void send_all (int sockfd, const char *data, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0)
+	{
+		if ((n = send(sockfd, data, len, 0)) == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("[-]Error in sending data.");
+			exit(1);
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       recv_all
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void recv_all (int sockfd, char *data, size_t len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Receives exactly len bytes; the connection closing early is an error
+ * -----------------------------------------------------------------------*/
+void recv_all (int sockfd, char *data, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0)
+	{
+		if ((n = recv(sockfd, data, len, 0)) <= 0)
+		{
+			if (n == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			fprintf(stderr, "[-]Server closed the connection.\n");
+			exit(1);
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       write_all
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Returns write errors instead of exiting
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int write_all (int fd, const char *data, size_t len, off_t offset)
+ *
+ * RETURNS:        int - 0 once every byte is written, -1 on a write error
+ *
+ * NOTES:
+ * Writes len bytes to a file at offset, retrying short and interrupted writes
+ * -----------------------------------------------------------------------*/
+int write_all (int fd, const char *data, size_t len, off_t offset)
+{
+	ssize_t n;
+
+	while (len > 0)
+	{
+		if ((n = pwrite(fd, data, len, offset)) == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("[-]Error in writing file.");
+			return -1;
+		}
+		data += n;
+		len -= n;
+		offset += n;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       run_bench
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Resolves the server's address once for every operation
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int run_bench (struct sockaddr_in server, struct hostent *hp, char **requests, int count,
+ *                                int clients, int seconds, long long operations)
+ *
+ * RETURNS:        int - 0 if every operation succeeded, 1 otherwise
+ *
+ * NOTES:
+ * Runs clients threads of operations drawn from requests for seconds, or until operations of
+ * them have started, then reports throughput and the latency of each phase. The transfers'
+ * own progress messages would swamp the report, so stdout is sent to /dev/null meanwhile.
+ * -----------------------------------------------------------------------*/
+int run_bench (struct sockaddr_in server, struct hostent *hp, char **requests, int count, int clients, int seconds, long long operations)
+{
+	static const char	*names[BENCH_PHASES] = {"connect", "ack", "setup", "transfer", "total"};
+	struct bench		*bench;
+	struct bench_client	*workers;
+	pthread_t			*threads;
+	long long			start, elapsed;
+	double				secs;
+	int					i, saved_stdout, null_fd;
+
+	bench = calloc(1, sizeof(struct bench));
+	workers = calloc(clients, sizeof(struct bench_client));
+	threads = calloc(clients, sizeof(pthread_t));
+	if (bench == NULL || workers == NULL || threads == NULL)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+	fill_server_address(&bench->server, hp);
+	bench->requests = requests;
+	bench->count = count;
+	bench->operations = operations;
+	if (operations > 0)
+	{
+		printf("[+]Running %lld operations over %d clients.\n", operations, clients);
+	}
+	else
+	{
+		printf("[+]Running %d clients for %d seconds.\n", clients, seconds);
+	}
+
+	fflush(stdout);
+	if ((saved_stdout = dup(STDOUT_FILENO)) == -1 || (null_fd = open("/dev/null", O_WRONLY)) == -1
+		|| dup2(null_fd, STDOUT_FILENO) == -1)
+	{
+		perror("[-]Can't silence output");
+		exit(1);
+	}
+	close(null_fd);
+
+	start = now_ns();
+	bench->deadline = operations > 0 ? 0 : start + seconds * 1000000000LL;
+	for (i = 0; i < clients; i++)
+	{
+		workers[i].bench = bench;
+		workers[i].seed = (unsigned int)start ^ (i * 2654435761U);
+		if ((errno = pthread_create(&threads[i], NULL, bench_client, &workers[i])) != 0)
+		{
+			perror("[-]Can't start client thread");
+			exit(1);
+		}
+	}
+	for (i = 0; i < clients; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	elapsed = now_ns() - start;
+
+	fflush(stdout);
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+
+	secs = elapsed / 1e9;
+	printf("[+]Clients: %d  Duration: %.2f s  Operations: %lld  Failed: %lld\n",
+		clients, secs, (long long)bench->completed, (long long)bench->failed);
+	printf("[+]Throughput: %.1f ops/s  %.2f MB/s\n",
+		bench->completed / secs, bench->bytes / secs / 1e6);
+	printf("%-10s %12s %12s %12s %12s\n", "phase (ms)", "p50", "p99", "p99.9", "max");
+	for (i = 0; i < BENCH_PHASES; i++)
+	{
+		printf("%-10s %12.3f %12.3f %12.3f %12.3f\n", names[i],
+			histogram_percentile(&bench->phases[i], 50) / 1e6,
+			histogram_percentile(&bench->phases[i], 99) / 1e6,
+			histogram_percentile(&bench->phases[i], 99.9) / 1e6,
+			histogram_percentile(&bench->phases[i], 100) / 1e6);
+	}
+
+	i = bench->failed == 0 ? 0 : 1;
+	free(threads);
+	free(workers);
+	free(bench);
+	return i;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bench_client
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void *bench_client (void *arg)
+ *
+ * RETURNS:        void *
+ *
+ * NOTES:
+ * Client thread entrypoint; runs randomly picked commands one after another until the
+ * deadline passes or the run's operations have all been claimed
+ * -----------------------------------------------------------------------*/
+void *bench_client (void *arg)
+{
+	struct bench_client	*client = arg;
+	struct bench		*bench = client->bench;
+	char				*command;
+
+	while (bench->deadline > 0 ? now_ns() < bench->deadline : atomic_fetch_add(&bench->started, 1) < bench->operations)
+	{
+		command = bench->requests[rand_r(&client->seed) % bench->count];
+		if (bench_operation(bench, command) == 0)
+		{
+			atomic_fetch_add(&bench->completed, 1);
+		}
+		else
+		{
+			atomic_fetch_add(&bench->failed, 1);
+		}
+	}
+	return NULL;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bench_operation
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Uploads the file a SEND names
+ *                 October 16th, 2026 - Runs the operation on the client library
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int bench_operation (struct bench *bench, char *command)
+ *
+ * RETURNS:        int - 0 on success, 1 if the connection failed or the server rejected or
+ *                 failed the transfer
+ *
+ * NOTES:
+ * Runs one GET or SEND over a session of its own, timing each phase as the client library
+ * passes it: connected, MUX echo in, request acknowledged, transfer done. Like any client of
+ * the library a SEND streams its file right behind the request, so its setup phase overlaps
+ * the start of the upload. A connection that fails isn't retried: under load that is a
+ * result, not noise. The session is closed with a reset: a client opening thousands of
+ * connections would otherwise run out of ports to TIME_WAIT.
+ * -----------------------------------------------------------------------*/
+int bench_operation (struct bench *bench, char *command)
+{
+	struct mux_client	client;
+	struct mux_transfer	transfer;
+	struct request		req;
+	struct linger		linger = {1, 0};
+	struct pollfd		pfd;
+	long long			t0, t1 = 0, t2 = 0, t3 = 0, t4, now;
+	int					fd, sending, failed;
+
+	parse_request(command, &req);
+	sending = strcmp(req.command, SEND_COMMAND_NAME) == 0;
+	if ((fd = open(sending ? request_file_name(&req) : "/dev/null", sending ? O_RDONLY : O_WRONLY)) == -1)
+	{
+		perror(sending ? "[-]Error in reading file." : "[-]Error in opening file.");
+		exit(1);
+	}
+
+	t0 = now_ns();
+	if (mux_client_open(&client, &bench->server, compress_level, use_crc) == -1)
+	{
+		perror("[-]Can't connect to server");
+		close(fd);
+		return 1;
+	}
+	setsockopt(client.fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+	mux_transfer_init(&transfer, req.name, fd, NULL, NULL);
+	if ((sending ? mux_client_send(&client, &transfer) : mux_client_get(&client, &transfer)) == -1)
+	{
+		perror("[-]Error in reading file.");
+		exit(1);
+	}
+
+	pfd.fd = client.fd;
+	while (mux_client_pending(&client) > 0)
+	{
+		pfd.events = mux_client_events(&client);
+		if (poll(&pfd, 1, -1) == -1 && errno != EINTR)
+		{
+			perror("[-]Error in waiting for server");
+			exit(1);
+		}
+		mux_client_process(&client);
+		now = now_ns();
+		t1 = t1 == 0 && client.state != MUX_CLIENT_CONNECTING && client.state != MUX_CLIENT_FAILED ? now : t1;
+		t2 = t2 == 0 && client.state == MUX_CLIENT_OPEN ? now : t2;
+		t3 = t3 == 0 && transfer.acknowledged ? now : t3;
+	}
+	t4 = now_ns();
+	failed = transfer_failed(&transfer, command);
+	mux_client_close(&client);
+	close(fd);
+
+	if (t1 != 0)
+	{
+		histogram_record(&bench->phases[PHASE_CONNECT], t1 - t0);
+	}
+	if (t2 != 0)
+	{
+		histogram_record(&bench->phases[PHASE_ACK], t2 - t1);
+	}
+	if (t3 != 0)
+	{
+		histogram_record(&bench->phases[PHASE_SETUP], t3 - t2);
+	}
+	if (failed)
+	{
+		return 1;
+	}
+	histogram_record(&bench->phases[PHASE_TRANSFER], t4 - t3);
+	histogram_record(&bench->phases[PHASE_TOTAL], t4 - t0);
+	atomic_fetch_add(&bench->bytes, transfer.size);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       query_stats
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int query_stats (struct sockaddr_in server, struct hostent *hp)
+ *
+ * RETURNS:        int - 0 on success, 1 if the server sent nothing after the echo
+ *
+ * NOTES:
+ * Sends a STATS request and copies the server's reply to stdout until it closes the connection
+ * -----------------------------------------------------------------------*/
+int query_stats (struct sockaddr_in server, struct hostent *hp)
+{
+	char	request[REQ_BUFLEN] = STATS_COMMAND_NAME, ack_request[REQ_BUFLEN], buffer[REQ_BUFLEN];
+	int		client_socket, n, total = 0;
+
+	if ((client_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+	{
+		perror("[-]Cannot create socket");
+		exit(1);
+	}
+	connect_to_server (client_socket, server, hp);
+	send_request(client_socket, request, ack_request);
+	while ((n = recv(client_socket, buffer, sizeof(buffer), 0)) > 0)
+	{
+		fwrite(buffer, 1, n, stdout);
+		total += n;
+	}
+	close(client_socket);
+	return (total > 0 ? 0 : 1);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       expand_command
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      char *expand_command (const char *command)
+ *
+ * RETURNS:        char * - the request text of the command, NULL if the command is invalid
+ *
+ * NOTES:
+ * Turns a GET or SEND command, optionally followed by :name, into the request it stands for,
+ * e.g. "GET:build.tar" into "GET name=build.tar"
+ * -----------------------------------------------------------------------*/
+char *expand_command (const char *command)
+{
+	struct request	req;
+	const char		*name = strchr(command, ':');
+	char			text[REQ_BUFLEN], *request;
+
+	if (name == NULL)
+	{
+		snprintf(text, sizeof(text), "%s", command);
+	}
+	else
+	{
+		snprintf(text, sizeof(text), "%.*s name=%s", (int)(name - command), command, name + 1);
+	}
+	if (parse_request(text, &req) == -1 ||
+		(strcmp(req.command, GET_COMMAND_NAME) != 0 && strcmp(req.command, SEND_COMMAND_NAME) != 0))
+	{
+		return NULL;
+	}
+	format_request(text, sizeof(text), &req);
+	if ((request = strdup(text)) == NULL)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+	return request;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       is_local_host
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int is_local_host (struct hostent *hp)
+ *
+ * RETURNS:        int - TRUE if the server's address is a loopback address or one of this
+ *                       machine's, FALSE otherwise
+ *
+ * NOTES:
+ * Decides whether the server could be reached over its local socket
+ * -----------------------------------------------------------------------*/
+int is_local_host (struct hostent *hp)
+{
+	struct ifaddrs	*addrs, *ifa;
+	struct in_addr	addr;
+	int				local = FALSE;
+
+	bcopy(hp->h_addr, (char *)&addr, sizeof(addr));
+	if ((ntohl(addr.s_addr) >> 24) == IN_LOOPBACKNET)
+	{
+		return TRUE;
+	}
+	if (getifaddrs(&addrs) == -1)
+	{
+		return FALSE;
+	}
+	for (ifa = addrs; ifa != NULL && !local; ifa = ifa->ifa_next)
+	{
+		local = ifa->ifa_addr != NULL && ifa->ifa_addr->sa_family == AF_INET &&
+			((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr == addr.s_addr;
+	}
+	freeifaddrs(addrs);
+	return local;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       local_transfer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Finds the socket with local_channel_path and checks the server's user before passing a file
+ *                 October 16th, 2026 - A GET of the very file the server passed leaves it alone
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int local_transfer (char *request)
+ *
+ * RETURNS:        int - 0 once the transfer is done, -1 if no server this user trusts listens
+ *                 on the local socket
+ *
+ * NOTES:
+ * Runs a GET or SEND over the server's Unix domain socket. A SEND passes the open file with
+ * its request and returns once the server has stored it; a GET receives the server's open
+ * file with the reply and copies it here, unless the local file already is the server's
+ * (client and server in one directory), which opening it for the copy would empty. Exits
+ * if the server can't serve the request. Nothing is sent to a server running as another user (other than root), which would
+ * otherwise be handed the file or get to hand one back; the transfer then goes over TCP.
+ * -----------------------------------------------------------------------*/
+int local_transfer (char *request)
+{
+	char				control[CMSG_SPACE(sizeof(int))];
+	char				message[REQ_BUFLEN];
+	struct sockaddr_un	server;
+	struct request		req;
+	struct msghdr		msg;
+	struct iovec		iov;
+	struct cmsghdr		*cmsg;
+	struct stat			from, to;
+	int					sockfd, fd = -1, received = 0, n;
+
+	if (parse_request(request, &req) == -1 ||
+		(strcmp(req.command, GET_COMMAND_NAME) != 0 && strcmp(req.command, SEND_COMMAND_NAME) != 0))
+	{
+		return -1;
+	}
+	if ((sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+	{
+		return -1;
+	}
+	bzero((char *)&server, sizeof(server));
+	server.sun_family = AF_UNIX;
+	if (local_channel_path(server.sun_path, sizeof(server.sun_path)) == -1 ||
+		connect(sockfd, (struct sockaddr *)&server, sizeof(server)) == -1)
+	{
+		close(sockfd);
+		return -1;
+	}
+	if (!local_peer_trusted(sockfd))
+	{
+		fprintf(stderr, "[-]Local server at %s runs as another user; using TCP.\n", server.sun_path);
+		close(sockfd);
+		return -1;
+	}
+	printf("[+]Connected to local server at %s.\n", server.sun_path);
+
+	// Only the request itself; the port and size only mean something over TCP
+	req.port = -1;
+	req.size = -1;
+	bzero(message, REQ_BUFLEN);
+	format_request(message, REQ_BUFLEN, &req);
+	bzero((char *)&msg, sizeof(msg));
+	iov.iov_base = message;
+	iov.iov_len = REQ_BUFLEN;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (strcmp(req.command, SEND_COMMAND_NAME) == 0)
+	{
+		if ((fd = open(request_file_name(&req), O_RDONLY)) == -1)
+		{
+			perror("[-]Error in reading file.");
+			exit(1);
+		}
+		bzero(control, sizeof(control));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+	}
+	printf("[+]Transmitting command %s\n", message);
+	if (sendmsg(sockfd, &msg, MSG_NOSIGNAL) != REQ_BUFLEN)
+	{
+		perror("[-]Can't send request");
+		exit(1);
+	}
+	if (fd != -1)
+	{
+		close(fd);
+		fd = -1;
+	}
+
+	// The message of a GET brings the file with it
+	while (received < REQ_BUFLEN)
+	{
+		bzero((char *)&msg, sizeof(msg));
+		iov.iov_base = message + received;
+		iov.iov_len = REQ_BUFLEN - received;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if ((n = recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			fprintf(stderr, "[-]Server couldn't serve %s\n", request_file_name(&req));
+			exit(1);
+		}
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			{
+				memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+			}
+		}
+		received += n;
+	}
+	close(sockfd);
+	message[REQ_BUFLEN - 1] = '\0';
+	printf("[+]%s command received.\n", message);
+
+	if (strcmp(req.command, GET_COMMAND_NAME) == 0)
+	{
+		int out;
+
+		if (fd == -1)
+		{
+			fprintf(stderr, "[-]Server didn't pass %s\n", request_file_name(&req));
+			exit(1);
+		}
+		if (fstat(fd, &from) == 0 && stat(request_file_name(&req), &to) == 0 &&
+			from.st_dev == to.st_dev && from.st_ino == to.st_ino)
+		{
+			close(fd);
+			printf("[+]%s is already the server's file; nothing to copy.\n", request_file_name(&req));
+			return 0;
+		}
+		if ((out = open(request_file_name(&req), O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+		{
+			perror("[-]Error in opening file.");
+			exit(1);
+		}
+		printf("[+]Client will now copy %s from server\n", request_file_name(&req));
+		copy_local_file(fd, out);
+		close(fd);
+		if (close(out) == -1)
+		{
+			perror("[-]Error in writing file.");
+			exit(1);
+		}
+		printf("[+]Data written locally in the file, %s, successfully.\n", request_file_name(&req));
+	}
+	else
+	{
+		printf("[+]File %s stored by server successfully.\n", request_file_name(&req));
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       copy_local_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void copy_local_file (int from_fd, int to_fd)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Copies a whole file with copy_file_range, which lets the file system share or copy the
+ * blocks without them leaving the kernel. Where it can't, the rest goes through
+ * send_file_data, which sendfile can write to a file as well as to a socket.
+ * -----------------------------------------------------------------------*/
+void copy_local_file (int from_fd, int to_fd)
+{
+	off_t	offset = 0;
+	ssize_t	n;
+
+	while ((n = copy_file_range(from_fd, &offset, to_fd, NULL, SENDFILE_CHUNK, 0)) != 0)
+	{
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP))
+		{
+			send_file_data(from_fd, to_fd, offset, -1);
+			return;
+		}
+		if (n == -1)
+		{
+			perror("[-]Error in copying file.");
+			exit(1);
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       open_mux_client
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int open_mux_client (struct mux_client *client, struct sockaddr_in *server)
+ *
+ * RETURNS:        int - 0 once the session is open, -1 with errno set if it couldn't be opened
+ *
+ * NOTES:
+ * Opens a session with the client library, using -z and -n, and waits for the server to
+ * echo it. Failed attempts are retried with the same backoff as connect_to_server.
+ * -----------------------------------------------------------------------*/
+int open_mux_client (struct mux_client *client, struct sockaddr_in *server)
+{
+	struct retry_policy	policy = DEFAULT_RETRY_POLICY;
+	struct backoff		backoff;
+	struct pollfd		pfd;
+	int					delay, error;
+
+	backoff_start(&backoff, &policy);
+	while (TRUE)
+	{
+		if (mux_client_open(client, server, compress_level, use_crc) == -1)
+		{
+			return -1;
+		}
+		pfd.fd = client->fd;
+		error = ETIMEDOUT;
+		while (client->state != MUX_CLIENT_OPEN)
+		{
+			pfd.events = mux_client_events(client);
+			if (poll(&pfd, 1, policy.attempt_timeout_ms) == 0)
+			{
+				break;
+			}
+			if (mux_client_process(client) == -1)
+			{
+				error = client->error == MUX_CLIENT_ERR_SYSTEM ? client->sys_errno : ECONNRESET;
+				break;
+			}
+		}
+		if (client->state == MUX_CLIENT_OPEN)
+		{
+			return 0;
+		}
+		mux_client_close(client);
+		fprintf(stderr, "[-]Connection attempt %d failed: %s\n", backoff.attempts + 1, strerror(error));
+
+		if ((delay = backoff_next_delay(&backoff, &policy)) == -1)
+		{
+			errno = error;
+			return -1;
+		}
+		poll(NULL, 0, delay);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_command_done
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Reports failures with transfer_failed
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void mux_command_done (struct mux_transfer *transfer, void *arg)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Completion callback of a batch's transfers: reports how the command went and closes its
+ * file. A GET that arrived is cut to the server's size; one that failed removes the local
+ * file if it created it.
+ * -----------------------------------------------------------------------*/
+void mux_command_done (struct mux_transfer *transfer, void *arg)
+{
+	struct mux_command	*command = arg;
+	const char			*name = transfer->name[0] != '\0' ? transfer->name
+										: (transfer->send ? SEND_FILE_NAME : GET_FILE_NAME);
+
+	if (transfer->error == MUX_CLIENT_OK && !transfer->send && ftruncate(transfer->fd, transfer->size) == -1)
+	{
+		transfer->error = MUX_CLIENT_ERR_SYSTEM;
+		transfer->sys_errno = errno;
+	}
+	close(transfer->fd);
+
+	if (!transfer_failed(transfer, command->request))
+	{
+		if (transfer->send)
+		{
+			printf("[+]Server stored %s successfully.\n", name);
+		}
+		else
+		{
+			printf("[+]Data written locally in the file, %s, successfully.\n", name);
+		}
+		return;
+	}
+	if (command->created)
+	{
+		unlink(name);
+	}
+	(*command->failed)++;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       fill_server_address
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void fill_server_address (struct sockaddr_in *server, struct hostent *hp)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sets server to the control port of the host found, for the client library to connect to
+ * -----------------------------------------------------------------------*/
+void fill_server_address (struct sockaddr_in *server, struct hostent *hp)
+{
+	bzero((char *)server, sizeof(struct sockaddr_in));
+	server->sin_family = AF_INET;
+	server->sin_port = htons(SERVER_CONTROL_CHANNEL_PORT);
+	bcopy(hp->h_addr, (char *)&server->sin_addr, hp->h_length);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       wait_mux_clients
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void wait_mux_clients (struct mux_client **clients, int count)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Polls up to MAX_STREAMS sessions together until every transfer queued on them is done
+ * -----------------------------------------------------------------------*/
+void wait_mux_clients (struct mux_client **clients, int count)
+{
+	struct pollfd	pfds[MAX_STREAMS];
+	int				i, waiting;
+
+	while (TRUE)
+	{
+		for (waiting = FALSE, i = 0; i < count; i++)
+		{
+			pfds[i].fd = mux_client_pending(clients[i]) > 0 ? clients[i]->fd : -1;
+			pfds[i].events = mux_client_events(clients[i]);
+			waiting |= pfds[i].fd != -1;
+		}
+		if (!waiting)
+		{
+			return;
+		}
+		if (poll(pfds, count, -1) == -1 && errno != EINTR)
+		{
+			perror("[-]Error in waiting for server");
+			exit(1);
+		}
+		for (i = 0; i < count; i++)
+		{
+			if (pfds[i].fd != -1)
+			{
+				mux_client_process(clients[i]);
+			}
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       transfer_failed
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int transfer_failed (const struct mux_transfer *transfer, const char *request)
+ *
+ * RETURNS:        int - TRUE if the transfer failed, FALSE if it succeeded
+ *
+ * NOTES:
+ * Reports why a finished transfer of the client library failed, naming its request
+ * -----------------------------------------------------------------------*/
+int transfer_failed (const struct mux_transfer *transfer, const char *request)
+{
+	switch (transfer->error)
+	{
+		case MUX_CLIENT_OK:
+			return FALSE;
+		case MUX_CLIENT_ERR_REJECTED:
+			fprintf(stderr, "[-]Server rejected %s: %s\n", request, transfer->message);
+			break;
+		case MUX_CLIENT_ERR_SYSTEM:
+			fprintf(stderr, "[-]%s failed: %s\n", request, strerror(transfer->sys_errno));
+			break;
+		case MUX_CLIENT_ERR_CHECKSUM:
+			fprintf(stderr, "[-]Checksum mismatch; %s is corrupt.\n", request);
+			break;
+		default:
+			fprintf(stderr, "[-]%s failed: %s\n", request, mux_client_strerror(transfer->error));
+	}
+	return TRUE;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       range_done
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void range_done (struct mux_transfer *transfer, void *arg)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Completion callback of a parallel transfer's ranges. A GET also fails if the server sent
+ * another range than was asked for, which means the file changed size since it was probed.
+ * -----------------------------------------------------------------------*/
+void range_done (struct mux_transfer *transfer, void *arg)
+{
+	struct range_transfer *range = arg;
+
+	range->failed = transfer_failed(transfer, range->command);
+	if (!range->failed && !transfer->send &&
+		(transfer->range_offset != range->offset || transfer->range_length != range->length))
+	{
+		fprintf(stderr, "[-]Server file changed during the transfer.\n");
+		range->failed = TRUE;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       receive_file_data
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int receive_file_data (int sockfd, int fd)
+ *
+ * RETURNS:        int - 0 once the server closes the connection, -1 on an error
+ *
+ * NOTES:
+ * Writes everything received on sockfd to fd until the server closes the connection.
+ * The data is spliced from the socket into a pipe and from the pipe into the file, without
+ * leaving the kernel. Where the file can't be spliced to, what the pipe holds and the rest
+ * of the data go through a buffer instead.
+ * -----------------------------------------------------------------------*/
+int receive_file_data (int sockfd, int fd)
+{
+	ssize_t	n, m, left;
+	off_t	offset = 0;
+	int		pipe_fds[2], zero_copy, result = -1;
+	char	*buffer;
+
+	if ((buffer = malloc(TRANSFER_BUFLEN)) == NULL)
+	{
+		perror("[-]Out of memory");
+		return -1;
+	}
+	pipe_fds[0] = -1;
+	if ((zero_copy = pipe(pipe_fds) == 0))
+	{
+		fcntl(pipe_fds[1], F_SETPIPE_SZ, TRANSFER_BUFLEN);
+	}
+	while (TRUE)
+	{
+		if (zero_copy)
+		{
+			n = splice(sockfd, NULL, pipe_fds[1], NULL, TRANSFER_BUFLEN, SPLICE_F_MOVE);
+		}
+		else
+		{
+			n = recv(sockfd, buffer, TRANSFER_BUFLEN, 0);
+		}
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1)
+		{
+			perror("[-]Error in receiving file.");
+			goto done;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+		if (!zero_copy)
+		{
+			if (write_all(fd, buffer, n, offset) == -1)
+			{
+				goto done;
+			}
+			offset += n;
+			continue;
+		}
+
+		for (left = n; left > 0 && zero_copy; left -= m)
+		{
+			if ((m = splice(pipe_fds[0], NULL, fd, &offset, left, SPLICE_F_MOVE)) == -1 && errno == EINVAL)
+			{
+				zero_copy = FALSE;
+				m = 0;
+			}
+			else if (m == -1 && errno == EINTR)
+			{
+				m = 0;
+			}
+			else if (m <= 0)
+			{
+				perror("[-]Error in writing file.");
+				goto done;
+			}
+		}
+		// The file system can't take spliced data; empty the pipe through the buffer
+		for (; left > 0; left -= m)
+		{
+			if ((m = read(pipe_fds[0], buffer, left)) == -1 && errno == EINTR)
+			{
+				m = 0;
+				continue;
+			}
+			if (m <= 0)
+			{
+				perror("[-]Error in receiving file.");
+				goto done;
+			}
+			if (write_all(fd, buffer, m, offset) == -1)
+			{
+				goto done;
+			}
+			offset += m;
+		}
+	}
+	result = 0;
+
+done:
+	if (pipe_fds[0] != -1)
+	{
+		close(pipe_fds[0]);
+		close(pipe_fds[1]);
+	}
+	free(buffer);
+	return result;
+}
@@ -0,0 +1,416 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	compress.c - Block compression for file data on the wire
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		compressor_init (struct compressor *c, int level);
+--					compressor_free (struct compressor *c);
+--					compress_next (struct compressor *c);
+--					compress_block (struct compressor *c, const char *src, int len, char *dst, int dst_cap);
+--					decompress_block (const char *src, int len, char *dst, int dst_cap);
+--					lz_compress (struct compressor *c, const unsigned char *src, int len, unsigned char *dst, int dst_cap);
+--					put_length (unsigned char *op, unsigned char *op_end, int len);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The block format is described in compress.h
+---------------------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "compress.h"
+
+#define MIN_MATCH		4
+#define MAX_DISTANCE	65535
+#define HASH_BITS		15
+#define HASH_SIZE		(1 << HASH_BITS)
+#define WINDOW_MASK		0xFFFF
+#define MAX_BACKOFF		64				// Most blocks sent raw between two samples
+
+int lz_compress (struct compressor *c, const unsigned char *src, int len, unsigned char *dst, int dst_cap);
+unsigned char *put_length (unsigned char *op, unsigned char *op_end, int len);
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       compressor_init
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int compressor_init (struct compressor *c, int level)
+ *
+ * RETURNS:        int - 0 on success, -1 if the match tables can't be allocated
+ *
+ * NOTES:
+ * Starts compressing at a level, 0 turning compression off. The compressor must be zeroed
+ * before its first use; its tables are allocated once and kept for later transfers.
+ * -----------------------------------------------------------------------*/
+int compressor_init (struct compressor *c, int level)
+{
+	c->level = level < 0 ? 0 : (level > COMPRESS_MAX_LEVEL ? COMPRESS_MAX_LEVEL : level);
+	c->skip = 0;
+	c->backoff = 1;
+	if (c->level > 0 && c->head == NULL)
+	{
+		c->head = malloc(HASH_SIZE * sizeof(int));
+		c->prev = malloc((WINDOW_MASK + 1) * sizeof(unsigned short));
+		if (c->head == NULL || c->prev == NULL)
+		{
+			compressor_free(c);
+			c->level = 0;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       compressor_free
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void compressor_free (struct compressor *c)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Frees a compressor's match tables
+ * -----------------------------------------------------------------------*/
+void compressor_free (struct compressor *c)
+{
+	free(c->head);
+	free(c->prev);
+	c->head = NULL;
+	c->prev = NULL;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       compress_next
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int compress_next (struct compressor *c)
+ *
+ * RETURNS:        int - 1 if the next block should be compressed, 0 to send it raw
+ *
+ * NOTES:
+ * Called once per block before reading it, so blocks that go out raw can still be sent
+ * straight from the file
+ * -----------------------------------------------------------------------*/
+int compress_next (struct compressor *c)
+{
+	if (c->level == 0)
+	{
+		return 0;
+	}
+	if (c->skip > 0)
+	{
+		c->skip--;
+		return 0;
+	}
+	return 1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       compress_block
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int compress_block (struct compressor *c, const char *src, int len, char *dst, int dst_cap)
+ *
+ * RETURNS:        int - compressed length, 0 if the block should be sent raw
+ *
+ * NOTES:
+ * Compresses a block that compress_next picked. A block that doesn't shrink by an eighth is
+ * sent raw and the blocks after it skip compression, for longer each time in a row.
+ * -----------------------------------------------------------------------*/
+int compress_block (struct compressor *c, const char *src, int len, char *dst, int dst_cap)
+{
+	int n;
+
+	if (dst_cap > len - len / 8)
+	{
+		dst_cap = len - len / 8;
+	}
+	if ((n = lz_compress(c, (const unsigned char *)src, len, (unsigned char *)dst, dst_cap)) == 0)
+	{
+		c->skip = c->backoff;
+		c->backoff = c->backoff * 2 < MAX_BACKOFF ? c->backoff * 2 : MAX_BACKOFF;
+		return 0;
+	}
+	c->backoff = 1;
+	return n;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       decompress_block
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int decompress_block (const char *src, int len, char *dst, int dst_cap)
+ *
+ * RETURNS:        int - decompressed length, -1 if the block is corrupt or too large
+ *
+ * NOTES:
+ * Decodes one compressed block; every length and offset is checked against both buffers
+ * -----------------------------------------------------------------------*/
+int decompress_block (const char *src, int len, char *dst, int dst_cap)
+{
+	const unsigned char	*ip = (const unsigned char *)src, *ip_end = ip + len;
+	unsigned char		*op = (unsigned char *)dst, *op_end = op + dst_cap, *match;
+	int					token, run, byte;
+	unsigned			distance;
+
+	while (ip < ip_end)
+	{
+		token = *ip++;
+
+		// Literals
+		run = token >> 4;
+		if (run == 15)
+		{
+			do
+			{
+				if (ip == ip_end)
+				{
+					return -1;
+				}
+				byte = *ip++;
+				run += byte;
+			} while (byte == 255);
+		}
+		if (run > ip_end - ip || run > op_end - op)
+		{
+			return -1;
+		}
+		memcpy(op, ip, run);
+		ip += run;
+		op += run;
+		if (ip == ip_end)
+		{
+			break;
+		}
+
+		// Match
+		if (ip_end - ip < 2)
+		{
+			return -1;
+		}
+		distance = ip[0] | (ip[1] << 8);
+		ip += 2;
+		run = token & 15;
+		if (run == 15)
+		{
+			do
+			{
+				if (ip == ip_end)
+				{
+					return -1;
+				}
+				byte = *ip++;
+				run += byte;
+			} while (byte == 255);
+		}
+		run += MIN_MATCH;
+		if (distance == 0 || distance > (unsigned)(op - (unsigned char *)dst) || run > op_end - op)
+		{
+			return -1;
+		}
+		// Matches may overlap the bytes they produce, so copy forwards a byte at a time
+		for (match = op - distance; run > 0; run--)
+		{
+			*op++ = *match++;
+		}
+	}
+	return op - (unsigned char *)dst;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       lz_compress
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int lz_compress (struct compressor *c, const unsigned char *src, int len,
+ *                                  unsigned char *dst, int dst_cap)
+ *
+ * RETURNS:        int - compressed length, 0 if it wouldn't fit in dst_cap bytes
+ *
+ * NOTES:
+ * Greedy LZ77 over hash chains. Each position is hashed on its first four bytes; the chain of
+ * earlier positions with that hash is searched up to a depth set by the level and the longest
+ * match taken.
+ * -----------------------------------------------------------------------*/
+int lz_compress (struct compressor *c, const unsigned char *src, int len, unsigned char *dst, int dst_cap)
+{
+	unsigned char	*op = dst, *op_end = dst + dst_cap, *token;
+	uint32_t		word, h;
+	int				ip = 0, anchor = 0, candidate, depth, max_depth, best_len, best_distance, n, i;
+
+	max_depth = 1 << (c->level - 1);
+	memset(c->head, 0xFF, HASH_SIZE * sizeof(int));
+
+	while (ip + MIN_MATCH <= len)
+	{
+		memcpy(&word, src + ip, sizeof(word));
+		h = (word * 2654435761u) >> (32 - HASH_BITS);
+
+		// Search the chain for the longest match
+		best_len = 0;
+		best_distance = 0;
+		candidate = c->head[h];
+		for (depth = 0; candidate >= 0 && ip - candidate <= MAX_DISTANCE && depth < max_depth; depth++)
+		{
+			if (memcmp(src + candidate, src + ip, MIN_MATCH) == 0)
+			{
+				for (n = MIN_MATCH; ip + n < len && src[candidate + n] == src[ip + n]; n++)
+				{
+				}
+				if (n > best_len)
+				{
+					best_len = n;
+					best_distance = ip - candidate;
+				}
+			}
+			if (c->prev[candidate & WINDOW_MASK] == 0)
+			{
+				break;
+			}
+			candidate -= c->prev[candidate & WINDOW_MASK];
+		}
+
+		// Add this position to its chain
+		c->prev[ip & WINDOW_MASK] = (c->head[h] >= 0 && ip - c->head[h] <= MAX_DISTANCE) ? ip - c->head[h] : 0;
+		c->head[h] = ip;
+
+		if (best_len < MIN_MATCH)
+		{
+			ip++;
+			continue;
+		}
+
+		// Token, literals, offset, then the rest of the match length
+		token = op++;
+		if (op > op_end || (op = put_length(op, op_end, ip - anchor)) == NULL || ip - anchor + 2 > op_end - op)
+		{
+			return 0;
+		}
+		memcpy(op, src + anchor, ip - anchor);
+		op += ip - anchor;
+		*op++ = best_distance & 0xFF;
+		*op++ = best_distance >> 8;
+		*token = ((ip - anchor < 15 ? ip - anchor : 15) << 4) | (best_len - MIN_MATCH < 15 ? best_len - MIN_MATCH : 15);
+		if (best_len - MIN_MATCH >= 15 && (op = put_length(op, op_end, best_len - MIN_MATCH)) == NULL)
+		{
+			return 0;
+		}
+
+		// Deeper levels also index the positions the match covers
+		if (c->level > 1)
+		{
+			for (i = ip + 1; i < ip + best_len && i + MIN_MATCH <= len; i++)
+			{
+				memcpy(&word, src + i, sizeof(word));
+				h = (word * 2654435761u) >> (32 - HASH_BITS);
+				c->prev[i & WINDOW_MASK] = (c->head[h] >= 0 && i - c->head[h] <= MAX_DISTANCE) ? i - c->head[h] : 0;
+				c->head[h] = i;
+			}
+		}
+		ip += best_len;
+		anchor = ip;
+	}
+
+	// Whatever is left goes out as literals
+	token = op++;
+	if (op > op_end || (op = put_length(op, op_end, len - anchor)) == NULL || len - anchor > op_end - op)
+	{
+		return 0;
+	}
+	*token = (len - anchor < 15 ? len - anchor : 15) << 4;
+	memcpy(op, src + anchor, len - anchor);
+	op += len - anchor;
+	return op - dst;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       put_length
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      unsigned char *put_length (unsigned char *op, unsigned char *op_end, int len)
+ *
+ * RETURNS:        unsigned char * - the next output byte, NULL if the output is full
+ *
+ * NOTES:
+ * Writes the part of a literal count or match length that doesn't fit in its token nibble:
+ * bytes of 255 followed by the remainder. Nothing is written for lengths under 15.
+ * -----------------------------------------------------------------------*/
+unsigned char *put_length (unsigned char *op, unsigned char *op_end, int len)
+{
+	if (len < 15)
+	{
+		return op;
+	}
+	for (len -= 15; len >= 255; len -= 255)
+	{
+		if (op == op_end)
+		{
+			return NULL;
+		}
+		*op++ = 255;
+	}
+	if (op == op_end)
+	{
+		return NULL;
+	}
+	*op++ = len;
+	return op;
+}
@@ -0,0 +1,53 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	compress.h - Block compression for file data on the wire
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		compressor_init (struct compressor *c, int level);
+--					compressor_free (struct compressor *c);
+--					compress_next (struct compressor *c);
+--					compress_block (struct compressor *c, const char *src, int len, char *dst, int dst_cap);
+--					decompress_block (const char *src, int len, char *dst, int dst_cap);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- A small LZ77 codec in the LZ4 block layout: each sequence is a token (literal count,
+-- match length), the literals, and a 16-bit little-endian match offset into the 64 KB
+-- before it. The last sequence has literals only. Every block is compressed on its own,
+-- so a receiver can decode any DATA frame without the frames before it.
+--
+-- The level (1 - 9) sets how many earlier positions are searched for each match; level 1
+-- only tries the most recent one and runs at memory speed. A compressor samples the data:
+-- after a block that doesn't shrink by at least an eighth it sends the following blocks
+-- raw, twice as many each time it samples poorly again, so incompressible files cost
+-- almost no CPU.
+---------------------------------------------------------------------------------------*/
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#define COMPRESS_MAX_LEVEL		9
+
+struct compressor
+{
+	int		level;			// 0 when compression is off
+	int		skip;			// Blocks still to be sent raw
+	int		backoff;		// Raw blocks after the next poor sample
+	int		*head;			// Latest position of each hash
+	unsigned short	*prev;	// Distance to the previous position with the same hash
+};
+
+int compressor_init (struct compressor *c, int level);
+void compressor_free (struct compressor *c);
+int compress_next (struct compressor *c);
+int compress_block (struct compressor *c, const char *src, int len, char *dst, int dst_cap);
+int decompress_block (const char *src, int len, char *dst, int dst_cap);
+
+#endif
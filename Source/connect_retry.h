@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	connect_retry.h - Connection establishment with bounded retries
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		connect_with_retry (int socket, const struct sockaddr *remote_entity, socklen_t remote_entity_len, const struct retry_policy *policy);
+--					backoff_start (struct backoff *backoff, const struct retry_policy *policy);
+--					backoff_next_delay (struct backoff *backoff, const struct retry_policy *policy);
+--					now_ms (void);
+--					now_ns (void);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- Failed connection attempts are retried after an exponentially growing, jittered delay
+-- that starts in the milliseconds. A retry policy caps the number of attempts, the time a
+-- single attempt may take and the overall time spent, so callers get an error back instead
+-- of waiting on a dead peer forever.
+---------------------------------------------------------------------------------------*/
+#ifndef CONNECT_RETRY_H
+#define CONNECT_RETRY_H
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+struct retry_policy
+{
+	int	initial_delay_ms;		// Wait before the first retry
+	int	max_delay_ms;			// Cap on the wait between retries
+	int	max_attempts;			// Connection attempts before giving up; 0 for no limit
+	int	attempt_timeout_ms;		// Time one attempt may stay in progress
+	int	deadline_ms;			// Time all attempts together may take; 0 for no limit
+};
+
+// 10 ms doubling to 2 s, at most 12 attempts within 30 s
+#define DEFAULT_RETRY_POLICY	{ 10, 2000, 12, 3000, 30000 }
+
+struct backoff
+{
+	int				attempts;		// Attempts made so far
+	int				delay_ms;		// Un-jittered wait before the next attempt
+	long long		deadline;		// now_ms() value when retrying stops; 0 for none
+	unsigned int	seed;			// Jitter state
+};
+
+int connect_with_retry (int socket, const struct sockaddr *remote_entity, socklen_t remote_entity_len, const struct retry_policy *policy);
+void backoff_start (struct backoff *backoff, const struct retry_policy *policy);
+int backoff_next_delay (struct backoff *backoff, const struct retry_policy *policy);
+long long now_ms (void);
+long long now_ns (void);
+
+#endif
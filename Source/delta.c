@@ -0,0 +1,364 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	delta.c - Block signatures and matching for delta uploads
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		weak_checksum (const unsigned char *data, int len);
+--					weak_roll (uint32_t sum, int len, unsigned char out, unsigned char in);
+--					strong_hash (const unsigned char *data, int len);
+--					encode_signature (char *buf, const unsigned char *block, int len);
+--					signature_table_init (struct signature_table *table, const char *signatures, int count);
+--					signature_table_find (const struct signature_table *table, uint32_t weak, const unsigned char *block, int len);
+--					signature_table_free (struct signature_table *table);
+--					xxh64_round (uint64_t acc, uint64_t input);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The signature format and matching scheme are described in delta.h
+---------------------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "delta.h"
+
+// XXH64 primes
+#define PRIME64_1	0x9E3779B185EBCA87ULL
+#define PRIME64_2	0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3	0x165667B19E3779F9ULL
+#define PRIME64_4	0x85EBCA77C2B2AE63ULL
+#define PRIME64_5	0x27D4EB2F165667C5ULL
+
+#define ROTL64(x, r)	(((x) << (r)) | ((x) >> (64 - (r))))
+
+uint64_t xxh64_round (uint64_t acc, uint64_t input);
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       weak_checksum
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint32_t weak_checksum (const unsigned char *data, int len)
+ *
+ * RETURNS:        uint32_t - the sum of the bytes in the low 16 bits, the sum of their
+ *                            prefix sums in the high 16 bits
+ *
+ * NOTES:
+ * Weak checksum of a block, which weak_roll can then slide along the data a byte at a time
+ * -----------------------------------------------------------------------*/
+uint32_t weak_checksum (const unsigned char *data, int len)
+{
+	uint32_t	s1 = 0, s2 = 0;
+	int			i;
+
+	for (i = 0; i < len; i++)
+	{
+		s1 += data[i];
+		s2 += s1;
+	}
+	return (s1 & 0xFFFF) | (s2 << 16);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       weak_roll
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint32_t weak_roll (uint32_t sum, int len, unsigned char out, unsigned char in)
+ *
+ * RETURNS:        uint32_t - weak checksum of the window moved one byte on
+ *
+ * NOTES:
+ * Moves the len byte window of a weak checksum forward by one byte: out leaves the window
+ * at its start and in joins it at its end
+ * -----------------------------------------------------------------------*/
+uint32_t weak_roll (uint32_t sum, int len, unsigned char out, unsigned char in)
+{
+	uint32_t s1 = sum & 0xFFFF, s2 = sum >> 16;
+
+	s1 = s1 - out + in;
+	s2 = s2 - (uint32_t)len * out + s1;
+	return (s1 & 0xFFFF) | (s2 << 16);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       strong_hash
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint64_t strong_hash (const unsigned char *data, int len)
+ *
+ * RETURNS:        uint64_t
+ *
+ * NOTES:
+ * XXH64 of a block with a zero seed. Words are read in host order, so hosts of different
+ * byte orders find no matches, which costs bandwidth but never corrupts a file.
+ * -----------------------------------------------------------------------*/
+uint64_t strong_hash (const unsigned char *data, int len)
+{
+	const unsigned char	*p = data, *end = data + len;
+	uint64_t			v1, v2, v3, v4, h, word;
+	uint32_t			half;
+
+	if (len >= 32)
+	{
+		v1 = PRIME64_1 + PRIME64_2;
+		v2 = PRIME64_2;
+		v3 = 0;
+		v4 = -PRIME64_1;
+		for (; end - p >= 32; p += 32)
+		{
+			memcpy(&word, p, 8);
+			v1 = xxh64_round(v1, word);
+			memcpy(&word, p + 8, 8);
+			v2 = xxh64_round(v2, word);
+			memcpy(&word, p + 16, 8);
+			v3 = xxh64_round(v3, word);
+			memcpy(&word, p + 24, 8);
+			v4 = xxh64_round(v4, word);
+		}
+		h = ROTL64(v1, 1) + ROTL64(v2, 7) + ROTL64(v3, 12) + ROTL64(v4, 18);
+		h = (h ^ xxh64_round(0, v1)) * PRIME64_1 + PRIME64_4;
+		h = (h ^ xxh64_round(0, v2)) * PRIME64_1 + PRIME64_4;
+		h = (h ^ xxh64_round(0, v3)) * PRIME64_1 + PRIME64_4;
+		h = (h ^ xxh64_round(0, v4)) * PRIME64_1 + PRIME64_4;
+	}
+	else
+	{
+		h = PRIME64_5;
+	}
+	h += (uint64_t)len;
+
+	for (; end - p >= 8; p += 8)
+	{
+		memcpy(&word, p, 8);
+		h ^= xxh64_round(0, word);
+		h = ROTL64(h, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (end - p >= 4)
+	{
+		memcpy(&half, p, 4);
+		h ^= (uint64_t)half * PRIME64_1;
+		h = ROTL64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++)
+	{
+		h ^= *p * PRIME64_5;
+		h = ROTL64(h, 11) * PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       encode_signature
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void encode_signature (char *buf, const unsigned char *block, int len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Signs a block into the SIGNATURE_LEN bytes at buf
+ * -----------------------------------------------------------------------*/
+void encode_signature (char *buf, const unsigned char *block, int len)
+{
+	uint32_t	weak = htonl(weak_checksum(block, len));
+	uint64_t	strong = strong_hash(block, len);
+	uint32_t	high = htonl((uint32_t)(strong >> 32)), low = htonl((uint32_t)strong);
+
+	memcpy(buf, &weak, 4);
+	memcpy(buf + 4, &high, 4);
+	memcpy(buf + 8, &low, 4);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       signature_table_init
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int signature_table_init (struct signature_table *table, const char *signatures, int count)
+ *
+ * RETURNS:        int - 0 on success, -1 if the table can't be allocated
+ *
+ * NOTES:
+ * Decodes count signatures and hashes them on their weak checksums, with at least twice as
+ * many buckets as signatures. Equal blocks keep the lowest index.
+ * -----------------------------------------------------------------------*/
+int signature_table_init (struct signature_table *table, const char *signatures, int count)
+{
+	uint32_t	weak, high, low, buckets;
+	int			i;
+
+	for (buckets = 16; buckets < (uint32_t)count * 2; buckets *= 2)
+	{
+	}
+	table->count = count;
+	table->mask = buckets - 1;
+	table->heads = malloc(buckets * sizeof(int));
+	table->next = malloc((count + 1) * sizeof(int));
+	table->weak = malloc((count + 1) * sizeof(uint32_t));
+	table->strong = malloc((count + 1) * sizeof(uint64_t));
+	if (table->heads == NULL || table->next == NULL || table->weak == NULL || table->strong == NULL)
+	{
+		signature_table_free(table);
+		return -1;
+	}
+	memset(table->heads, 0xFF, buckets * sizeof(int));
+
+	// Insert from the last block so each bucket lists its blocks in order
+	for (i = count - 1; i >= 0; i--)
+	{
+		memcpy(&weak, signatures + i * SIGNATURE_LEN, 4);
+		memcpy(&high, signatures + i * SIGNATURE_LEN + 4, 4);
+		memcpy(&low, signatures + i * SIGNATURE_LEN + 8, 4);
+		table->weak[i] = ntohl(weak);
+		table->strong[i] = ((uint64_t)ntohl(high) << 32) | ntohl(low);
+		table->next[i] = table->heads[table->weak[i] & table->mask];
+		table->heads[table->weak[i] & table->mask] = i;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       signature_table_find
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int signature_table_find (const struct signature_table *table, uint32_t weak,
+ *                                           const unsigned char *block, int len)
+ *
+ * RETURNS:        int - index of the receiver's block equal to block, -1 if there is none
+ *
+ * NOTES:
+ * Looks a window up by its weak checksum; the strong hash is only computed when some
+ * signature has the same weak checksum
+ * -----------------------------------------------------------------------*/
+int signature_table_find (const struct signature_table *table, uint32_t weak, const unsigned char *block, int len)
+{
+	uint64_t	strong = 0;
+	int			i, hashed = 0;
+
+	for (i = table->heads[weak & table->mask]; i != -1; i = table->next[i])
+	{
+		if (table->weak[i] != weak)
+		{
+			continue;
+		}
+		if (!hashed)
+		{
+			strong = strong_hash(block, len);
+			hashed = 1;
+		}
+		if (table->strong[i] == strong)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       signature_table_free
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void signature_table_free (struct signature_table *table)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Frees a signature table
+ * -----------------------------------------------------------------------*/
+void signature_table_free (struct signature_table *table)
+{
+	free(table->heads);
+	free(table->next);
+	free(table->weak);
+	free(table->strong);
+	table->heads = table->next = NULL;
+	table->weak = NULL;
+	table->strong = NULL;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       xxh64_round
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint64_t xxh64_round (uint64_t acc, uint64_t input)
+ *
+ * RETURNS:        uint64_t
+ *
+ * NOTES:
+ * Mixes one 64-bit word into an XXH64 accumulator
+ * -----------------------------------------------------------------------*/
+uint64_t xxh64_round (uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME64_2;
+	acc = ROTL64(acc, 31);
+	return acc * PRIME64_1;
+}
@@ -0,0 +1,61 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	delta.h - Block signatures and matching for delta uploads
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		weak_checksum (const unsigned char *data, int len);
+--					weak_roll (uint32_t sum, int len, unsigned char out, unsigned char in);
+--					strong_hash (const unsigned char *data, int len);
+--					encode_signature (char *buf, const unsigned char *block, int len);
+--					signature_table_init (struct signature_table *table, const char *signatures, int count);
+--					signature_table_find (const struct signature_table *table, uint32_t weak, const unsigned char *block, int len);
+--					signature_table_free (struct signature_table *table);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The receiver of a delta upload signs every block of its current copy with a weak,
+-- rolling checksum (the rsync sum of bytes and of prefix sums, 16 bits each) and a strong
+-- 64-bit hash (XXH64). The sender slides a block-sized window over its file one byte at a
+-- time, updating the weak checksum in constant time, and only hashes a window whose weak
+-- checksum matches a signature. Windows found in the receiver's copy are sent as block
+-- references; everything else is sent as literal bytes.
+--
+-- A signature is SIGNATURE_LEN bytes: the weak checksum and the strong hash, big-endian.
+---------------------------------------------------------------------------------------*/
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <stdint.h>
+
+#define SIGNATURE_LEN		12
+#define DELTA_MIN_BLOCK		512
+#define DELTA_MAX_BLOCK		(64 * 1024)
+
+// Signatures of the receiver's blocks, hashed on their weak checksums
+struct signature_table
+{
+	int			count;
+	int			*heads;			// First signature of each bucket, -1 if none
+	int			*next;			// Next signature in the same bucket
+	uint32_t	*weak;
+	uint64_t	*strong;
+	uint32_t	mask;
+};
+
+uint32_t weak_checksum (const unsigned char *data, int len);
+uint32_t weak_roll (uint32_t sum, int len, unsigned char out, unsigned char in);
+uint64_t strong_hash (const unsigned char *data, int len);
+void encode_signature (char *buf, const unsigned char *block, int len);
+int signature_table_init (struct signature_table *table, const char *signatures, int count);
+int signature_table_find (const struct signature_table *table, uint32_t weak, const unsigned char *block, int len);
+void signature_table_free (struct signature_table *table);
+
+#endif
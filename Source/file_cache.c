@@ -0,0 +1,412 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	file_cache.c - In-memory cache of the files served by GET
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		file_cache_init (struct file_cache *cache, size_t capacity);
+--					file_cache_acquire (struct file_cache *cache, const char *path);
+--					file_cache_release (struct file_cache *cache, struct cached_file *file);
+--					load_cached_file (struct cached_file *file, char **data);
+--					unindex_cached_file (struct file_cache *cache, struct cached_file *file);
+--					drop_cached_file (struct file_cache *cache, struct cached_file *file);
+--					same_version (const struct cached_file *file, const struct stat *st);
+--					path_hash (const char *path);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The caching policy is described in file_cache.h. Files are loaded outside the cache's
+-- lock; while one thread loads a file, other lookups of it miss instead of waiting, so an
+-- event loop never stalls on another thread's read.
+---------------------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "file_cache.h"
+
+#define TRUE	1
+#define FALSE	0
+
+int load_cached_file (struct cached_file *file, char **data);
+void unindex_cached_file (struct file_cache *cache, struct cached_file *file);
+void drop_cached_file (struct file_cache *cache, struct cached_file *file);
+int same_version (const struct cached_file *file, const struct stat *st);
+unsigned int path_hash (const char *path);
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       file_cache_init
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void file_cache_init (struct file_cache *cache, size_t capacity)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sets up an empty cache holding at most capacity bytes of file data
+ * -----------------------------------------------------------------------*/
+void file_cache_init (struct file_cache *cache, size_t capacity)
+{
+	memset(cache, 0, sizeof(*cache));
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->capacity = capacity;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       file_cache_acquire
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      struct cached_file *file_cache_acquire (struct file_cache *cache, const char *path)
+ *
+ * RETURNS:        struct cached_file * - the file's cached copy, NULL if the caller should
+ *                                        read the file itself
+ *
+ * NOTES:
+ * Finds the current version of a file in the cache, loading it on a miss when it fits. The
+ * copy stays valid until it is handed back with file_cache_release.
+ * -----------------------------------------------------------------------*/
+struct cached_file *file_cache_acquire (struct file_cache *cache, const char *path)
+{
+	struct cached_file	*file, *victim, *prev;
+	struct stat			st;
+	unsigned int		bucket;
+	char				*data;
+
+	if (cache->capacity == 0 || strlen(path) >= FILE_CACHE_PATH_LEN || stat(path, &st) == -1 || !S_ISREG(st.st_mode))
+	{
+		return NULL;
+	}
+	bucket = path_hash(path) & (FILE_CACHE_BUCKETS - 1);
+
+	pthread_mutex_lock(&cache->lock);
+	for (file = cache->buckets[bucket]; file != NULL && strcmp(file->path, path) != 0; file = file->hash_next)
+	{
+	}
+	if (file != NULL && same_version(file, &st))
+	{
+		// Still being loaded by another thread
+		if (file->data == NULL)
+		{
+			pthread_mutex_unlock(&cache->lock);
+			return NULL;
+		}
+		cache->hits++;
+		file->refs++;
+		if (cache->lru_head != file)
+		{
+			file->lru_prev->lru_next = file->lru_next;
+			if (file->lru_next != NULL)
+			{
+				file->lru_next->lru_prev = file->lru_prev;
+			}
+			else
+			{
+				cache->lru_tail = file->lru_prev;
+			}
+			file->lru_prev = NULL;
+			file->lru_next = cache->lru_head;
+			cache->lru_head->lru_prev = file;
+			cache->lru_head = file;
+		}
+		pthread_mutex_unlock(&cache->lock);
+		return file;
+	}
+
+	cache->misses++;
+	if (file != NULL)
+	{
+		unindex_cached_file(cache, file);
+	}
+	if (st.st_size == 0 || (size_t)st.st_size > cache->capacity / 4)
+	{
+		pthread_mutex_unlock(&cache->lock);
+		return NULL;
+	}
+	for (victim = cache->lru_tail; victim != NULL && cache->used + st.st_size > cache->capacity; victim = prev)
+	{
+		prev = victim->lru_prev;
+		if (victim->refs == 0)
+		{
+			unindex_cached_file(cache, victim);
+		}
+	}
+	if (cache->used + st.st_size > cache->capacity || (file = calloc(1, sizeof(*file))) == NULL)
+	{
+		pthread_mutex_unlock(&cache->lock);
+		return NULL;
+	}
+
+	// Index the file before loading it so concurrent lookups know not to load it too
+	strcpy(file->path, path);
+	file->dev = st.st_dev;
+	file->ino = st.st_ino;
+	file->size = st.st_size;
+	file->mtime = st.st_mtim;
+	file->ctime = st.st_ctim;
+	file->refs = 1;
+	file->indexed = TRUE;
+	file->hash_next = cache->buckets[bucket];
+	cache->buckets[bucket] = file;
+	file->lru_next = cache->lru_head;
+	if (cache->lru_head != NULL)
+	{
+		cache->lru_head->lru_prev = file;
+	}
+	else
+	{
+		cache->lru_tail = file;
+	}
+	cache->lru_head = file;
+	cache->used += file->size;
+	pthread_mutex_unlock(&cache->lock);
+
+	if (load_cached_file(file, &data) == -1)
+	{
+		pthread_mutex_lock(&cache->lock);
+		if (file->indexed)
+		{
+			unindex_cached_file(cache, file);
+		}
+		file->refs--;
+		drop_cached_file(cache, file);
+		pthread_mutex_unlock(&cache->lock);
+		return NULL;
+	}
+	pthread_mutex_lock(&cache->lock);
+	file->data = data;
+	pthread_mutex_unlock(&cache->lock);
+	return file;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       file_cache_release
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void file_cache_release (struct file_cache *cache, struct cached_file *file)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Hands back a copy taken with file_cache_acquire; a copy that is no longer indexed is freed
+ * with its last user
+ * -----------------------------------------------------------------------*/
+void file_cache_release (struct file_cache *cache, struct cached_file *file)
+{
+	pthread_mutex_lock(&cache->lock);
+	file->refs--;
+	drop_cached_file(cache, file);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       load_cached_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int load_cached_file (struct cached_file *file, char **data)
+ *
+ * RETURNS:        int - 0 on success, -1 if the file can't be read or isn't the version
+ *                       that was indexed any more
+ *
+ * NOTES:
+ * Reads the whole file into a new buffer returned in data
+ * -----------------------------------------------------------------------*/
+int load_cached_file (struct cached_file *file, char **data)
+{
+	struct stat	st;
+	ssize_t		n;
+	off_t		got;
+	int			fd;
+
+	if ((fd = open(file->path, O_RDONLY)) == -1)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) == -1 || !same_version(file, &st) || (*data = malloc(file->size)) == NULL)
+	{
+		close(fd);
+		return -1;
+	}
+	for (got = 0; got < file->size; got += n)
+	{
+		if ((n = pread(fd, *data + got, file->size - got, got)) <= 0)
+		{
+			if (n == -1 && errno == EINTR)
+			{
+				n = 0;
+				continue;
+			}
+			free(*data);
+			close(fd);
+			return -1;
+		}
+	}
+	close(fd);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       unindex_cached_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void unindex_cached_file (struct file_cache *cache, struct cached_file *file)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Removes a copy from the lookup table and the LRU list; called with the lock held
+ * -----------------------------------------------------------------------*/
+void unindex_cached_file (struct file_cache *cache, struct cached_file *file)
+{
+	struct cached_file **link;
+
+	for (link = &cache->buckets[path_hash(file->path) & (FILE_CACHE_BUCKETS - 1)]; *link != file; link = &(*link)->hash_next)
+	{
+	}
+	*link = file->hash_next;
+	if (file->lru_prev != NULL)
+	{
+		file->lru_prev->lru_next = file->lru_next;
+	}
+	else
+	{
+		cache->lru_head = file->lru_next;
+	}
+	if (file->lru_next != NULL)
+	{
+		file->lru_next->lru_prev = file->lru_prev;
+	}
+	else
+	{
+		cache->lru_tail = file->lru_prev;
+	}
+	file->indexed = FALSE;
+	drop_cached_file(cache, file);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       drop_cached_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void drop_cached_file (struct file_cache *cache, struct cached_file *file)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Frees a copy once it is neither indexed nor used; called with the lock held
+ * -----------------------------------------------------------------------*/
+void drop_cached_file (struct file_cache *cache, struct cached_file *file)
+{
+	if (file->indexed || file->refs > 0)
+	{
+		return;
+	}
+	cache->used -= file->size;
+	free(file->data);
+	free(file);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       same_version
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int same_version (const struct cached_file *file, const struct stat *st)
+ *
+ * RETURNS:        int - TRUE if st describes the file the copy was taken from, unchanged
+ *
+ * NOTES:
+ * The ctime catches rewrites that keep the size and restore the mtime
+ * -----------------------------------------------------------------------*/
+int same_version (const struct cached_file *file, const struct stat *st)
+{
+	return file->dev == st->st_dev && file->ino == st->st_ino && file->size == st->st_size &&
+		file->mtime.tv_sec == st->st_mtim.tv_sec && file->mtime.tv_nsec == st->st_mtim.tv_nsec &&
+		file->ctime.tv_sec == st->st_ctim.tv_sec && file->ctime.tv_nsec == st->st_ctim.tv_nsec;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       path_hash
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      unsigned int path_hash (const char *path)
+ *
+ * RETURNS:        unsigned int
+ *
+ * NOTES:
+ * FNV-1a hash of a path
+ * -----------------------------------------------------------------------*/
+unsigned int path_hash (const char *path)
+{
+	unsigned int hash = 2166136261u;
+
+	for (; *path != '\0'; path++)
+	{
+		hash = (hash ^ (unsigned char)*path) * 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,71 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	file_cache.h - In-memory cache of the files served by GET
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		file_cache_init (struct file_cache *cache, size_t capacity);
+--					file_cache_acquire (struct file_cache *cache, const char *path);
+--					file_cache_release (struct file_cache *cache, struct cached_file *file);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The cache holds whole copies of requested files in memory, up to a byte capacity shared
+-- by all worker threads. The first GET of a file loads it; later GETs are served from
+-- memory until the file changes on disk or it is evicted, least recently used first, to
+-- make room for another. Files larger than a quarter of the capacity are never cached.
+--
+-- Every lookup stats the file and compares its inode, size, mtime and ctime with the
+-- cached copy's, so a file replaced or rewritten on disk is loaded again. A transfer keeps
+-- the copy it started with until it releases it, whatever happens to the file meanwhile.
+---------------------------------------------------------------------------------------*/
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+
+#define FILE_CACHE_BUCKETS		64		// Must be a power of two
+#define FILE_CACHE_PATH_LEN		256
+
+struct cached_file
+{
+	char				path[FILE_CACHE_PATH_LEN];
+	dev_t				dev;
+	ino_t				ino;
+	off_t				size;
+	struct timespec		mtime;
+	struct timespec		ctime;
+	char				*data;			// NULL while the file is being loaded
+	int					refs;			// Transfers using the copy
+	int					indexed;		// Still found by lookups; cleared when replaced or evicted
+	struct cached_file	*hash_next;
+	struct cached_file	*lru_prev;		// Towards the most recently used
+	struct cached_file	*lru_next;
+};
+
+struct file_cache
+{
+	pthread_mutex_t		lock;
+	size_t				capacity;		// 0 disables the cache
+	size_t				used;			// Bytes held by cached copies, indexed or not
+	struct cached_file	*buckets[FILE_CACHE_BUCKETS];
+	struct cached_file	*lru_head;		// Most recently used
+	struct cached_file	*lru_tail;
+	unsigned long long	hits;
+	unsigned long long	misses;
+};
+
+void file_cache_init (struct file_cache *cache, size_t capacity);
+struct cached_file *file_cache_acquire (struct file_cache *cache, const char *path);
+void file_cache_release (struct file_cache *cache, struct cached_file *file);
+
+#endif
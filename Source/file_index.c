@@ -0,0 +1,500 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	file_index.c - In-memory index of the files in the server's root directory
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		file_index_init (struct file_index *index, const char *root);
+--					file_index_lookup (struct file_index *index, const char *name, struct file_entry *entry);
+--					file_index_refresh (struct file_index *index, const char *name);
+--					scan_directory (struct file_index *index);
+--					watch_main (void *arg);
+--					store_entry (struct file_index *index, const char *name, const struct stat *st);
+--					remove_entry (struct file_index *index, const char *name);
+--					grow_index (struct file_index *index);
+--					free_entries (struct file_entry **buckets, size_t mask);
+--					name_hash (const char *name);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The indexing policy is described in file_index.h. One detached thread reads the inotify
+-- events and applies them; a rescan builds a new table without the lock and swaps it in,
+-- so lookups never wait on the directory.
+---------------------------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "file_index.h"
+
+// Changes to the directory that can add, replace or remove a file
+#define WATCH_EVENTS	(IN_CREATE | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE)
+#define WATCH_BUFLEN	(64 * (sizeof(struct inotify_event) + FILE_NAME_LEN))
+
+int scan_directory (struct file_index *index);
+void *watch_main (void *arg);
+int store_entry (struct file_index *index, const char *name, const struct stat *st);
+void remove_entry (struct file_index *index, const char *name);
+void grow_index (struct file_index *index);
+void free_entries (struct file_entry **buckets, size_t mask);
+unsigned int name_hash (const char *name);
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       file_index_init
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int file_index_init (struct file_index *index, const char *root)
+ *
+ * RETURNS:        int - 0 on success, -1 if the directory can't be read (errno is set)
+ *
+ * NOTES:
+ * Indexes the files of root and starts watching it. Without inotify the index still
+ * follows the files the server stores, just not changes made by anyone else.
+ * -----------------------------------------------------------------------*/
+int file_index_init (struct file_index *index, const char *root)
+{
+	pthread_t thread;
+
+	memset(index, 0, sizeof(*index));
+	pthread_mutex_init(&index->lock, NULL);
+	index->watch_fd = -1;
+	if ((index->dir_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+	{
+		return -1;
+	}
+
+	// Watch before scanning, so nothing changed in between goes unnoticed
+	if ((index->watch_fd = inotify_init1(IN_CLOEXEC)) == -1 || inotify_add_watch(index->watch_fd, root, WATCH_EVENTS) == -1)
+	{
+		perror("[-]Can't watch the root directory");
+		if (index->watch_fd != -1)
+		{
+			close(index->watch_fd);
+			index->watch_fd = -1;
+		}
+	}
+	if (scan_directory(index) == -1)
+	{
+		return -1;
+	}
+	if (index->watch_fd != -1)
+	{
+		if ((errno = pthread_create(&thread, NULL, watch_main, index)) != 0)
+		{
+			perror("[-]Can't start the index thread");
+			close(index->watch_fd);
+			index->watch_fd = -1;
+		}
+		else
+		{
+			pthread_detach(thread);
+		}
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       file_index_lookup
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int file_index_lookup (struct file_index *index, const char *name, struct file_entry *entry)
+ *
+ * RETURNS:        int - 0 if the file is indexed, -1 if not
+ *
+ * NOTES:
+ * Copies the index entry of a file into entry
+ * -----------------------------------------------------------------------*/
+int file_index_lookup (struct file_index *index, const char *name, struct file_entry *entry)
+{
+	struct file_entry	*found;
+	int					result = -1;
+
+	pthread_mutex_lock(&index->lock);
+	for (found = index->buckets[name_hash(name) & index->mask]; found != NULL; found = found->next)
+	{
+		if (strcmp(found->name, name) == 0)
+		{
+			*entry = *found;
+			entry->next = NULL;
+			result = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&index->lock);
+	return result;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       file_index_refresh
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void file_index_refresh (struct file_index *index, const char *name)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Brings the entry of one file up to date with the directory: indexes it if it is a regular
+ * file, and drops it if it is gone. The file is stated under the lock, so two refreshes of
+ * the same file can't store their results out of order.
+ * -----------------------------------------------------------------------*/
+void file_index_refresh (struct file_index *index, const char *name)
+{
+	struct stat st;
+
+	if (!valid_file_name(name))
+	{
+		return;
+	}
+	pthread_mutex_lock(&index->lock);
+	if (fstatat(index->dir_fd, name, &st, 0) == 0 && S_ISREG(st.st_mode))
+	{
+		store_entry(index, name, &st);
+	}
+	else
+	{
+		remove_entry(index, name);
+	}
+	pthread_mutex_unlock(&index->lock);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       scan_directory
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int scan_directory (struct file_index *index)
+ *
+ * RETURNS:        int - 0 on success, -1 if the directory can't be read (errno is set)
+ *
+ * NOTES:
+ * Indexes every file of the directory into a new table, then replaces the index's table
+ * with it
+ * -----------------------------------------------------------------------*/
+int scan_directory (struct file_index *index)
+{
+	struct file_index	fresh;
+	struct file_entry	**old;
+	struct dirent		*dent;
+	struct stat			st;
+	size_t				old_mask;
+	DIR					*dir;
+	int					fd;
+
+	memset(&fresh, 0, sizeof(fresh));
+	fresh.mask = FILE_INDEX_MIN_BUCKETS - 1;
+	if ((fresh.buckets = calloc(FILE_INDEX_MIN_BUCKETS, sizeof(struct file_entry *))) == NULL)
+	{
+		return -1;
+	}
+	if ((fd = dup(index->dir_fd)) == -1 || (dir = fdopendir(fd)) == NULL)
+	{
+		if (fd != -1)
+		{
+			close(fd);
+		}
+		free(fresh.buckets);
+		return -1;
+	}
+	rewinddir(dir);
+	while ((dent = readdir(dir)) != NULL)
+	{
+		if (valid_file_name(dent->d_name) && fstatat(index->dir_fd, dent->d_name, &st, 0) == 0 && S_ISREG(st.st_mode))
+		{
+			store_entry(&fresh, dent->d_name, &st);
+		}
+	}
+	closedir(dir);
+
+	pthread_mutex_lock(&index->lock);
+	old = index->buckets;
+	old_mask = index->mask;
+	index->buckets = fresh.buckets;
+	index->mask = fresh.mask;
+	index->count = fresh.count;
+	pthread_mutex_unlock(&index->lock);
+	if (old != NULL)
+	{
+		free_entries(old, old_mask);
+	}
+	printf("[+]Indexed %zu files.\n", fresh.count);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       watch_main
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void *watch_main (void *arg)
+ *
+ * RETURNS:        void *
+ *
+ * NOTES:
+ * Index thread entrypoint; refreshes the file named by every inotify event, and rescans
+ * the directory when the kernel reports it dropped some
+ * -----------------------------------------------------------------------*/
+void *watch_main (void *arg)
+{
+	struct file_index			*index = arg;
+	const struct inotify_event	*event;
+	char						buf[WATCH_BUFLEN] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	ssize_t						n;
+	char						*p;
+
+	while ((n = read(index->watch_fd, buf, sizeof(buf))) != 0)
+	{
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("[-]Lost the root directory watch");
+			break;
+		}
+		for (p = buf; p < buf + n; p += sizeof(struct inotify_event) + event->len)
+		{
+			event = (const struct inotify_event *)p;
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				scan_directory(index);
+			}
+			else if (event->len > 0)
+			{
+				file_index_refresh(index, event->name);
+			}
+		}
+	}
+	return NULL;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       store_entry
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int store_entry (struct file_index *index, const char *name, const struct stat *st)
+ *
+ * RETURNS:        int - 0 on success, -1 if a new entry can't be allocated
+ *
+ * NOTES:
+ * Adds or updates the entry of a file. The caller holds the lock, or owns the table.
+ * -----------------------------------------------------------------------*/
+int store_entry (struct file_index *index, const char *name, const struct stat *st)
+{
+	struct file_entry	*entry, **bucket = &index->buckets[name_hash(name) & index->mask];
+
+	for (entry = *bucket; entry != NULL && strcmp(entry->name, name) != 0; entry = entry->next)
+	{
+	}
+	if (entry == NULL)
+	{
+		if ((entry = malloc(sizeof(*entry))) == NULL)
+		{
+			return -1;
+		}
+		strcpy(entry->name, name);
+		entry->next = *bucket;
+		*bucket = entry;
+		if (++index->count > (index->mask + 1) * 2)
+		{
+			grow_index(index);
+		}
+	}
+	entry->size = st->st_size;
+	entry->mtime = st->st_mtim;
+	entry->ino = st->st_ino;
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       remove_entry
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void remove_entry (struct file_index *index, const char *name)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Drops the entry of a file, if it has one. The caller holds the lock.
+ * -----------------------------------------------------------------------*/
+void remove_entry (struct file_index *index, const char *name)
+{
+	struct file_entry	*entry, **link = &index->buckets[name_hash(name) & index->mask];
+
+	for (; (entry = *link) != NULL; link = &entry->next)
+	{
+		if (strcmp(entry->name, name) == 0)
+		{
+			*link = entry->next;
+			index->count--;
+			free(entry);
+			return;
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       grow_index
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void grow_index (struct file_index *index)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Doubles the buckets of a table and rehashes its entries. If memory runs out the table
+ * keeps its buckets, with longer chains.
+ * -----------------------------------------------------------------------*/
+void grow_index (struct file_index *index)
+{
+	struct file_entry	**buckets, *entry, *next;
+	size_t				mask = index->mask * 2 + 1, i;
+
+	if ((buckets = calloc(mask + 1, sizeof(struct file_entry *))) == NULL)
+	{
+		return;
+	}
+	for (i = 0; i <= index->mask; i++)
+	{
+		for (entry = index->buckets[i]; entry != NULL; entry = next)
+		{
+			next = entry->next;
+			entry->next = buckets[name_hash(entry->name) & mask];
+			buckets[name_hash(entry->name) & mask] = entry;
+		}
+	}
+	free(index->buckets);
+	index->buckets = buckets;
+	index->mask = mask;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       free_entries
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void free_entries (struct file_entry **buckets, size_t mask)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Frees a table that is no longer in use, entries and all
+ * -----------------------------------------------------------------------*/
+void free_entries (struct file_entry **buckets, size_t mask)
+{
+	struct file_entry	*entry, *next;
+	size_t				i;
+
+	for (i = 0; i <= mask; i++)
+	{
+		for (entry = buckets[i]; entry != NULL; entry = next)
+		{
+			next = entry->next;
+			free(entry);
+		}
+	}
+	free(buckets);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       name_hash
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      unsigned int name_hash (const char *name)
+ *
+ * RETURNS:        unsigned int
+ *
+ * NOTES:
+ * FNV-1a hash of a file name
+ * -----------------------------------------------------------------------*/
+unsigned int name_hash (const char *name)
+{
+	unsigned int hash = 2166136261u;
+
+	for (; *name != '\0'; name++)
+	{
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+	}
+	return hash;
+}
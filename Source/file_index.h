@@ -0,0 +1,65 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	file_index.h - In-memory index of the files in the server's root directory
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		file_index_init (struct file_index *index, const char *root);
+--					file_index_lookup (struct file_index *index, const char *name, struct file_entry *entry);
+--					file_index_refresh (struct file_index *index, const char *name);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The index maps the name of every regular file in the root directory that a request could
+-- name (see valid_file_name in protocol.h) to its size, mtime and inode, in a hash table
+-- shared by all worker threads. It is filled by one scan of the directory at startup and
+-- then kept current one file at a time: an inotify watch on the directory refreshes the
+-- entry of every file that is written, renamed, linked or removed, whoever changed it, and
+-- the server refreshes the files it stores itself as soon as it has stored them. If the
+-- kernel drops watch events the whole directory is scanned again.
+--
+-- Requests only ever look names up, so a GET of a file that isn't there is answered
+-- without touching the disk and no request walks the directory.
+---------------------------------------------------------------------------------------*/
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "protocol.h"
+
+#define FILE_INDEX_MIN_BUCKETS	64		// Must be a power of two
+
+struct file_entry
+{
+	char				name[FILE_NAME_LEN];
+	off_t				size;
+	struct timespec		mtime;
+	ino_t				ino;
+	struct file_entry	*next;
+};
+
+struct file_index
+{
+	pthread_mutex_t		lock;
+	int					dir_fd;			// The root directory
+	int					watch_fd;		// inotify instance watching it; -1 without one
+	struct file_entry	**buckets;
+	size_t				mask;			// Bucket count - 1; grows with the entries
+	size_t				count;
+};
+
+int file_index_init (struct file_index *index, const char *root);
+int file_index_lookup (struct file_index *index, const char *name, struct file_entry *entry);
+void file_index_refresh (struct file_index *index, const char *name);
+
+#endif
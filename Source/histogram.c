@@ -0,0 +1,217 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	histogram.c - Latency histograms
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		histogram_record (struct histogram *h, uint64_t value);
+--					histogram_count (const struct histogram *h);
+--					histogram_percentile (const struct histogram *h, double percentile);
+--					histogram_add (struct histogram *h, const struct histogram *other);
+--					bucket_of (uint64_t value);
+--					bucket_top (int bucket);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The bucket layout is described in histogram.h
+---------------------------------------------------------------------------------------*/
+#include <stdatomic.h>
+
+#include "histogram.h"
+
+#define SUB_BUCKETS		(1 << HISTOGRAM_SUB_BITS)
+
+int bucket_of (uint64_t value);
+uint64_t bucket_top (int bucket);
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       histogram_record
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void histogram_record (struct histogram *h, uint64_t value)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Counts one value
+ * -----------------------------------------------------------------------*/
+void histogram_record (struct histogram *h, uint64_t value)
+{
+	atomic_fetch_add_explicit(&h->counts[bucket_of(value)], 1, memory_order_relaxed);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       histogram_count
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint64_t histogram_count (const struct histogram *h)
+ *
+ * RETURNS:        uint64_t - number of values recorded
+ *
+ * NOTES:
+ * Only exact once the recording threads are done
+ * -----------------------------------------------------------------------*/
+uint64_t histogram_count (const struct histogram *h)
+{
+	uint64_t	total = 0;
+	int			i;
+
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		total += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+	}
+	return total;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       histogram_percentile
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint64_t histogram_percentile (const struct histogram *h, double percentile)
+ *
+ * RETURNS:        uint64_t - the value percentile percent of the recorded values are at or
+ *                            below, 0 if nothing was recorded
+ *
+ * NOTES:
+ * Reports the top of the bucket the percentile falls in, so results err on the high side;
+ * percentile 100 gives the maximum.
+ * -----------------------------------------------------------------------*/
+uint64_t histogram_percentile (const struct histogram *h, double percentile)
+{
+	uint64_t	total = histogram_count(h), rank, seen = 0;
+	int			i;
+
+	if (total == 0)
+	{
+		return 0;
+	}
+	rank = (uint64_t)(percentile / 100.0 * total + 0.5);
+	rank = rank < 1 ? 1 : (rank > total ? total : rank);
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+		if (seen >= rank)
+		{
+			break;
+		}
+	}
+	return bucket_top(i < HISTOGRAM_BUCKETS ? i : HISTOGRAM_BUCKETS - 1);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       histogram_add
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void histogram_add (struct histogram *h, const struct histogram *other)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Adds the values recorded in other to h, e.g. to merge per-thread histograms
+ * -----------------------------------------------------------------------*/
+void histogram_add (struct histogram *h, const struct histogram *other)
+{
+	int i;
+
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		atomic_fetch_add_explicit(&h->counts[i], atomic_load_explicit(&other->counts[i], memory_order_relaxed),
+			memory_order_relaxed);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bucket_of
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int bucket_of (uint64_t value)
+ *
+ * RETURNS:        int - index of the bucket value is counted in
+ *
+ * NOTES:
+ * A value whose highest set bit is bit k >= HISTOGRAM_SUB_BITS keeps its top
+ * HISTOGRAM_SUB_BITS + 1 bits; the rest only pick the power of two
+ * -----------------------------------------------------------------------*/
+int bucket_of (uint64_t value)
+{
+	int shift;
+
+	if (value < SUB_BUCKETS)
+	{
+		return (int)value;
+	}
+	shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+	return (shift + 1) * SUB_BUCKETS + (int)(value >> shift) - SUB_BUCKETS;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       bucket_top
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      uint64_t bucket_top (int bucket)
+ *
+ * RETURNS:        uint64_t - the largest value counted in bucket
+ *
+ * NOTES:
+ * Inverse of bucket_of
+ * -----------------------------------------------------------------------*/
+uint64_t bucket_top (int bucket)
+{
+	int shift;
+
+	if (bucket < SUB_BUCKETS)
+	{
+		return (uint64_t)bucket;
+	}
+	shift = bucket / SUB_BUCKETS - 1;
+	return ((((uint64_t)(bucket % SUB_BUCKETS + SUB_BUCKETS) + 1) << shift) - 1);
+}
@@ -0,0 +1,44 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	histogram.h - Latency histograms
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		histogram_record (struct histogram *h, uint64_t value);
+--					histogram_count (const struct histogram *h);
+--					histogram_percentile (const struct histogram *h, double percentile);
+--					histogram_add (struct histogram *h, const struct histogram *other);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- Log-linear buckets in the style of HdrHistogram: values below 2^HISTOGRAM_SUB_BITS get a
+-- bucket each, and every power of two above that is split into 2^HISTOGRAM_SUB_BITS equal
+-- buckets, so any 64-bit value is recorded to within 1% in a fixed table. Recording is
+-- one relaxed atomic increment, so any number of threads can share a histogram.
+---------------------------------------------------------------------------------------*/
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BITS		7
+#define HISTOGRAM_BUCKETS		((64 - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+struct histogram
+{
+	_Atomic uint64_t	counts[HISTOGRAM_BUCKETS];
+};
+
+void histogram_record (struct histogram *h, uint64_t value);
+uint64_t histogram_count (const struct histogram *h);
+uint64_t histogram_percentile (const struct histogram *h, double percentile);
+void histogram_add (struct histogram *h, const struct histogram *other);
+
+#endif
@@ -0,0 +1,1196 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	mux_client.c - Non-blocking client of multiplexed sessions
+--
+--	PROGRAM:		tclient
+--
+--	FUNCTIONS:		mux_client_open (struct mux_client *client, const struct sockaddr_in *server, int compress_level, int use_crc);
+--					mux_client_close (struct mux_client *client);
+--					mux_client_events (const struct mux_client *client);
+--					mux_client_process (struct mux_client *client);
+--					mux_client_pending (const struct mux_client *client);
+--					mux_transfer_init (struct mux_transfer *transfer, const char *name, int fd, void (*done)(struct mux_transfer *transfer, void *arg), void *arg);
+--					mux_client_get (struct mux_client *client, struct mux_transfer *transfer);
+--					mux_client_send (struct mux_client *client, struct mux_transfer *transfer);
+--					mux_client_strerror (int error);
+--					mux_transfer_range (struct mux_transfer *transfer, off_t offset, off_t length);
+--					mux_client_stat (struct mux_client *client, struct mux_transfer *transfer, int send);
+--					queue_transfer (struct mux_client *client, struct mux_transfer *transfer);
+--					write_frames (struct mux_client *client);
+--					next_frame (struct mux_client *client);
+--					put_frame (struct mux_client *client, int type, int flags, uint32_t len);
+--					read_frames (struct mux_client *client);
+--					start_frame (struct mux_client *client);
+--					end_frame (struct mux_client *client);
+--					store_data (struct mux_client *client, const char *data, size_t len);
+--					finish_reply (struct mux_client *client);
+--					complete_transfers (struct mux_client *client);
+--					fail_client (struct mux_client *client, int error, int sys_errno);
+--					set_error (struct mux_transfer *transfer, int error, int sys_errno);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		October 16, 2026 - Byte ranges and size queries
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The API is described in mux_client.h. A client's transfers sit on one list in request
+-- order, with a cursor for the writer and one for the reader: the writer frames the
+-- requests (and each SEND's file) as fast as the socket takes them, the reader matches the
+-- replies, which come back in the same order, to the transfers. A transfer is done once
+-- both cursors have passed it, and its callback runs then, so callbacks also run in order.
+--
+-- Frames are built one at a time in a buffer of their own and sent from there; a SEND's
+-- file is read through it with pread, since every block is checked or may be compressed.
+---------------------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "mux_client.h"
+#include "checksum.h"
+
+#define TRUE	1
+#define FALSE	0
+
+void queue_transfer (struct mux_client *client, struct mux_transfer *transfer);
+void write_frames (struct mux_client *client);
+int next_frame (struct mux_client *client);
+void put_frame (struct mux_client *client, int type, int flags, uint32_t len);
+void read_frames (struct mux_client *client);
+void start_frame (struct mux_client *client);
+void end_frame (struct mux_client *client);
+void store_data (struct mux_client *client, const char *data, size_t len);
+void finish_reply (struct mux_client *client);
+void complete_transfers (struct mux_client *client);
+void fail_client (struct mux_client *client, int error, int sys_errno);
+void set_error (struct mux_transfer *transfer, int error, int sys_errno);
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_open
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int mux_client_open (struct mux_client *client, const struct sockaddr_in *server,
+ *                                      int compress_level, int use_crc)
+ *
+ * RETURNS:        int - 0 on success, -1 with errno set if the connection can't be started
+ *
+ * NOTES:
+ * Starts connecting to a server's control port and queues the MUX request that opens the
+ * session. Transfers may be queued straight away; they go out once the server has echoed
+ * the request. compress_level (0 for none) and use_crc apply to every transfer.
+ * -----------------------------------------------------------------------*/
+int mux_client_open (struct mux_client *client, const struct sockaddr_in *server, int compress_level, int use_crc)
+{
+	int	option = 1, error;
+
+	memset(client, 0, sizeof(*client));
+	client->fd = -1;
+	client->state = MUX_CLIENT_CONNECTING;
+	client->use_crc = use_crc;
+	if (compressor_init(&client->compressor, compress_level) == -1
+		|| (client->out = malloc(FRAME_HEADER_LEN + MAX_FRAME_PAYLOAD)) == NULL
+		|| (client->block = malloc(MAX_FRAME_PAYLOAD)) == NULL
+		|| (client->in = malloc(MAX_FRAME_PAYLOAD)) == NULL
+		|| (client->packed = malloc(MAX_FRAME_PAYLOAD)) == NULL)
+	{
+		errno = ENOMEM;
+		goto failed;
+	}
+	if ((client->fd = socket(AF_INET, SOCK_STREAM, 0)) == -1
+		|| fcntl(client->fd, F_SETFL, O_NONBLOCK) == -1)
+	{
+		goto failed;
+	}
+	setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+	if (connect(client->fd, (const struct sockaddr *)server, sizeof(*server)) == 0)
+	{
+		client->state = MUX_CLIENT_GREETING;
+	}
+	else if (errno != EINPROGRESS)
+	{
+		goto failed;
+	}
+
+	// The MUX request is a control channel request, padded to REQ_BUFLEN
+	memset(client->out, 0, REQ_BUFLEN);
+	strcpy(client->out, MUX_COMMAND_NAME);
+	client->out_len = REQ_BUFLEN;
+	return 0;
+
+failed:
+	error = errno;
+	client->state = MUX_CLIENT_FAILED;
+	mux_client_close(client);
+	errno = error;
+	return -1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_close
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void mux_client_close (struct mux_client *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Closes the connection and frees the client's buffers. Transfers still queued end with
+ * MUX_CLIENT_ERR_CLOSED before it returns.
+ * -----------------------------------------------------------------------*/
+void mux_client_close (struct mux_client *client)
+{
+	fail_client(client, MUX_CLIENT_ERR_CLOSED, 0);
+	if (client->fd != -1)
+	{
+		close(client->fd);
+		client->fd = -1;
+	}
+	compressor_free(&client->compressor);
+	free(client->out);
+	free(client->block);
+	free(client->in);
+	free(client->packed);
+	client->out = client->block = client->in = client->packed = NULL;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_events
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int mux_client_events (const struct mux_client *client)
+ *
+ * RETURNS:        int - POLLIN and/or POLLOUT, 0 once the client has failed
+ *
+ * NOTES:
+ * Returns the events to wait for on the client's fd before calling mux_client_process.
+ * An open session always waits to read, so a server that hangs up is noticed.
+ * -----------------------------------------------------------------------*/
+int mux_client_events (const struct mux_client *client)
+{
+	switch (client->state)
+	{
+		case MUX_CLIENT_CONNECTING:
+		case MUX_CLIENT_GREETING:
+			return POLLOUT;
+		case MUX_CLIENT_WELCOME:
+			return POLLIN;
+		case MUX_CLIENT_OPEN:
+			return POLLIN | (client->out_off < client->out_len || client->writer != NULL ? POLLOUT : 0);
+		default:
+			return 0;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_process
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int mux_client_process (struct mux_client *client)
+ *
+ * RETURNS:        int - 0, or -1 once the connection has failed; client->error says why
+ *
+ * NOTES:
+ * Moves the session along as far as it can without blocking: finishes connecting, sends
+ * what the socket takes, reads what has arrived and runs the callbacks of the transfers
+ * that are done. Calling it when the fd isn't ready is harmless.
+ * -----------------------------------------------------------------------*/
+int mux_client_process (struct mux_client *client)
+{
+	socklen_t			len;
+	struct sockaddr_in	peer;
+	int					error, welcome;
+
+	if (client->state == MUX_CLIENT_CONNECTING)
+	{
+		len = sizeof(error);
+		if (getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &len) == -1)
+		{
+			error = errno;
+		}
+		len = sizeof(peer);
+		if (error == 0 && getpeername(client->fd, (struct sockaddr *)&peer, &len) == -1)
+		{
+			if (errno == ENOTCONN)
+			{
+				return 0;
+			}
+			error = errno;
+		}
+		if (error != 0)
+		{
+			fail_client(client, MUX_CLIENT_ERR_SYSTEM, error);
+			return -1;
+		}
+		client->state = MUX_CLIENT_GREETING;
+	}
+
+	if (client->state == MUX_CLIENT_GREETING || client->state == MUX_CLIENT_OPEN)
+	{
+		write_frames(client);
+	}
+	welcome = client->state == MUX_CLIENT_WELCOME;
+	if (welcome || client->state == MUX_CLIENT_OPEN)
+	{
+		read_frames(client);
+	}
+	// Requests queued while connecting can go out as soon as the echo is in
+	if (welcome && client->state == MUX_CLIENT_OPEN)
+	{
+		write_frames(client);
+	}
+	complete_transfers(client);
+	return client->state == MUX_CLIENT_FAILED ? -1 : 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_pending
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int mux_client_pending (const struct mux_client *client)
+ *
+ * RETURNS:        int - number of transfers queued whose callbacks haven't run yet
+ *
+ * NOTES:
+ * Lets a caller run its poll loop until everything it queued is done
+ * -----------------------------------------------------------------------*/
+int mux_client_pending (const struct mux_client *client)
+{
+	return client->pending;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_transfer_init
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Starts out as a whole-file transfer
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int mux_transfer_init (struct mux_transfer *transfer, const char *name, int fd,
+ *                                        void (*done)(struct mux_transfer *transfer, void *arg), void *arg)
+ *
+ * RETURNS:        int - 0 on success, -1 with errno EINVAL if the name isn't allowed
+ *
+ * NOTES:
+ * Sets up a transfer of the server's file name (NULL or empty for the command's default)
+ * to or from fd. done(transfer, arg) runs once it has ended, well or not.
+ * -----------------------------------------------------------------------*/
+int mux_transfer_init (struct mux_transfer *transfer, const char *name, int fd, void (*done)(struct mux_transfer *transfer, void *arg), void *arg)
+{
+	memset(transfer, 0, sizeof(*transfer));
+	if (name != NULL && name[0] != '\0')
+	{
+		if (!valid_file_name(name))
+		{
+			errno = EINVAL;
+			return -1;
+		}
+		strcpy(transfer->name, name);
+	}
+	transfer->fd = fd;
+	transfer->range_offset = transfer->range_length = -1;
+	transfer->done = done;
+	transfer->arg = arg;
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_get
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Asks for the transfer's range
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int mux_client_get (struct mux_client *client, struct mux_transfer *transfer)
+ *
+ * RETURNS:        int - 0 on success, -1 with errno ENOTCONN if the client has failed
+ *
+ * NOTES:
+ * Queues a GET that writes the server's file, or the transfer's range of it, into the
+ * transfer's fd
+ * -----------------------------------------------------------------------*/
+int mux_client_get (struct mux_client *client, struct mux_transfer *transfer)
+{
+	if (client->state == MUX_CLIENT_FAILED)
+	{
+		errno = ENOTCONN;
+		return -1;
+	}
+	transfer->send = FALSE;
+	transfer->stat = FALSE;
+	transfer->size = 0;
+	queue_transfer(client, transfer);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_send
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Sends the transfer's range
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int mux_client_send (struct mux_client *client, struct mux_transfer *transfer)
+ *
+ * RETURNS:        int - 0 on success, -1 with errno set if the client has failed (ENOTCONN),
+ *                 the transfer's fd isn't a regular file or its range isn't in it (EINVAL)
+ *
+ * NOTES:
+ * Queues a SEND of the file open on the transfer's fd, or of the transfer's range of it.
+ * The file's size is taken now and announced in the request.
+ * -----------------------------------------------------------------------*/
+int mux_client_send (struct mux_client *client, struct mux_transfer *transfer)
+{
+	struct stat	st;
+
+	if (client->state == MUX_CLIENT_FAILED)
+	{
+		errno = ENOTCONN;
+		return -1;
+	}
+	if (fstat(transfer->fd, &st) == -1)
+	{
+		return -1;
+	}
+	if (!S_ISREG(st.st_mode) || transfer->range_offset > st.st_size ||
+		(transfer->range_length > 0 && transfer->range_length > st.st_size - (transfer->range_offset > 0 ? transfer->range_offset : 0)))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	transfer->send = TRUE;
+	transfer->stat = FALSE;
+	transfer->size = st.st_size;
+	queue_transfer(client, transfer);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_strerror
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      const char *mux_client_strerror (int error)
+ *
+ * RETURNS:        const char * - a description of a MUX_CLIENT_ code
+ *
+ * NOTES:
+ * The description is a constant string
+ * -----------------------------------------------------------------------*/
+const char *mux_client_strerror (int error)
+{
+	switch (error)
+	{
+		case MUX_CLIENT_OK:
+			return "Success";
+		case MUX_CLIENT_ERR_SYSTEM:
+			return "System error";
+		case MUX_CLIENT_ERR_REJECTED:
+			return "Rejected by the server";
+		case MUX_CLIENT_ERR_CHECKSUM:
+			return "Checksum mismatch";
+		case MUX_CLIENT_ERR_PROTOCOL:
+			return "Protocol error";
+		case MUX_CLIENT_ERR_CLOSED:
+			return "Connection closed";
+		default:
+			return "Unknown error";
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       queue_transfer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Starts a SEND at its range
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void queue_transfer (struct mux_client *client, struct mux_transfer *transfer)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Resets a transfer's progress and appends it to the client's list, waking the writer
+ * and reader cursors if they had run out of transfers
+ * -----------------------------------------------------------------------*/
+void queue_transfer (struct mux_client *client, struct mux_transfer *transfer)
+{
+	transfer->error = MUX_CLIENT_OK;
+	transfer->sys_errno = 0;
+	transfer->message[0] = '\0';
+	transfer->acknowledged = FALSE;
+	transfer->writing = MUX_WRITE_REQUEST;
+	transfer->reading = MUX_READ_ACK;
+	transfer->offset = transfer->range_offset > 0 ? transfer->range_offset : 0;
+	transfer->left = 0;
+	if (transfer->send && !transfer->stat)
+	{
+		transfer->left = transfer->range_length >= 0 ? transfer->range_length : transfer->size - transfer->offset;
+	}
+	transfer->crc = 0;
+	transfer->next = NULL;
+
+	if (client->tail != NULL)
+	{
+		client->tail->next = transfer;
+	}
+	else
+	{
+		client->head = transfer;
+	}
+	client->tail = transfer;
+	if (client->writer == NULL)
+	{
+		client->writer = transfer;
+	}
+	if (client->reader == NULL)
+	{
+		client->reader = transfer;
+	}
+	client->pending++;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       write_frames
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void write_frames (struct mux_client *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sends the frame being written and builds the next one, until the socket is full or
+ * there is nothing left to send. The MUX request is sent the same way before the session
+ * is open.
+ * -----------------------------------------------------------------------*/
+void write_frames (struct mux_client *client)
+{
+	ssize_t	n;
+
+	while (TRUE)
+	{
+		if (client->out_off == client->out_len)
+		{
+			client->out_off = client->out_len = 0;
+			if (client->state == MUX_CLIENT_GREETING)
+			{
+				client->state = MUX_CLIENT_WELCOME;
+				return;
+			}
+			if (client->state != MUX_CLIENT_OPEN || !next_frame(client))
+			{
+				return;
+			}
+		}
+		n = send(client->fd, client->out + client->out_off, client->out_len - client->out_off, MSG_NOSIGNAL);
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				fail_client(client, MUX_CLIENT_ERR_SYSTEM, errno);
+			}
+			return;
+		}
+		client->out_off += n;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       next_frame
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Requests carry the transfer's range
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int next_frame (struct mux_client *client)
+ *
+ * RETURNS:        int - TRUE if a frame was built, FALSE if every transfer has been sent
+ *
+ * NOTES:
+ * Builds the writer's next frame: a transfer's REQUEST, then for a SEND a DATA frame per
+ * block of the file and the END with its CRC. A SEND the server has already rejected skips
+ * to its END, which the server drops the data up to. If the file can't be read to its end,
+ * the END carries a CRC that can't match, so a server checking CRCs won't store it.
+ * -----------------------------------------------------------------------*/
+int next_frame (struct mux_client *client)
+{
+	struct mux_transfer	*transfer = client->writer;
+	struct request		req;
+	char				*payload = client->out + FRAME_HEADER_LEN;
+	uint32_t			crc;
+	ssize_t				n;
+	int					packed_len;
+
+	if (transfer == NULL)
+	{
+		return FALSE;
+	}
+	if (transfer->writing == MUX_WRITE_REQUEST)
+	{
+		parse_request(transfer->send ? SEND_COMMAND_NAME : GET_COMMAND_NAME, &req);
+		strcpy(req.name, transfer->name);
+		req.offset = transfer->range_offset;
+		req.length = transfer->range_length;
+		req.size = transfer->send && !transfer->stat ? transfer->size : -1;
+		req.compress = client->compressor.level > 0 ? client->compressor.level : -1;
+		req.crc = client->use_crc ? 1 : -1;
+		format_request(payload, MAX_REQUEST_LEN, &req);
+		put_frame(client, FRAME_REQUEST, 0, strlen(payload));
+		if (transfer->send)
+		{
+			transfer->writing = MUX_WRITE_DATA;
+		}
+		else
+		{
+			transfer->writing = MUX_WRITE_DONE;
+			client->writer = transfer->next;
+		}
+		return TRUE;
+	}
+
+	if (transfer->left > 0 && transfer->reading != MUX_READ_DONE)
+	{
+		n = transfer->left < MAX_FRAME_PAYLOAD ? transfer->left : MAX_FRAME_PAYLOAD;
+		if ((packed_len = pread(transfer->fd, client->block, n, transfer->offset)) == n)
+		{
+			if (client->use_crc)
+			{
+				transfer->crc = crc32c(transfer->crc, client->block, n);
+			}
+			transfer->offset += n;
+			transfer->left -= n;
+			if (compress_next(&client->compressor)
+				&& (packed_len = compress_block(&client->compressor, client->block, n, payload, MAX_FRAME_PAYLOAD)) > 0)
+			{
+				put_frame(client, FRAME_DATA, FRAME_FLAG_COMPRESSED, packed_len);
+			}
+			else
+			{
+				memcpy(payload, client->block, n);
+				put_frame(client, FRAME_DATA, 0, n);
+			}
+			return TRUE;
+		}
+		set_error(transfer, MUX_CLIENT_ERR_SYSTEM, packed_len == -1 ? errno : EIO);
+		transfer->crc = ~transfer->crc;
+	}
+
+	if (client->use_crc)
+	{
+		crc = htonl(transfer->crc);
+		memcpy(payload, &crc, CHECKSUM_LEN);
+		put_frame(client, FRAME_END, 0, CHECKSUM_LEN);
+	}
+	else
+	{
+		put_frame(client, FRAME_END, 0, 0);
+	}
+	transfer->writing = MUX_WRITE_DONE;
+	client->writer = transfer->next;
+	return TRUE;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       put_frame
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void put_frame (struct mux_client *client, int type, int flags, uint32_t len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Heads the len byte payload already in the output buffer and makes it the frame to send
+ * -----------------------------------------------------------------------*/
+void put_frame (struct mux_client *client, int type, int flags, uint32_t len)
+{
+	struct frame_header	header;
+
+	header.type = type;
+	header.flags = flags;
+	header.length = len;
+	encode_frame_header(client->out, &header);
+	client->out_off = 0;
+	client->out_len = FRAME_HEADER_LEN + len;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       read_frames
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void read_frames (struct mux_client *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Reads everything that has arrived: the echo of the MUX request, then frames. Plain file
+ * data is written out as it comes in; headers, replies and compressed blocks are gathered
+ * whole first.
+ * -----------------------------------------------------------------------*/
+void read_frames (struct mux_client *client)
+{
+	char	*dst;
+	size_t	want;
+	ssize_t	n;
+	int		plain;
+
+	while (client->state == MUX_CLIENT_WELCOME || client->state == MUX_CLIENT_OPEN)
+	{
+		plain = FALSE;
+		if (client->state == MUX_CLIENT_WELCOME)
+		{
+			dst = client->text + client->got;
+			want = REQ_BUFLEN - client->got;
+		}
+		else if (!client->in_frame)
+		{
+			dst = client->head_buf + client->got;
+			want = FRAME_HEADER_LEN - client->got;
+		}
+		else if (client->frame.type == FRAME_DATA && !(client->frame.flags & FRAME_FLAG_COMPRESSED))
+		{
+			plain = TRUE;
+			dst = client->in;
+			want = client->frame_left < MAX_FRAME_PAYLOAD ? client->frame_left : MAX_FRAME_PAYLOAD;
+		}
+		else
+		{
+			dst = (client->frame.type == FRAME_DATA ? client->packed : client->text) + client->got;
+			want = client->frame_left;
+		}
+
+		if ((n = recv(client->fd, dst, want, 0)) == 0)
+		{
+			fail_client(client, MUX_CLIENT_ERR_CLOSED, 0);
+			return;
+		}
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				fail_client(client, MUX_CLIENT_ERR_SYSTEM, errno);
+			}
+			return;
+		}
+
+		if (client->state == MUX_CLIENT_WELCOME)
+		{
+			if ((client->got += n) == REQ_BUFLEN)
+			{
+				client->got = 0;
+				client->state = MUX_CLIENT_OPEN;
+			}
+		}
+		else if (!client->in_frame)
+		{
+			if ((client->got += n) == FRAME_HEADER_LEN)
+			{
+				client->got = 0;
+				start_frame(client);
+			}
+		}
+		else
+		{
+			if (plain)
+			{
+				store_data(client, dst, n);
+			}
+			else
+			{
+				client->got += n;
+			}
+			if ((client->frame_left -= n) == 0)
+			{
+				end_frame(client);
+			}
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       start_frame
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void start_frame (struct mux_client *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Decodes the header just read and checks the frame fits the reader's transfer and the
+ * buffer it will be read into; anything else fails the client
+ * -----------------------------------------------------------------------*/
+void start_frame (struct mux_client *client)
+{
+	struct mux_transfer	*transfer = client->reader;
+	struct frame_header	*frame = &client->frame;
+	int					valid;
+
+	decode_frame_header(client->head_buf, frame);
+	switch (frame->type)
+	{
+		case FRAME_ACK:
+		case FRAME_ERROR:
+		case FRAME_END:
+			valid = frame->length < MAX_REQUEST_LEN;
+			break;
+		case FRAME_DATA:
+			valid = transfer != NULL && transfer->reading == MUX_READ_DATA
+				&& (!(frame->flags & FRAME_FLAG_COMPRESSED) || frame->length <= MAX_FRAME_PAYLOAD);
+			break;
+		default:
+			valid = FALSE;
+	}
+	if (transfer == NULL || !valid)
+	{
+		fail_client(client, MUX_CLIENT_ERR_PROTOCOL, 0);
+		return;
+	}
+	client->in_frame = TRUE;
+	client->frame_left = frame->length;
+	if (frame->length == 0)
+	{
+		end_frame(client);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       end_frame
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Keeps the size and range the server acknowledges
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void end_frame (struct mux_client *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Acts on a frame that has been read whole. An ACK moves its transfer on to the data or
+ * the confirmation that follows, an ERROR rejects it, and the END of a GET's data is
+ * checked against the CRC it carries. A GET takes the file's size and the range it will
+ * get from its ACK, a stat of a SEND only the size.
+ * -----------------------------------------------------------------------*/
+void end_frame (struct mux_client *client)
+{
+	struct mux_transfer	*transfer = client->reader;
+	struct request		ack;
+	uint32_t			expected;
+	int					len = client->got, n;
+
+	client->in_frame = FALSE;
+	client->got = 0;
+	if (client->frame.type != FRAME_DATA)
+	{
+		client->text[len] = '\0';
+	}
+	switch (client->frame.type)
+	{
+		case FRAME_DATA:
+			if (client->frame.flags & FRAME_FLAG_COMPRESSED)
+			{
+				if ((n = decompress_block(client->packed, len, client->in, MAX_FRAME_PAYLOAD)) == -1)
+				{
+					fail_client(client, MUX_CLIENT_ERR_PROTOCOL, 0);
+					return;
+				}
+				store_data(client, client->in, n);
+			}
+			return;
+		case FRAME_ERROR:
+			strcpy(transfer->message, client->text);
+			set_error(transfer, MUX_CLIENT_ERR_REJECTED, 0);
+			finish_reply(client);
+			return;
+		case FRAME_ACK:
+			if (transfer->reading != MUX_READ_ACK || parse_request(client->text, &ack) == -1)
+			{
+				break;
+			}
+			transfer->acknowledged = TRUE;
+			if (transfer->send)
+			{
+				transfer->size = transfer->stat ? ack.size : transfer->size;
+				transfer->reading = MUX_READ_STORED;
+				return;
+			}
+			transfer->reading = MUX_READ_DATA;
+			transfer->size = ack.size > 0 ? ack.size : 0;
+			transfer->offset = ack.offset > 0 ? ack.offset : 0;
+			transfer->range_offset = transfer->offset;
+			transfer->range_length = ack.length >= 0 ? ack.length : transfer->size - transfer->offset;
+			return;
+		case FRAME_END:
+			if (transfer->reading == MUX_READ_DATA && client->use_crc && len == CHECKSUM_LEN)
+			{
+				memcpy(&expected, client->text, CHECKSUM_LEN);
+				if (ntohl(expected) != transfer->crc)
+				{
+					set_error(transfer, MUX_CLIENT_ERR_CHECKSUM, 0);
+				}
+			}
+			if (transfer->reading != MUX_READ_DATA && transfer->reading != MUX_READ_STORED)
+			{
+				break;
+			}
+			finish_reply(client);
+			return;
+	}
+	fail_client(client, MUX_CLIENT_ERR_PROTOCOL, 0);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       store_data
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void store_data (struct mux_client *client, const char *data, size_t len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Writes received file data to the reader's transfer at its offset and adds it to the
+ * CRC. After a failed write the rest of the transfer's data is only read and dropped, so
+ * the session stays in step.
+ * -----------------------------------------------------------------------*/
+void store_data (struct mux_client *client, const char *data, size_t len)
+{
+	struct mux_transfer	*transfer = client->reader;
+	size_t				done;
+	ssize_t				n;
+
+	if (client->use_crc)
+	{
+		transfer->crc = crc32c(transfer->crc, data, len);
+	}
+	for (done = 0; done < len && transfer->error == MUX_CLIENT_OK; done += n)
+	{
+		if ((n = pwrite(transfer->fd, data + done, len - done, transfer->offset + done)) == -1)
+		{
+			if (errno == EINTR)
+			{
+				n = 0;
+				continue;
+			}
+			set_error(transfer, MUX_CLIENT_ERR_SYSTEM, errno);
+		}
+	}
+	transfer->offset += len;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       finish_reply
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void finish_reply (struct mux_client *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Marks the reader's transfer as answered and moves the reader on to the next one
+ * -----------------------------------------------------------------------*/
+void finish_reply (struct mux_client *client)
+{
+	client->reader->reading = MUX_READ_DONE;
+	client->reader = client->reader->next;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       complete_transfers
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void complete_transfers (struct mux_client *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Takes the transfers that have been both sent and answered off the front of the list
+ * and runs their callbacks, oldest first
+ * -----------------------------------------------------------------------*/
+void complete_transfers (struct mux_client *client)
+{
+	struct mux_transfer	*transfer;
+
+	while ((transfer = client->head) != NULL
+		&& transfer->writing == MUX_WRITE_DONE && transfer->reading == MUX_READ_DONE)
+	{
+		if ((client->head = transfer->next) == NULL)
+		{
+			client->tail = NULL;
+		}
+		client->pending--;
+		if (transfer->done != NULL)
+		{
+			transfer->done(transfer, transfer->arg);
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       fail_client
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void fail_client (struct mux_client *client, int error, int sys_errno)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Gives up on the session: records why, and ends every transfer still queued with that
+ * error unless it had already failed on its own. The socket stays open until
+ * mux_client_close, so it doesn't vanish from under a caller still polling it.
+ * -----------------------------------------------------------------------*/
+void fail_client (struct mux_client *client, int error, int sys_errno)
+{
+	struct mux_transfer	*transfer;
+
+	if (client->state == MUX_CLIENT_FAILED && client->head == NULL)
+	{
+		return;
+	}
+	if (client->state != MUX_CLIENT_FAILED)
+	{
+		client->state = MUX_CLIENT_FAILED;
+		client->error = error;
+		client->sys_errno = sys_errno;
+	}
+	client->writer = client->reader = NULL;
+	client->out_off = client->out_len = 0;
+	while ((transfer = client->head) != NULL)
+	{
+		if ((client->head = transfer->next) == NULL)
+		{
+			client->tail = NULL;
+		}
+		client->pending--;
+		set_error(transfer, error, sys_errno);
+		if (transfer->done != NULL)
+		{
+			transfer->done(transfer, transfer->arg);
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       set_error
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void set_error (struct mux_transfer *transfer, int error, int sys_errno)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Records why a transfer failed; the first error it meets is the one reported
+ * -----------------------------------------------------------------------*/
+void set_error (struct mux_transfer *transfer, int error, int sys_errno)
+{
+	if (transfer->error == MUX_CLIENT_OK)
+	{
+		transfer->error = error;
+		transfer->sys_errno = sys_errno;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_transfer_range
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void mux_transfer_range (struct mux_transfer *transfer, off_t offset, off_t length)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Narrows a transfer not yet queued to length bytes from offset; -1 leaves either at the
+ * start or end of the file. A GET's range is the server's to trim: once acknowledged,
+ * range_offset and range_length hold the bytes it is actually sending.
+ * -----------------------------------------------------------------------*/
+void mux_transfer_range (struct mux_transfer *transfer, off_t offset, off_t length)
+{
+	transfer->range_offset = offset;
+	transfer->range_length = length;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       mux_client_stat
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int mux_client_stat (struct mux_client *client, struct mux_transfer *transfer, int send)
+ *
+ * RETURNS:        int - 0 on success, -1 with errno ENOTCONN if the client has failed
+ *
+ * NOTES:
+ * Queues an empty GET, or with send an empty SEND, that leaves the server's file alone and
+ * only learns its size: the file a GET would read or a SEND would write. The size is in the
+ * transfer once its callback runs; the fd isn't used.
+ * -----------------------------------------------------------------------*/
+int mux_client_stat (struct mux_client *client, struct mux_transfer *transfer, int send)
+{
+	if (client->state == MUX_CLIENT_FAILED)
+	{
+		errno = ENOTCONN;
+		return -1;
+	}
+	transfer->send = send;
+	transfer->stat = TRUE;
+	transfer->size = -1;
+	transfer->range_offset = send ? 0 : -1;
+	transfer->range_length = 0;
+	queue_transfer(client, transfer);
+	return 0;
+}
@@ -0,0 +1,162 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	mux_client.h - Non-blocking client of multiplexed sessions
+--
+--	PROGRAM:		tclient
+--
+--	FUNCTIONS:		mux_client_open (struct mux_client *client, const struct sockaddr_in *server, int compress_level, int use_crc);
+--					mux_client_close (struct mux_client *client);
+--					mux_client_events (const struct mux_client *client);
+--					mux_client_process (struct mux_client *client);
+--					mux_client_pending (const struct mux_client *client);
+--					mux_transfer_init (struct mux_transfer *transfer, const char *name, int fd, void (*done)(struct mux_transfer *transfer, void *arg), void *arg);
+--					mux_client_get (struct mux_client *client, struct mux_transfer *transfer);
+--					mux_client_send (struct mux_client *client, struct mux_transfer *transfer);
+--					mux_transfer_range (struct mux_transfer *transfer, off_t offset, off_t length);
+--					mux_client_stat (struct mux_client *client, struct mux_transfer *transfer, int send);
+--					mux_client_strerror (int error);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		October 16, 2026 - Byte ranges and size queries
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- A library for programs that move files to and from tserver themselves instead of
+-- running tclient. It speaks the framed MUX protocol (see protocol.h) over one
+-- non-blocking connection that any number of GETs and SENDs share: transfers queued on
+-- a client are pipelined in order, and more may be queued at any time, from completion
+-- callbacks included, for as long as the connection lives.
+--
+-- Nothing blocks, prints or exits. The caller polls the client's fd for the events
+-- mux_client_events asks for and calls mux_client_process when it is ready; one thread can
+-- drive any number of clients that way. Each transfer ends with a call of its done
+-- callback, with error set to one of the MUX_CLIENT_ codes: a rejected request carries the
+-- server's message, and a system error the errno it failed with. A broken connection ends
+-- every transfer still on it. Callbacks may queue transfers but mustn't close the client.
+--
+-- Transfers move whole files between the server and an fd of the caller's: a GET writes
+-- the server's file into it from offset 0, a SEND uploads all of a regular file. Both use
+-- positional I/O, so the fd's own offset is left alone. mux_transfer_range narrows either
+-- to a byte range, which lands at the same offset on the other side; a ranged SEND still
+-- announces the size of the whole file. mux_client_stat moves no data and only learns the
+-- size of the server's file. The caller resolves the server's address and retries a failed
+-- connection if it wants to.
+---------------------------------------------------------------------------------------*/
+#ifndef MUX_CLIENT_H
+#define MUX_CLIENT_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+
+#include "protocol.h"
+#include "compress.h"
+
+// Outcome of a transfer
+#define MUX_CLIENT_OK			0
+#define MUX_CLIENT_ERR_SYSTEM	1		// A system call failed; see sys_errno
+#define MUX_CLIENT_ERR_REJECTED	2		// The server refused the request; see message
+#define MUX_CLIENT_ERR_CHECKSUM	3		// The data didn't match its CRC
+#define MUX_CLIENT_ERR_PROTOCOL	4		// The server sent something the protocol doesn't allow
+#define MUX_CLIENT_ERR_CLOSED	5		// The connection closed before the transfer ended
+
+// Where a client's connection is
+enum mux_client_state
+{
+	MUX_CLIENT_CONNECTING,
+	MUX_CLIENT_GREETING,		// Sending the MUX request
+	MUX_CLIENT_WELCOME,			// Waiting for its echo
+	MUX_CLIENT_OPEN,
+	MUX_CLIENT_FAILED
+};
+
+// How much of its request a transfer has sent
+enum mux_write_phase
+{
+	MUX_WRITE_REQUEST,
+	MUX_WRITE_DATA,				// A SEND's DATA frames and END
+	MUX_WRITE_DONE
+};
+
+// How much of its reply a transfer has received
+enum mux_read_phase
+{
+	MUX_READ_ACK,
+	MUX_READ_DATA,				// A GET's DATA frames and END
+	MUX_READ_STORED,			// A SEND's END
+	MUX_READ_DONE
+};
+
+// One GET or SEND, allocated by the caller and left alone until its callback runs
+struct mux_transfer
+{
+	char					name[FILE_NAME_LEN];	// Empty for the command's default file
+	int						fd;
+	int						send;
+	off_t					size;			// Size of the file, once the server has told a GET or stat
+	off_t					range_offset;	// First byte moved, -1 for the whole file; a GET's is the server's once acknowledged
+	off_t					range_length;	// Bytes moved from there, -1 for the rest of the file; likewise
+	int						acknowledged;	// The server has accepted the request
+	int						error;			// MUX_CLIENT_ code, set before done runs
+	int						sys_errno;		// errno of a MUX_CLIENT_ERR_SYSTEM
+	char					message[MAX_REQUEST_LEN];	// Server's reason for a MUX_CLIENT_ERR_REJECTED
+	void					(*done)(struct mux_transfer *transfer, void *arg);
+	void					*arg;
+
+	// Private to the library
+	int						stat;			// Only asks for the size
+	enum mux_write_phase	writing;
+	enum mux_read_phase		reading;
+	off_t					offset;			// Next byte to read (SEND) or write (GET)
+	off_t					left;			// Bytes of a SEND not framed yet
+	uint32_t				crc;
+	struct mux_transfer		*next;
+};
+
+// One connection to a server and the transfers queued on it
+struct mux_client
+{
+	int						fd;				// Socket to poll; -1 once closed
+	enum mux_client_state	state;
+	int						error;			// MUX_CLIENT_ code the connection failed with
+	int						sys_errno;
+	int						use_crc;
+	int						pending;		// Transfers queued and not yet done
+
+	// Private to the library
+	struct compressor		compressor;
+	struct mux_transfer		*head;			// Oldest transfer not done
+	struct mux_transfer		*tail;
+	struct mux_transfer		*writer;		// Oldest transfer not fully sent
+	struct mux_transfer		*reader;		// Oldest transfer not fully answered
+	char					*out;			// Frame being sent
+	int						out_len;
+	int						out_off;
+	char					*block;			// File data of the next DATA frame
+	char					head_buf[FRAME_HEADER_LEN];
+	struct frame_header		frame;			// Frame being received
+	int						in_frame;		// Its header has been read
+	uint32_t				frame_left;		// Payload bytes still to read
+	int						got;			// Bytes of the header, text or packed block read
+	char					text[MAX_REQUEST_LEN];
+	char					*in;			// Received file data
+	char					*packed;		// Received compressed block
+};
+
+int mux_client_open (struct mux_client *client, const struct sockaddr_in *server, int compress_level, int use_crc);
+void mux_client_close (struct mux_client *client);
+int mux_client_events (const struct mux_client *client);
+int mux_client_process (struct mux_client *client);
+int mux_client_pending (const struct mux_client *client);
+int mux_transfer_init (struct mux_transfer *transfer, const char *name, int fd, void (*done)(struct mux_transfer *transfer, void *arg), void *arg);
+int mux_client_get (struct mux_client *client, struct mux_transfer *transfer);
+int mux_client_send (struct mux_client *client, struct mux_transfer *transfer);
+void mux_transfer_range (struct mux_transfer *transfer, off_t offset, off_t length);
+int mux_client_stat (struct mux_client *client, struct mux_transfer *transfer, int send);
+const char *mux_client_strerror (int error);
+
+#endif
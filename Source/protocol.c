@@ -0,0 +1,404 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	protocol.c - Wire protocol shared by tclient and tserver
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		encode_frame_header (char *buf, const struct frame_header *header);
+--					decode_frame_header (const char *buf, struct frame_header *header);
+--					parse_request (const char *text, struct request *req);
+--					format_request (char *buf, int buflen, const struct request *req);
+--					valid_file_name (const char *name);
+--					request_file_name (const struct request *req);
+--					local_channel_path (char *path, int len);
+--					local_peer_trusted (int sockfd);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		October 16, 2026 - Request parameters
+--					October 16, 2026 - compress parameter
+--					October 16, 2026 - delta parameter
+--					October 16, 2026 - crc parameter
+--					October 16, 2026 - name parameter
+--					October 16, 2026 - port parameter
+--					October 16, 2026 - Local socket path and peer check
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- Encoding of the framed (MUX) protocol and of request parameters, both described in protocol.h,
+-- and where both programs find the local socket and whom they trust on it
+---------------------------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "protocol.h"
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       encode_frame_header
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void encode_frame_header (char *buf, const struct frame_header *header)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Writes a frame header into the first FRAME_HEADER_LEN bytes of buf in network byte order
+ * -----------------------------------------------------------------------*/
+void encode_frame_header (char *buf, const struct frame_header *header)
+{
+	uint32_t length = htonl(header->length);
+
+	buf[0] = (char)header->type;
+	buf[1] = (char)header->flags;
+	buf[2] = 0;
+	buf[3] = 0;
+	memcpy(buf + 4, &length, sizeof(length));
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       decode_frame_header
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void decode_frame_header (const char *buf, struct frame_header *header)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Reads a frame header from the first FRAME_HEADER_LEN bytes of buf
+ * -----------------------------------------------------------------------*/
+void decode_frame_header (const char *buf, struct frame_header *header)
+{
+	uint32_t length;
+
+	memcpy(&length, buf + 4, sizeof(length));
+	header->type = (uint8_t)buf[0];
+	header->flags = (uint8_t)buf[1];
+	header->length = ntohl(length);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       parse_request
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Added the compress parameter
+ *                 October 16th, 2026 - Added the delta parameter
+ *                 October 16th, 2026 - Added the crc parameter
+ *                 October 16th, 2026 - Added the name parameter
+ *                 October 16th, 2026 - Added the port parameter
+ *                 October 16th, 2026 - Rejects out of range values and ranges whose end overflows
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int parse_request (const char *text, struct request *req)
+ *
+ * RETURNS:        int - 0 on success, -1 if the request is malformed
+ *
+ * NOTES:
+ * Splits a request into its command and parameters. Parameters that are missing are left
+ * at -1, or empty for the name; a negative, non-numeric or out of range value, an invalid
+ * name, or an offset and length adding up past LLONG_MAX make the request malformed.
+ * -----------------------------------------------------------------------*/
+int parse_request (const char *text, struct request *req)
+{
+	char		word[REQ_BUFLEN], *value, *end;
+	long long	number, *field;
+	int			used;
+
+	req->command[0] = req->name[0] = '\0';
+	req->offset = req->length = req->size = req->compress = req->delta = req->crc = req->port = -1;
+	if (sscanf(text, "%15s%n", req->command, &used) != 1)
+	{
+		return -1;
+	}
+	text += used;
+
+	while (sscanf(text, "%79s%n", word, &used) == 1)
+	{
+		text += used;
+		if ((value = strchr(word, '=')) == NULL)
+		{
+			return -1;
+		}
+		*value++ = '\0';
+		if (strcmp(word, "name") == 0)
+		{
+			if (!valid_file_name(value))
+			{
+				return -1;
+			}
+			strcpy(req->name, value);
+			continue;
+		}
+		if (strcmp(word, "offset") == 0)
+		{
+			field = &req->offset;
+		}
+		else if (strcmp(word, "length") == 0)
+		{
+			field = &req->length;
+		}
+		else if (strcmp(word, "size") == 0)
+		{
+			field = &req->size;
+		}
+		else if (strcmp(word, "compress") == 0)
+		{
+			field = &req->compress;
+		}
+		else if (strcmp(word, "delta") == 0)
+		{
+			field = &req->delta;
+		}
+		else if (strcmp(word, "crc") == 0)
+		{
+			field = &req->crc;
+		}
+		else if (strcmp(word, "port") == 0)
+		{
+			field = &req->port;
+		}
+		else
+		{
+			continue;
+		}
+		errno = 0;
+		number = strtoll(value, &end, 10);
+		if (*value == '\0' || *end != '\0' || errno == ERANGE || number < 0)
+		{
+			return -1;
+		}
+		*field = number;
+	}
+
+	// The end of the range must be a file offset too
+	if (req->offset > 0 && req->length > LLONG_MAX - req->offset)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       format_request
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Added the compress parameter
+ *                 October 16th, 2026 - Added the delta parameter
+ *                 October 16th, 2026 - Added the crc parameter
+ *                 October 16th, 2026 - Added the name parameter
+ *                 October 16th, 2026 - Added the port parameter, right after the name
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void format_request (char *buf, int buflen, const struct request *req)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Writes a request as text, leaving out the parameters that are -1. The name and the port go
+ * first, so a buffer too short for every parameter never cuts them.
+ * -----------------------------------------------------------------------*/
+void format_request (char *buf, int buflen, const struct request *req)
+{
+	int used;
+
+	used = snprintf(buf, buflen, "%s", req->command);
+	if (req->name[0] != '\0' && used < buflen)
+	{
+		used += snprintf(buf + used, buflen - used, " name=%s", req->name);
+	}
+	if (req->port >= 0 && used < buflen)
+	{
+		used += snprintf(buf + used, buflen - used, " port=%lld", req->port);
+	}
+	if (req->size >= 0 && used < buflen)
+	{
+		used += snprintf(buf + used, buflen - used, " size=%lld", req->size);
+	}
+	if (req->offset >= 0 && used < buflen)
+	{
+		used += snprintf(buf + used, buflen - used, " offset=%lld", req->offset);
+	}
+	if (req->length >= 0 && used < buflen)
+	{
+		used += snprintf(buf + used, buflen - used, " length=%lld", req->length);
+	}
+	if (req->compress >= 0 && used < buflen)
+	{
+		used += snprintf(buf + used, buflen - used, " compress=%lld", req->compress);
+	}
+	if (req->delta >= 0 && used < buflen)
+	{
+		used += snprintf(buf + used, buflen - used, " delta=%lld", req->delta);
+	}
+	if (req->crc >= 0 && used < buflen)
+	{
+		snprintf(buf + used, buflen - used, " crc=%lld", req->crc);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       valid_file_name
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int valid_file_name (const char *name)
+ *
+ * RETURNS:        int - 1 if a request may name the file, 0 if not
+ *
+ * NOTES:
+ * Checks a name= parameter. Without '/' a name can't leave the server's root directory, and
+ * without a leading '.' it can't be "..", "." or one of the server's hidden temporary files.
+ * -----------------------------------------------------------------------*/
+int valid_file_name (const char *name)
+{
+	size_t i;
+
+	if (name[0] == '\0' || name[0] == '.')
+	{
+		return 0;
+	}
+	for (i = 0; name[i] != '\0'; i++)
+	{
+		if (i == FILE_NAME_LEN - 1 || !((name[i] >= 'a' && name[i] <= 'z') || (name[i] >= 'A' && name[i] <= 'Z') ||
+			(name[i] >= '0' && name[i] <= '9') || name[i] == '.' || name[i] == '_' || name[i] == '-'))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       request_file_name
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      const char *request_file_name (const struct request *req)
+ *
+ * RETURNS:        const char * - the file a GET or SEND transfers
+ *
+ * NOTES:
+ * The request's name, or get.txt or send.txt when it doesn't give one
+ * -----------------------------------------------------------------------*/
+const char *request_file_name (const struct request *req)
+{
+	if (req->name[0] != '\0')
+	{
+		return req->name;
+	}
+	return strcmp(req->command, SEND_COMMAND_NAME) == 0 ? SEND_FILE_NAME : GET_FILE_NAME;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       local_channel_path
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int local_channel_path (char *path, int len)
+ *
+ * RETURNS:        int - 0 on success, -1 if the path doesn't fit in len bytes
+ *
+ * NOTES:
+ * Writes the local socket's default path: $LOCAL_CHANNEL_ENV if set, else LOCAL_CHANNEL_NAME
+ * in $XDG_RUNTIME_DIR, else in the user's LOCAL_CHANNEL_DIR. Client and server run by one
+ * user so agree on the socket without being told.
+ * -----------------------------------------------------------------------*/
+int local_channel_path (char *path, int len)
+{
+	const char	*env;
+	int			n;
+
+	if ((env = getenv(LOCAL_CHANNEL_ENV)) != NULL && env[0] != '\0')
+	{
+		n = snprintf(path, len, "%s", env);
+	}
+	else if ((env = getenv("XDG_RUNTIME_DIR")) != NULL && env[0] != '\0')
+	{
+		n = snprintf(path, len, "%s/%s", env, LOCAL_CHANNEL_NAME);
+	}
+	else
+	{
+		n = snprintf(path, len, LOCAL_CHANNEL_DIR "/%s", (unsigned int)geteuid(), LOCAL_CHANNEL_NAME);
+	}
+	return n < 0 || n >= len ? -1 : 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       local_peer_trusted
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int local_peer_trusted (int sockfd)
+ *
+ * RETURNS:        int - 1 if the peer may be passed or trusted with descriptors, 0 if not
+ *
+ * NOTES:
+ * Reads the credentials the kernel recorded for the other end of a Unix domain socket
+ * (SO_PEERCRED) and trusts a peer running as this user or as root
+ * -----------------------------------------------------------------------*/
+int local_peer_trusted (int sockfd)
+{
+	struct ucred	cred;
+	socklen_t		len = sizeof(cred);
+
+	if (getsockopt(sockfd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == -1 || len != sizeof(cred))
+	{
+		return 0;
+	}
+	return cred.uid == geteuid() || cred.uid == 0;
+}
@@ -0,0 +1,207 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	protocol.h - Wire protocol shared by tclient and tserver
+--
+--	PROGRAM:		tclient, tserver
+--
+--	FUNCTIONS:		encode_frame_header (char *buf, const struct frame_header *header);
+--					decode_frame_header (const char *buf, struct frame_header *header);
+--					parse_request (const char *text, struct request *req);
+--					format_request (char *buf, int buflen, const struct request *req);
+--					valid_file_name (const char *name);
+--					request_file_name (const struct request *req);
+--					local_channel_path (char *path, int len);
+--					local_peer_trusted (int sockfd);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		October 16, 2026 - Pipelined requests
+--					October 16, 2026 - Requests carry key=value parameters (byte ranges)
+--					October 16, 2026 - Resuming interrupted transfers
+--					October 16, 2026 - Compressed DATA frames
+--					October 16, 2026 - Delta uploads
+--					October 16, 2026 - CRC32C trailers on framed transfers (crc=1)
+--					October 16, 2026 - STATS requests
+--					October 16, 2026 - Named files
+--					October 16, 2026 - Data ports negotiated per transfer
+--					October 16, 2026 - Local transfers over a Unix domain socket
+--					October 16, 2026 - Local socket in a private directory; peers' credentials checked
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- Every session starts with a fixed REQ_BUFLEN request on the control channel that the
+-- server echoes back. GET and SEND then move the file over a separate data channel.
+--
+-- A request is a command optionally followed by key=value parameters, for example
+-- "GET offset=1048576 length=4096". offset and length select a byte range of the file
+-- (the whole file by default); size is the size of the whole file. A SEND with an offset
+-- writes into the existing file instead of replacing it, and its size, when given, is
+-- what the file is cut or extended to. Unknown keys are ignored.
+--
+-- GET and SEND may name their file with name=<file>; without one a GET reads get.txt and a
+-- SEND writes send.txt. A name is up to FILE_NAME_LEN - 1 letters, digits, '.', '_' and
+-- '-' and doesn't start with '.', so it can only name a file in the server's root directory.
+--
+-- A GET or SEND that asks for port=0 gets a data port of its own: the server opens a
+-- listener for the transfer and answers with "port=<P>" in place of the plain echo, and
+-- the client connects to P from any local port to receive (GET) or send (SEND) the file.
+-- A server that can't open one echoes port=0 back; the client then falls back to the
+-- fixed ports, where SERVER_DATA_CHANNEL_PORT accepts the data connections of SENDs and a
+-- GET's server connects back to CLIENT_DATA_CHANNEL_PORT. Either side's data port waits
+-- DATA_PORT_TIMEOUT_MS for its peer before giving up on the transfer. Servers from before
+-- the key only serve a bare "GET" or "SEND", so they leave the transfer unanswered and
+-- the client gives up after that wait.
+--
+-- A client on the server's own machine may instead connect to the server's Unix domain
+-- socket and make a whole-file GET or SEND there, with no data channel: the file travels
+-- as an open descriptor (SCM_RIGHTS) beside a REQ_BUFLEN message. The socket is the one
+-- named by the LOCAL_CHANNEL_ENV environment variable, or else LOCAL_CHANNEL_NAME in
+-- $XDG_RUNTIME_DIR or in LOCAL_CHANNEL_DIR, a directory of the user's own. Neither side
+-- passes or accepts a descriptor before checking that the peer runs as the same user (or
+-- root), so the socket is no way into another user's files.
+--
+--   GET:   client "GET name=N"             -> server "GET name=N size=S" + the file, read-only
+--   SEND:  client "SEND name=N" + the file -> server "SEND name=N size=S" once it is stored
+--
+-- The receiving side copies the file itself, in the kernel where it can. A server that
+-- can't serve the request closes the connection without replying.
+--
+-- A MUX request instead keeps the control connection open and switches it to framed
+-- mode: every message after the echo is a FRAME_HEADER_LEN header (type, flags, two
+-- reserved bytes and a 32-bit big-endian payload length) followed by its payload.
+-- REQUEST and ACK payloads are at most MAX_REQUEST_LEN bytes, which leaves room for a name
+-- beside every parameter; the control channel's fixed REQ_BUFLEN request is unchanged.
+--
+--   GET:   client REQUEST "GET"   -> server ACK "GET size=S offset=O length=L", DATA..., END
+--   SEND:  client REQUEST "SEND"  -> server ACK "SEND size=S"
+--          client DATA..., END    -> server END once the file is stored
+--
+-- Any number of transfers may follow each other on the same connection; an ERROR frame
+-- carrying a message rejects a request.
+--
+-- Requests may be pipelined: a client can send its next REQUEST frames without waiting
+-- for replies, which come back in request order. A SEND's DATA frames and END may follow
+-- its REQUEST straight away; if the server rejects the SEND it replies with ERROR only
+-- and drops the data up to the END.
+--
+-- An interrupted transfer is resumed from the bytes the receiver already has. A GET asks
+-- for "GET offset=<local size>". For a SEND the client first learns the size of the stored
+-- file from the ACK of an empty "SEND offset=0 length=0", then sends the rest with
+-- "SEND offset=<stored size> size=<file size>".
+--
+-- A framed GET or SEND may ask for compression with compress=<level>; the server's ACK
+-- repeats the level it will use, and a server that leaves it out sends plain data. Each
+-- DATA frame with FRAME_FLAG_COMPRESSED set holds one block compressed as described in
+-- compress.h, of at most MAX_FRAME_PAYLOAD bytes once decompressed. Either side may send
+-- any DATA frame uncompressed, which they do for data that doesn't compress.
+--
+-- A delta upload only sends what changed since the server's copy of the file:
+--
+--   DELTA: client REQUEST "SEND delta=B"  -> server ACK "SEND size=S delta=B",
+--                                            SIGNATURES..., END
+--          client DATA/COPY..., END       -> server END once the file is stored
+--
+-- B is the block size the client would like, which the server may adjust; S is the size of
+-- the server's copy. SIGNATURES frames carry one signature (see delta.h) per B byte block of
+-- that copy, in order; only its last block may be short. The client then rebuilds its file
+-- in order from DATA frames of literal bytes and COPY frames, each naming a run of the
+-- server's blocks: a 32-bit block index and a 32-bit block count, big-endian. The server
+-- builds the new file beside the old one and only replaces it at the END.
+--
+-- A framed transfer that asks for crc=1 is checked end to end: the END frame that closes
+-- its DATA carries the CRC32C (see checksum.h) of the file bytes the transfer covers, as
+-- they were before compression, in CHECKSUM_LEN big-endian bytes. For a delta upload that
+-- is the CRC of the whole new file. A receiver that computes a different CRC fails the
+-- transfer; the server answers such a SEND with ERROR instead of END.
+--
+-- A STATS request asks for the server's counters instead of a file. After the echo the
+-- server writes them on the control connection as text, one "name value" line each, and
+-- closes it.
+---------------------------------------------------------------------------------------*/
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+
+// Default ports
+#define SERVER_CONTROL_CHANNEL_PORT		7005
+#define SERVER_DATA_CHANNEL_PORT		7006
+#define CLIENT_CONTROL_CHANNEL_PORT		4611
+#define CLIENT_DATA_CHANNEL_PORT		4612
+
+// How long a data port waits for its peer to connect
+#define DATA_PORT_TIMEOUT_MS	10000
+
+// Unix domain socket of local transfers
+#define LOCAL_CHANNEL_ENV		"TSERVER_SOCKET"		// Names the socket, overriding the rest
+#define LOCAL_CHANNEL_NAME		"tserver.sock"		// Socket's name in its directory
+#define LOCAL_CHANNEL_DIR		"/tmp/tserver-%u"	// Directory without $XDG_RUNTIME_DIR, by user ID
+
+// Control channel request length
+#define REQ_BUFLEN				80
+
+// Longest request or acknowledgement carried in a frame
+#define MAX_REQUEST_LEN			256
+
+// Files named by requests
+#define FILE_NAME_LEN			32				// Longest name, with its terminating NUL
+#define GET_FILE_NAME			"get.txt"		// Read by a GET without a name
+#define SEND_FILE_NAME			"send.txt"		// Written by a SEND without a name
+
+// Request commands
+#define GET_COMMAND_NAME		"GET"
+#define SEND_COMMAND_NAME		"SEND"
+#define MUX_COMMAND_NAME		"MUX"
+#define STATS_COMMAND_NAME		"STATS"
+
+// Frame types
+#define FRAME_REQUEST			1
+#define FRAME_ACK				2
+#define FRAME_DATA				3
+#define FRAME_END				4
+#define FRAME_ERROR				5
+#define FRAME_SIGNATURES		6
+#define FRAME_COPY				7
+
+// Frame flags
+#define FRAME_FLAG_COMPRESSED	0x01
+
+#define FRAME_HEADER_LEN		8
+#define MAX_FRAME_PAYLOAD		(256 * 1024)
+#define COPY_PAYLOAD_LEN		8
+#define CHECKSUM_LEN			4
+
+struct frame_header
+{
+	uint8_t		type;
+	uint8_t		flags;
+	uint32_t	length;
+};
+
+// A parsed request; parameters that weren't given are -1
+struct request
+{
+	char		command[16];
+	char		name[FILE_NAME_LEN];	// File to transfer; empty for the command's default
+	long long	offset;
+	long long	length;
+	long long	size;
+	long long	compress;		// Compression level
+	long long	delta;			// Block size of a delta upload
+	long long	crc;			// 1 for CRC32C trailers
+	long long	port;			// Data port of a legacy transfer; 0 asks the server for one
+};
+
+void encode_frame_header (char *buf, const struct frame_header *header);
+void decode_frame_header (const char *buf, struct frame_header *header);
+int parse_request (const char *text, struct request *req);
+void format_request (char *buf, int buflen, const struct request *req);
+int valid_file_name (const char *name);
+const char *request_file_name (const struct request *req);
+int local_channel_path (char *path, int len);
+int local_peer_trusted (int sockfd);
+
+#endif
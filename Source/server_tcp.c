@@ -4,17 +4,125 @@
 --	PROGRAM:		tserver
 --
 --	FUNCTIONS:		init_server_control_channel (int *control_channel_socket, struct sockaddr_in *server, int server_len);
---					accept_client_connection (int *client_socket, int control_channel_socket, struct sockaddr_in *client);
---					receive_client_request (char *ack_request, int client_socket);
 --					init_server_data_channel (int *data_channel_socket, struct sockaddr_in *server, int server_len);
---					process_request (char *ack_request, int data_channel_socket, struct sockaddr_in client, int *client_socket);
---					connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_entity_len);
---					send_file (FILE *fp, int sockfd);
---					write_file(int sockfd);
+--					init_event_loop (struct event_loop *loop, int use_ring);
+--					run_event_loop (struct event_loop *loop);
+--					poll_events (struct event_loop *loop, int timeout);
+--					watch_connection (struct event_loop *loop, struct connection *conn);
+--					close_connection (struct event_loop *loop, struct connection *conn);
+--					accept_client_connection (struct event_loop *loop, struct connection *listener);
+--					add_client_connection (struct event_loop *loop, int client_socket, struct sockaddr_in *client);
+--					receive_client_request (struct event_loop *loop, struct connection *conn);
+--					start_session (struct event_loop *loop, struct connection *conn);
+--					process_request (struct event_loop *loop, struct connection *conn);
+--					open_request_file (struct connection *conn);
+--					close_request_file (struct connection *conn);
+--					accept_data_connection (struct event_loop *loop, struct connection *listener);
+--					pair_data_connection (struct event_loop *loop, int client_socket, struct sockaddr_in *client);
+--					connect_to_client (struct event_loop *loop, struct connection *conn);
+--					finish_connect (struct event_loop *loop, struct connection *conn);
+--					schedule_retry (struct event_loop *loop, struct connection *conn);
+--					arm_timer (struct event_loop *loop, struct connection *conn, long long at);
+--					disarm_timer (struct event_loop *loop, struct connection *conn);
+--					expire_timer (struct event_loop *loop, struct connection *conn);
+--					send_file (struct event_loop *loop, struct connection *conn);
+--					write_file (struct event_loop *loop, struct connection *conn);
+--					new_connection (int fd, enum connection_kind kind, enum connection_state state);
+--					init_worker_pool (struct worker_pool *pool, int count, int use_ring);
+--					worker_main (void *arg);
+--					dispatch_session (struct event_loop *loop, struct connection *conn);
+--					receive_handoffs (struct event_loop *loop);
+--					unwatch_connection (struct event_loop *loop, struct connection *conn);
+--					handle_mux_connection (struct event_loop *loop, struct connection *conn);
+--					receive_frames (struct event_loop *loop, struct connection *conn);
+--					process_mux_request (struct event_loop *loop, struct connection *conn);
+--					send_mux_file (struct event_loop *loop, struct connection *conn);
+--					queue_frame (struct connection *conn, int type, int flags, const char *payload, int len);
+--					flush_frames (struct event_loop *loop, struct connection *conn);
+--					send_file_chunk (struct connection *conn, size_t max);
+--					compress_file_block (struct connection *conn, int len);
+--					start_delta (struct connection *conn);
+--					send_signatures (struct event_loop *loop, struct connection *conn);
+--					copy_blocks (struct connection *conn);
+--					finish_upload (struct connection *conn);
+--					abort_upload (struct connection *conn);
+--					queue_end (struct connection *conn);
+--					verify_checksum (struct connection *conn);
+--					read_at (int fd, char *data, int len, off_t offset);
+--					write_all (int fd, const char *data, int len, off_t offset);
+--					run_ring (struct event_loop *loop, int timeout);
+--					complete_ring_op (struct event_loop *loop, struct ring_op *op, int res, int more);
+--					queue_ring_op (struct event_loop *loop, struct ring_op *op, int opcode, int fd, const void *addr, unsigned len, off_t offset);
+--					ring_poll_events (struct event_loop *loop);
+--					ring_accept (struct event_loop *loop, struct connection *conn);
+--					ring_receive_request (struct event_loop *loop, struct connection *conn);
+--					start_ring_transfer (struct event_loop *loop, struct connection *conn);
+--					ring_send_file (struct event_loop *loop, struct connection *conn);
+--					ring_write_file (struct event_loop *loop, struct connection *conn);
+--					start_transfer (struct event_loop *loop, struct connection *conn);
+--					end_transfer (struct event_loop *loop, struct connection *conn, int completed);
+--					send_stats (struct event_loop *loop, struct connection *conn);
+--					format_stats (char *buf, int buflen);
+--					trace_phase (struct event_loop *loop, struct connection *conn, const char *name);
+--					run_shards (int *control_channel_socket, int *data_channel_socket, struct sockaddr_in *server);
+--					start_shard (int shard, const int *sockets);
+--					stop_shards (int signo);
+--					steer_connections (int listen_socket);
+--					open_temp_file (struct connection *conn);
+--					flush_upload (struct connection *conn);
+--					stop_direct_io (struct connection *conn);
+--					alloc_buffer (size_t len);
+--					open_data_port (struct connection *conn);
+--					accept_data_port (struct event_loop *loop, struct connection *conn);
+--					init_server_local_channel (int *local_channel_socket);
+--					accept_local_connection (struct event_loop *loop, struct connection *listener);
+--					receive_local_request (struct event_loop *loop, struct connection *conn);
+--					process_local_request (struct event_loop *loop, struct connection *conn);
+--					send_local_reply (struct connection *conn, int fd);
+--					copy_file_data (struct connection *conn, int fd, off_t from, off_t len);
+--					splice_to_file (struct connection *conn);
+--					send_allowance (struct event_loop *loop, struct connection *conn, long long want);
+--					charge_send (struct connection *conn, long long bytes);
+--					end_sending (struct event_loop *loop, struct connection *conn);
+--					queue_ready (struct event_loop *loop, struct connection *conn);
+--					dequeue_ready (struct event_loop *loop, struct connection *conn);
+--					run_ready (struct event_loop *loop);
+--					resume_sending (struct event_loop *loop, struct connection *conn);
+--					unlink_pending_send (struct event_loop *loop, struct connection *conn);
+--					copy_local_file (struct event_loop *loop, struct connection *conn);
+--					local_channel_dir_private (const char *path);
+--					local_channel_in_use (const char *path);
+--					pause_accepts (struct event_loop *loop, struct connection *listener);
+--					retry_accept (struct event_loop *loop, struct connection *listener);
 --
 --	DATE:			October 4, 2020
 --
---	REVISIONS:		N/A
+--	REVISIONS:		October 16, 2026 - Replaced the blocking accept/recv/send sequence with an
+--					edge-triggered epoll event loop
+--					October 16, 2026 - Transfers run on a pool of worker threads
+--					October 16, 2026 - GET files are sent with sendfile(2)
+--					October 16, 2026 - Uploads are written byte-exact
+--					October 16, 2026 - Framed single-connection (MUX) protocol mode
+--					October 16, 2026 - GET connect-backs use bounded exponential backoff
+--					October 16, 2026 - Optional io_uring backend for accepts, requests and transfers
+--					October 16, 2026 - MUX requests may be pipelined
+--					October 16, 2026 - GET/SEND of byte ranges with positional file I/O
+--					October 16, 2026 - SEND acknowledgements report the stored file's size
+--					October 16, 2026 - Compressed DATA frames
+--					October 16, 2026 - Delta uploads
+--					October 16, 2026 - GET files are served from an in-memory cache
+--					October 16, 2026 - CRC32C trailers on framed transfers
+--					October 16, 2026 - Counters and latency histograms reported by STATS
+--					October 16, 2026 - Optional span tracing of sessions (-t)
+--					October 16, 2026 - Named files served from a root directory (-r) through an index
+--					October 16, 2026 - SO_REUSEPORT shards under a supervisor (-s) and a configurable backlog (-q)
+--					October 16, 2026 - Uploads written in whole aligned buffers, preallocated and swapped in
+--					by rename; optional O_DIRECT for huge ones (-d)
+--					October 16, 2026 - Legacy transfers may get a data port of their own, ephemeral or from a pool (-p)
+--					October 16, 2026 - Local clients transfer over a Unix domain socket, passing the file itself
+--					October 16, 2026 - Legacy uploads are spliced from the socket to the file
+--					October 16, 2026 - Sending sessions take turns; per-client (-c) and egress (-e) rate limits
+--					October 16, 2026 - Local socket path (-l) in a private directory; local peers' credentials checked
 --
 --
 --	DESIGNERS:		Derek Wong
@@ -25,7 +133,122 @@
 -- The program will accept TCP connections from client machines.
 -- The program will read requests from clients (e.g., GET/SEND) and echo the commands back
 -- A separate data channel port will be used to transfer files between the client and server
+--
+-- All sockets are non-blocking and driven by a single edge-triggered epoll loop. Every
+-- control and data connection carries its own state, so a slow client only ever holds up
+-- its own transfer.
+--
+-- The main thread accepts control connections, echoes requests and pairs SEND data
+-- connections. Each acknowledged session is then handed to one of the worker threads
+-- (one per core by default, see -w) through a lock-free queue, and that worker runs the
+-- file transfer on its own event loop.
+--
+-- A MUX request switches the control connection to the framed protocol described in
+-- protocol.h. The connection is handed to a worker as a whole and carries any number of
+-- GET/SEND transfers without a separate data channel; legacy clients are unaffected.
+-- Clients may pipeline their requests: the worker only reads the next request once the
+-- previous one is answered, so replies go out in request order.
+--
+-- Requests may select a byte range of the file (see protocol.h). Files are only read and
+-- written at explicit offsets, so clients can move the ranges of one large file over
+-- several connections at once.
+--
+-- A framed GET that asks for compression is sent in compressed DATA frames, and compressed
+-- frames of a SEND are decompressed before they are written (see compress.h).
+--
+-- A delta SEND is answered with the signatures of the current copy of its file; the
+-- client's literal data and block references are then assembled into a hidden temporary
+-- file, copied in the kernel with copy_file_range where possible, which replaces the file
+-- at the END.
+--
+-- A framed transfer that asks for crc=1 carries the CRC32C of its data in the END frame
+-- (see protocol.h). GETs computing one read the file through the copy buffer instead of
+-- sendfile, since the CRC needs the bytes; a SEND whose CRC doesn't match is answered with
+-- ERROR.
+--
+-- GETs are served from an in-memory copy of the file when the file cache has one (see
+-- file_cache.h). The cache is shared by all workers and limited to -m megabytes; -m 0
+-- turns it off and every GET reads the file from disk.
+--
+-- With -b uring each event loop drives its accepts, control requests and file transfers
+-- through an io_uring instead: requests are queued as the previous ones complete and a
+-- whole batch is submitted with the same system call that waits for completions. A
+-- transfer keeps two buffers in flight, so the file and the socket work in parallel.
+-- The epoll instance stays registered with the ring for everything else (connect-backs,
+-- MUX connections and handoffs), and kernels without io_uring fall back to epoll.
+--
+-- Each event loop counts its connections, bytes and transfers, and times every transfer
+-- from its request to its completion (see stats.h). A STATS request on the control
+-- channel is answered with the totals over all loops as "name value" lines, so the
+-- server can be scraped while it runs.
+--
+-- With -t file every session is traced: the time from its accept to its request, to the
+-- echo, waiting for a SEND's data connection, waiting for a worker, a GET's connect-back
+-- (retries included) and each transfer are written to file as spans (see trace.h), one
+-- row per session, along with the binding of the data channel at startup. Without -t
+-- each of those points costs one NULL check.
+--
+-- GET and SEND name the file they transfer (see protocol.h), which lives in the root
+-- directory given with -r (the working directory by default). GETs look their file up in
+-- an index of the directory (see file_index.h) and fail at once if it isn't there; every
+-- stored SEND updates the index. A request without a name still gets get.txt or send.txt.
+--
+-- With -s N the server runs as N shard processes (-s 0 starts one per core) under a
+-- supervising parent. Every shard binds its own SO_REUSEPORT control and data sockets, so
+-- the kernel spreads accepts over the shards instead of one process taking them all. A
+-- small BPF program steers each connection by its client's address, which keeps a
+-- client's control and data connections on the same shard, as SEND pairing needs. The
+-- supervisor holds on to every shard's sockets and restarts a shard that exits on the
+-- same ones, so connections arriving meanwhile wait in the backlog. Each shard has its
+-- own workers (by default the cores divided among the shards), file cache, index and
+-- counters; STATS reports those of the shard that answers it, and -t traces each shard
+-- to its own file, named after the shard. The listen backlog of every socket is set
+-- with -q.
+--
+-- A SEND of a whole file is written to a hidden temporary file beside the old one and
+-- renamed over it once complete, so GETs never see half an upload and a failed one leaves
+-- the old file alone; ranged SENDs, which may share their file with other connections,
+-- write in place. A SEND that gives its size has the space set aside with fallocate first.
+-- Received data is collected in large aligned buffers and written a whole buffer at a
+-- time, however little each recv returns. With -d N, whole-file uploads of at least N
+-- megabytes are written with O_DIRECT, bypassing the page cache, up to their last block.
+-- The data of a legacy SEND on the epoll backend doesn't even pass through the buffer: it
+-- is spliced from the socket into a pipe and from the pipe into the file, so it never
+-- leaves the kernel. Files that can't be spliced to, and O_DIRECT ones, use the buffer.
+--
+-- A legacy GET or SEND that asks for port=0 (see protocol.h) gets a listener of its own,
+-- opened before the echo, which carries its port. The client connects to it for either
+-- direction, so transfers from any number of clients on one host no longer compete for
+-- the fixed data ports and a GET needs no connect-back. The ports are ephemeral, or taken
+-- in turn from the range given with -p, skipping those still in use. A port nobody
+-- connects to within DATA_PORT_TIMEOUT_MS is closed with its session. Clients that don't
+-- ask keep the fixed ports.
+--
+-- Clients on this machine may skip TCP altogether: the server also listens on a Unix
+-- domain socket (shared by all shards), where a GET or SEND is one request and one reply
+-- with the file passed as a descriptor (see protocol.h). The socket is the one given with
+-- -l, else the user's default from local_channel_path; its directory is made private to
+-- the user if missing, and refused if others could replace the socket in it. A socket
+-- left behind is only replaced once connecting to it shows no server is listening, and
+-- clients not running as the server's user (or root) are turned away unheard. A worker
+-- answers a GET with the file it opened; it copies a SEND's file into the new file with
+-- copy_file_range, in the kernel, before it replies. The copy takes turns with the worker's
+-- other sessions, LOCAL_COPY_CHUNK bytes at a time. No file data crosses a socket.
+--
+-- Every loop shares the link among its sending sessions in turns. A session sends a
+-- quantum of SCHED_QUANTUM bytes, divided by the number of transfers its client has
+-- running, then goes to the back of the loop's ready queue; the queue is served after
+-- each poll, so busy sessions take turns with each other and with new requests, and a
+-- client opening many transfers gets no more than one opening a single one. With -c the
+-- bytes sent to each client address are further limited to that many kilobytes a second,
+-- and with -e those sent to all of them together (see bandwidth.h); in sharded mode each
+-- shard gets its share of -e. A session out of tokens waits on its timer for them.
+-- Legacy GETs stay on epoll when either limit is set, since the ring would send their
+-- data behind the scheduler's back.
+--
+-- Build: gcc -Wall -o tserver server_tcp.c protocol.c connect_retry.c uring.c compress.c delta.c file_cache.c file_index.c checksum.c histogram.c stats.c trace.c bandwidth.c -pthread
 ---------------------------------------------------------------------------------------*/
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,48 +257,404 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
-#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <linux/filter.h>
+#include <limits.h>
 
-// Default ports
-#define SERVER_CONTROL_CHANNEL_PORT		7005
-#define SERVER_DATA_CHANNEL_PORT 		7006
-#define CLIENT_DATA_CHANNEL_PORT		4612
+#include "protocol.h"
+#include "connect_retry.h"
+#include "uring.h"
+#include "compress.h"
+#include "delta.h"
+#include "file_cache.h"
+#include "file_index.h"
+#include "checksum.h"
+#include "stats.h"
+#include "trace.h"
+#include "bandwidth.h"
 
 //Buffer length
-#define REQ_BUFLEN		80
-#define FILE_BUFLEN		1024
+#define TRANSFER_BUFLEN	(256 * 1024)	// Socket/file copy buffer for transfers
+
+// Compressed DATA frames are built in, and decompressed into, the copy buffers
+_Static_assert(TRANSFER_BUFLEN >= MAX_FRAME_PAYLOAD, "a whole frame payload must fit in a copy buffer");
+#define SENDFILE_CHUNK	(4 * 1024 * 1024)	// Most bytes handed to one sendfile call
+#define LOCAL_COPY_CHUNK	(4 * 1024 * 1024)	// Most bytes of a local SEND copied per turn
+
+// Uploads
+#define DIRECT_IO_ALIGN	4096	// Alignment of the buffers, offsets and lengths of O_DIRECT writes
+_Static_assert(TRANSFER_BUFLEN % DIRECT_IO_ALIGN == 0, "whole copy buffers must be O_DIRECT writes");
+
+// Event loop
+#define MAX_EVENTS		256
+#define ACCEPT_RETRY_MS		100		// How long a listener waits for a free descriptor before accepting again
+#define DEFAULT_LISTEN_BACKLOG	SOMAXCONN
+
+// Sharded mode
+#define SHARD_RESTART_DELAY_MS	1000	// Least time between two starts of a shard
+
+// Worker pool
+#define HANDOFF_QUEUE_LEN	4096	// Must be a power of two
 
-// Default strings
-#define GET_COMMAND_NAME		"GET"
-#define SEND_COMMAND_NAME		"SEND"
-#define SEND_FILE_NAME			"send.txt"
-#define GET_FILE_NAME			"get.txt"
+// File cache
+#define DEFAULT_CACHE_MB	256
+
+// STATS replies are written in one go, so they must fit an empty socket send buffer
+#define STATS_BUFLEN	4096
+
+// Bandwidth scheduler
+#define SCHED_QUANTUM		(512 * 1024)	// Bytes a client's sessions send per turn, between them
+#define SCHED_MIN_QUANTUM	(16 * 1024)		// Least a session sends per turn
+
+// io_uring backend
+#define RING_ENTRIES	256		// Requests queued per submission
+#define RING_SLOTS		2		// Transfer buffers kept in flight per connection
 
 #define SERVER_IS_UP			1
 #define TRUE					1
-#define NOT_CONNECTED			1
-#define DEFAULT_SLEEP_TIME		1
+#define FALSE					0
+
+// What a socket registered with the event loop is used for
+enum connection_kind
+{
+	CONTROL_LISTENER,
+	DATA_LISTENER,
+	CONTROL_CONNECTION,
+	DATA_CONNECTION,
+	MUX_CONNECTION,
+	LOCAL_LISTENER,
+	LOCAL_CONNECTION,
+	HANDOFF_EVENT
+};
+
+// Where a connection is in its request/transfer sequence
+enum connection_state
+{
+	LISTENING,
+	READING_REQUEST,
+	WRITING_ACK,
+	AWAITING_DATA_CONNECTION,
+	ACCEPTING_DATA,
+	CONNECTING,
+	RETRY_WAIT,
+	SENDING_FILE,
+	RECEIVING_FILE,
+	MUX_IDLE,
+	MUX_SENDING,
+	MUX_SIGNING,
+	MUX_RECEIVING
+};
+
+// Where a sending session is in its loop's turns
+enum send_turn
+{
+	TURN_NONE,				// Not sending, or its turn is over
+	TURN_RUNNING,			// Sending what is left of its quantum
+	TURN_READY,				// Quantum used up; queued for its next turn
+	TURN_THROTTLED			// Waiting on its timer for tokens
+};
+
+// What an io_uring request is doing for its connection
+enum ring_op_type
+{
+	RING_POLL_EVENTS,
+	RING_ACCEPT,
+	RING_RECV_REQUEST,
+	RING_SEND_ACK,
+	RING_READ_FILE,
+	RING_SEND_DATA,
+	RING_RECV_DATA,
+	RING_WRITE_FILE
+};
+
+// One transfer buffer and the io_uring request using it; its address is the request's user_data
+struct ring_op
+{
+	struct connection		*conn;
+	enum ring_op_type		type;
+	int						busy;						// Submitted and not completed yet
+	char					*data;
+	int						len;						// Bytes held in data
+	int						done;						// Bytes of data already sent or written
+	off_t					offset;						// File offset of data
+};
+
+// A client session; starts as a control connection and is reused for its data connection
+struct connection
+{
+	int						fd;
+	enum connection_kind	kind;
+	enum connection_state	state;
+	struct sockaddr_in		peer;
+	int						port_fd;					// Listener on the session's own data port, until the echo is sent
+	long long				port_deadline;				// now_ms() when the data port gives up on its client
+	char					request[MAX_REQUEST_LEN];	// Control channel request, or framed request
+	int						request_len;
+	int						ack_len;
+	struct request			req;						// Parsed request
+	int						file_fd;
+	struct cached_file		*cached;					// In-memory copy of a GET's file, used instead of file_fd
+	off_t					file_offset;				// Next file byte read or written
+	int						zero_copy;
+	char					*buffer;
+	int						buffer_len;
+	int						buffer_off;
+	struct backoff			backoff;					// Connect-back retry schedule
+	int						timer_armed;
+	long long				timer_at;					// now_ms() deadline of the armed timer
+	struct connection		*timer_prev;
+	struct connection		*timer_next;
+	struct connection		*next;
+
+	// Sending sessions only
+	enum send_turn			turn;
+	long long				turn_left;					// Bytes left of the current quantum
+	struct connection		*ready_prev;
+	struct connection		*ready_next;
+	struct client_share		*share;						// Client's share of the bandwidth; NULL until it sends
+
+	// Framed (MUX) connections only
+	char					frame[FRAME_HEADER_LEN];	// Header of the incoming frame
+	int						frame_len;
+	struct frame_header		header;
+	uint32_t				payload_left;				// Incoming payload bytes not read yet
+	char					out[FRAME_HEADER_LEN + MAX_REQUEST_LEN];	// Queued outgoing frame
+	int						out_len;
+	int						out_off;
+	uint32_t				data_left;					// Outgoing DATA payload bytes not sent yet
+	int						data_buffered;				// The DATA payload is in buffer, not the file
+	off_t					file_left;					// File bytes not framed yet
+	struct compressor		compressor;					// Compresses the DATA frames of a GET
+	char					*zbuf;						// Second buffer for compressed payloads
+	uint32_t				crc;						// CRC32C of the transfer's data so far, with crc=1
+	long long				transfer_start;				// now_ns() when the running transfer was requested; 0 if none
+	unsigned long long		session;					// Numbers the sessions in order of their accepts
+	long long				trace_mark;					// now_ns() when the session's current span began
+
+	// Uploads only
+	char					temp_name[FILE_NAME_LEN + 8];	// New file, until it replaces the old one
+	int						direct;						// file_fd is open with O_DIRECT
+	int						local_fd;					// Client's file, passed with a local SEND
+	int						pipe_fds[2];				// Pipe a legacy upload is spliced through
+
+	// Delta uploads only
+	int						base_fd;					// Copy of the file the client's delta refers to
+	off_t					base_size;
+	int						block_size;
+
+	// io_uring backend only
+	struct ring_op			ring_ops[RING_SLOTS];
+	int						ring_busy;					// Requests the ring has not completed yet
+	int						ring_next;					// Slot whose buffer is sent next
+	off_t					ring_offset;				// File offset of the next read or received byte
+	off_t					ring_size;					// End of the range being sent
+	int						ring_eof;					// The client finished sending
+	int						closing;					// Closed; freed once ring_busy drops to zero
+	socklen_t				peer_len;
+};
+
+// Single-producer, single-consumer ring of sessions handed from the acceptor to a worker
+struct handoff_queue
+{
+	struct connection	*slots[HANDOFF_QUEUE_LEN];
+	_Atomic size_t		head;				// Next slot the worker takes
+	_Atomic size_t		tail;				// Next slot the acceptor fills
+};
+
+struct event_loop
+{
+	int					epoll_fd;
+	struct server_stats	stats;				// Counters only this loop's thread updates
+	struct trace_ring	*trace;				// Spans of this loop's sessions; NULL unless tracing
+	struct connection	*timers;			// GET sessions waiting to reconnect or on a connect attempt, throttled senders; earliest deadline first
+	struct connection	*timers_tail;		// Latest deadline
+	struct connection	*pending_sends;		// SEND sessions waiting for the client data connection
+	struct connection	*ready_head;		// Sending sessions and local copies waiting for their next turn, oldest first
+	struct connection	*ready_tail;
+	int					ready_count;
+	int					wakeup_fd;			// Signalled when sessions are handed to this loop
+	struct handoff_queue	handoff;
+	struct worker_pool	*pool;				// Workers to hand sessions to; NULL on a worker
+	struct uring		*ring;				// Completion backend; NULL when epoll drives everything
+	struct ring_op		events_op;			// Ring request watching epoll_fd
+};
+
+struct worker
+{
+	pthread_t			thread;
+	struct event_loop	loop;
+};
+
+struct worker_pool
+{
+	int					count;
+	int					next;				// Round-robin position of the next handoff
+	struct worker		*workers;
+};
 
 // Function prototypes
 void init_server_control_channel (int *control_channel_socket, struct sockaddr_in *server, int server_len);
-void accept_client_connection (int *client_socket, int control_channel_socket, struct sockaddr_in *client);
-void receive_client_request (char *ack_request, int client_socket);
 void init_server_data_channel (int *data_channel_socket, struct sockaddr_in *server, int server_len);
-void process_request (char *ack_request, int data_channel_socket, struct sockaddr_in client, int *client_socket);
-void connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_entity_len);
-void send_file (FILE *fp, int sockfd);
-void write_file (int sockfd);
+void init_event_loop (struct event_loop *loop, int use_ring);
+void run_event_loop (struct event_loop *loop);
+int poll_events (struct event_loop *loop, int timeout);
+void watch_connection (struct event_loop *loop, struct connection *conn);
+void close_connection (struct event_loop *loop, struct connection *conn);
+void accept_client_connection (struct event_loop *loop, struct connection *listener);
+void add_client_connection (struct event_loop *loop, int client_socket, struct sockaddr_in *client);
+void receive_client_request (struct event_loop *loop, struct connection *conn);
+void start_session (struct event_loop *loop, struct connection *conn);
+void process_request (struct event_loop *loop, struct connection *conn);
+int open_request_file (struct connection *conn);
+void close_request_file (struct connection *conn);
+void accept_data_connection (struct event_loop *loop, struct connection *listener);
+void pair_data_connection (struct event_loop *loop, int client_socket, struct sockaddr_in *client);
+void connect_to_client (struct event_loop *loop, struct connection *conn);
+void finish_connect (struct event_loop *loop, struct connection *conn);
+void schedule_retry (struct event_loop *loop, struct connection *conn);
+void arm_timer (struct event_loop *loop, struct connection *conn, long long at);
+void disarm_timer (struct event_loop *loop, struct connection *conn);
+void expire_timer (struct event_loop *loop, struct connection *conn);
+void send_file (struct event_loop *loop, struct connection *conn);
+void write_file (struct event_loop *loop, struct connection *conn);
+struct connection *new_connection (int fd, enum connection_kind kind, enum connection_state state);
+void init_worker_pool (struct worker_pool *pool, int count, int use_ring);
+void *worker_main (void *arg);
+void dispatch_session (struct event_loop *loop, struct connection *conn);
+void receive_handoffs (struct event_loop *loop);
+void unwatch_connection (struct event_loop *loop, struct connection *conn);
+void handle_mux_connection (struct event_loop *loop, struct connection *conn);
+int receive_frames (struct event_loop *loop, struct connection *conn);
+int process_mux_request (struct event_loop *loop, struct connection *conn);
+int send_mux_file (struct event_loop *loop, struct connection *conn);
+void queue_frame (struct connection *conn, int type, int flags, const char *payload, int len);
+int flush_frames (struct event_loop *loop, struct connection *conn);
+ssize_t send_file_chunk (struct connection *conn, size_t max);
+int compress_file_block (struct connection *conn, int len);
+int start_delta (struct connection *conn);
+int send_signatures (struct event_loop *loop, struct connection *conn);
+int copy_blocks (struct connection *conn);
+int finish_upload (struct connection *conn);
+void abort_upload (struct connection *conn);
+void queue_end (struct connection *conn);
+int verify_checksum (struct connection *conn);
+int read_at (int fd, char *data, int len, off_t offset);
+int write_all (int fd, const char *data, int len, off_t offset);
+void run_ring (struct event_loop *loop, int timeout);
+void complete_ring_op (struct event_loop *loop, struct ring_op *op, int res, int more);
+struct io_uring_sqe *queue_ring_op (struct event_loop *loop, struct ring_op *op, int opcode, int fd, const void *addr, unsigned len, off_t offset);
+void ring_poll_events (struct event_loop *loop);
+void ring_accept (struct event_loop *loop, struct connection *conn);
+void ring_receive_request (struct event_loop *loop, struct connection *conn);
+int start_ring_transfer (struct event_loop *loop, struct connection *conn);
+void ring_send_file (struct event_loop *loop, struct connection *conn);
+void ring_write_file (struct event_loop *loop, struct connection *conn);
+void start_transfer (struct event_loop *loop, struct connection *conn);
+void end_transfer (struct event_loop *loop, struct connection *conn, int completed);
+void send_stats (struct event_loop *loop, struct connection *conn);
+int format_stats (char *buf, int buflen);
+void trace_phase (struct event_loop *loop, struct connection *conn, const char *name);
+int run_shards (int *control_channel_socket, int *data_channel_socket, struct sockaddr_in *server);
+pid_t start_shard (int shard, const int *sockets);
+void stop_shards (int signo);
+void steer_connections (int listen_socket);
+int open_temp_file (struct connection *conn);
+int flush_upload (struct connection *conn);
+int stop_direct_io (struct connection *conn);
+char *alloc_buffer (size_t len);
+void open_data_port (struct connection *conn);
+void accept_data_port (struct event_loop *loop, struct connection *conn);
+void init_server_local_channel (int *local_channel_socket);
+void accept_local_connection (struct event_loop *loop, struct connection *listener);
+void receive_local_request (struct event_loop *loop, struct connection *conn);
+void process_local_request (struct event_loop *loop, struct connection *conn);
+int send_local_reply (struct connection *conn, int fd);
+int copy_file_data (struct connection *conn, int fd, off_t from, off_t len);
+ssize_t splice_to_file (struct connection *conn);
+long long send_allowance (struct event_loop *loop, struct connection *conn, long long want);
+void charge_send (struct connection *conn, long long bytes);
+void end_sending (struct event_loop *loop, struct connection *conn);
+void queue_ready (struct event_loop *loop, struct connection *conn);
+void dequeue_ready (struct event_loop *loop, struct connection *conn);
+void run_ready (struct event_loop *loop);
+void resume_sending (struct event_loop *loop, struct connection *conn);
+void unlink_pending_send (struct event_loop *loop, struct connection *conn);
+void copy_local_file (struct event_loop *loop, struct connection *conn);
+int local_channel_dir_private (const char *path);
+int local_channel_in_use (const char *path);
+void pause_accepts (struct event_loop *loop, struct connection *listener);
+void retry_accept (struct event_loop *loop, struct connection *listener);
+
+// How hard the server tries to reach a client's data channel for a GET
+const struct retry_policy connect_back_policy = DEFAULT_RETRY_POLICY;
+
+// Copies of the files GETs are served from, shared by every worker
+struct file_cache file_cache;
+
+// Files in the root directory, shared by every worker
+struct file_index file_index;
+
+// Rate limits of the file data sent (-e, -c), shared by every worker
+struct bandwidth bandwidth;
+
+// Sessions accepted so far
+_Atomic unsigned long long session_count = 0;
+
+// Connections each listening socket queues (-q)
+int listen_backlog = DEFAULT_LISTEN_BACKLOG;
+
+// Shard processes sharing the ports (-s); 0 when the server runs as one process
+int shard_count = 0;
+
+// Set by SIGTERM/SIGINT in the shard supervisor
+volatile sig_atomic_t shards_stopping = 0;
+
+// Whole-file uploads at least this large bypass the page cache (-d); -1 when none do
+off_t direct_min_size = -1;
+
+// Path of the local socket (-l)
+char local_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+// Range sessions' own data ports are taken from (-p); 0 for ephemeral ports. Only the
+// acceptor opens them, so the next one needs no lock.
+int data_port_first = 0;
+int data_port_last = 0;
+int data_port_next = 0;
 
 /*--------------------------------------------------------------------------
  * FUNCTION:       main
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Hands both listening sockets to the event loop
+ *                 October 16th, 2026 - Starts the transfer worker pool
+ *                 October 16th, 2026 - Selects the epoll or io_uring backend (-b)
+ *                 October 16th, 2026 - Sizes the file cache (-m)
+ *                 October 16th, 2026 - Traces sessions to a file (-t)
+ *                 October 16th, 2026 - Serves files from a root directory (-r)
+ *                 October 16th, 2026 - Runs as SO_REUSEPORT shards (-s) with a configurable backlog (-q)
+ *                 October 16th, 2026 - Writes huge uploads with O_DIRECT (-d)
+ *                 October 16th, 2026 - Takes the pool of per-transfer data ports (-p)
+ *                 October 16th, 2026 - Listens for local clients on a Unix domain socket
+ *                 October 16th, 2026 - Limits the egress (-e) and per-client (-c) bandwidth
+ *                 October 16th, 2026 - Takes the local socket's path (-l)
  *
  * DESIGNER:       Derek Wong
  *
@@ -86,26 +665,202 @@ void write_file (int sockfd);
  * RETURNS:        int
  *
  * NOTES:
- * Main entrypoint into client application
+ * Main entrypoint into server application
  * -----------------------------------------------------------------------*/
 int main (int argc, char **argv)
 {
-	int	control_channel_socket, data_channel_socket, client_socket;
-	struct	sockaddr_in server, client;
-	char	ack_request[REQ_BUFLEN];
-	
-	init_server_control_channel(&control_channel_socket, &server, sizeof(server));
+	int	control_channel_socket, data_channel_socket, local_channel_socket, option, i;
+	int	cores = (int)sysconf(_SC_NPROCESSORS_ONLN), worker_count = cores, workers_given = FALSE;
+	int	use_ring = FALSE, shard;
+	long	cache_mb = DEFAULT_CACHE_MB;
+	long long	bind_start = 0, bind_end = 0, egress_kb = 0, client_kb = 0;
+	char	*trace_path = NULL, *root = ".", shard_trace[PATH_MAX];
+	struct	sockaddr_in server;
+	struct	event_loop loop;
+	struct	worker_pool pool;
+	struct	connection *listeners[2];
 
-	while (SERVER_IS_UP)
+	// Get user parameters
+	// Peer resets are handled where send/sendfile report them
+	signal(SIGPIPE, SIG_IGN);
+
+	while ((option = getopt(argc, argv, "w:b:m:t:r:s:q:d:p:e:c:l:")) != -1)
+	{
+		switch (option)
+		{
+			case 'w':
+				worker_count = atoi(optarg);
+				workers_given = TRUE;
+			break;
+			case 'b':
+				if (strcmp(optarg, "uring") == 0)
+				{
+					use_ring = TRUE;
+				}
+				else if (strcmp(optarg, "epoll") != 0)
+				{
+					worker_count = -1;
+				}
+			break;
+			case 'm':
+				if ((cache_mb = atol(optarg)) < 0)
+				{
+					worker_count = -1;
+				}
+			break;
+			case 't':
+				trace_path = optarg;
+			break;
+			case 'r':
+				root = optarg;
+			break;
+			case 's':
+				if ((shard_count = atoi(optarg)) < 0)
+				{
+					worker_count = -1;
+				}
+				shard_count = shard_count == 0 ? cores : shard_count;
+			break;
+			case 'q':
+				if ((listen_backlog = atoi(optarg)) < 1)
+				{
+					worker_count = -1;
+				}
+			break;
+			case 'd':
+				if ((direct_min_size = atoll(optarg)) < 0)
+				{
+					worker_count = -1;
+				}
+				direct_min_size *= 1024 * 1024;
+			break;
+			case 'p':
+				if (sscanf(optarg, "%d-%d", &data_port_first, &data_port_last) != 2 ||
+					data_port_first < 1 || data_port_last < data_port_first || data_port_last > 65535)
+				{
+					worker_count = -1;
+				}
+			break;
+			case 'e':
+				if ((egress_kb = atoll(optarg)) < 0)
+				{
+					worker_count = -1;
+				}
+			break;
+			case 'c':
+				if ((client_kb = atoll(optarg)) < 0)
+				{
+					worker_count = -1;
+				}
+			break;
+			case 'l':
+				if (optarg[0] == '\0' || strlen(optarg) >= sizeof(local_path))
+				{
+					worker_count = -1;
+				}
+				strncpy(local_path, optarg, sizeof(local_path) - 1);
+			break;
+			default:
+				worker_count = -1;
+		}
+	}
+	if (worker_count < 0)
+	{
+		fprintf(stderr, "Usage: %s [-w workers] [-b epoll|uring] [-m cache_megabytes] [-t trace_file] [-r root_directory] [-s shards] [-q backlog] [-d direct_megabytes] [-p first_port-last_port] [-e egress_KB/s] [-c client_KB/s] [-l local_socket]\n", argv[0]);
+		exit(1);
+	}
+
+	if (local_path[0] == '\0' && local_channel_path(local_path, sizeof(local_path)) == -1)
+	{
+		local_path[0] = '\0';
+	}
+
+	// Requests name files relative to the root
+	if (chdir(root) == -1)
+	{
+		perror("[-]Can't open root directory");
+		exit(1);
+	}
+
+	// Shards all accept on the one local socket, made before they are
+	init_server_local_channel(&local_channel_socket);
+
+	// Only the shards get past here; each runs the server below on its own sockets
+	if (shard_count > 0)
+	{
+		if (!workers_given)
+		{
+			worker_count = cores / shard_count > 1 ? cores / shard_count - 1 : 0;
+		}
+		shard = run_shards(&control_channel_socket, &data_channel_socket, &server);
+		if (trace_path != NULL)
+		{
+			snprintf(shard_trace, sizeof(shard_trace), "%s.%d", trace_path, shard);
+			trace_path = shard_trace;
+		}
+	}
+
+	if (trace_path != NULL && trace_open(trace_path) == -1)
+	{
+		perror("[-]Can't open trace file");
+		exit(1);
+	}
+	if (file_index_init(&file_index, ".") == -1)
 	{
-		accept_client_connection(&client_socket, control_channel_socket, &client);
-		receive_client_request(ack_request, client_socket);
+		perror("[-]Can't open root directory");
+		exit(1);
+	}
+	file_cache_init(&file_cache, (size_t)cache_mb * 1024 * 1024);
+
+	// Each shard paces its own clients, so it gets its part of the egress
+	if (shard_count > 0 && egress_kb > 0)
+	{
+		egress_kb = egress_kb / shard_count > 0 ? egress_kb / shard_count : 1;
+	}
+	bandwidth_init(&bandwidth, egress_kb * 1024, client_kb * 1024);
+	if (shard_count == 0)
+	{
+		init_server_control_channel(&control_channel_socket, &server, sizeof(server));
+		bind_start = now_ns();
 		init_server_data_channel(&data_channel_socket, &server, sizeof(server));
-		
-		client.sin_port = htons(CLIENT_DATA_CHANNEL_PORT);
-		process_request(ack_request, data_channel_socket, client, &client_socket);
+		bind_end = now_ns();
+	}
+	init_event_loop(&loop, use_ring);
+	if (shard_count == 0)
+	{
+		trace_span(loop.trace, "bind data channel", 0, bind_start, bind_end);
+	}
+	init_worker_pool(&pool, worker_count, use_ring);
+	loop.pool = &pool;
+	if (loop.ring != NULL)
+	{
+		printf("[+]Using the io_uring backend.\n");
+	}
+
+	listeners[0] = new_connection(control_channel_socket, CONTROL_LISTENER, LISTENING);
+	listeners[1] = new_connection(data_channel_socket, DATA_LISTENER, LISTENING);
+	for (i = 0; i < 2; i++)
+	{
+		if (loop.ring != NULL)
+		{
+			ring_accept(&loop, listeners[i]);
+		}
+		else
+		{
+			watch_connection(&loop, listeners[i]);
+		}
+	}
+	if (local_channel_socket != -1)
+	{
+		watch_connection(&loop, new_connection(local_channel_socket, LOCAL_LISTENER, LISTENING));
+	}
+
+	while (SERVER_IS_UP)
+	{
+		run_event_loop(&loop);
 	}
 	close(control_channel_socket);
+	close(data_channel_socket);
 	return(0);
 }
 
@@ -116,7 +871,8 @@ int main (int argc, char **argv)
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Socket is non-blocking
+ *                 October 16th, 2026 - Joins the port's SO_REUSEPORT group in sharded mode; backlog set by -q
  *
  * DESIGNER:       Derek Wong
  *
@@ -131,18 +887,34 @@ int main (int argc, char **argv)
  * -----------------------------------------------------------------------*/
 void init_server_control_channel (int *control_channel_socket, struct sockaddr_in *server, int server_len)
 {
+	int option = 1;
+
 	// Create a control channel stream socket
-	if ((*control_channel_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+	if ((*control_channel_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1)
 	{
 		perror ("Can't create a socket");
 		exit(1);
 	}
 	printf("[+]Server control channel socket created successfully.\n");
 
+	// Allow the server to restart while old connections are in TIME_WAIT
+	if (setsockopt(*control_channel_socket, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option)) == -1)
+	{
+		perror("[-]setsockopt failed");
+		exit(1);
+	}
+
+	// Every shard binds a socket of its own to the port
+	if (shard_count > 0 && setsockopt(*control_channel_socket, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(option)) == -1)
+	{
+		perror("[-]setsockopt failed");
+		exit(1);
+	}
+
 	// Bind an address to the socket
 	bzero((char *)server, sizeof(struct sockaddr_in));
 	server->sin_family = AF_INET;
-	server->sin_port = htons(SERVER_CONTROL_CHANNEL_PORT); 
+	server->sin_port = htons(SERVER_CONTROL_CHANNEL_PORT);
 	server->sin_addr.s_addr = htonl(INADDR_ANY); // Accept connections from any client
 
 	if (bind(*control_channel_socket, (struct sockaddr *)server, server_len) == -1)
@@ -151,193 +923,295 @@ void init_server_control_channel (int *control_channel_socket, struct sockaddr_i
 		exit(1);
 	}
 	printf("[+]Server control channel socket binded successfully.\n");
-	
-	
+
+
 	// Listen for connections
-	// queue up to 5 connect requests
-	if (listen(*control_channel_socket, 5) == -1)
+	// queue up to listen_backlog connect requests
+	if (listen(*control_channel_socket, listen_backlog) == -1)
 	{
 		perror("[-]Error in listening");
 		exit(1);
 	}
+	if (shard_count > 0)
+	{
+		steer_connections(*control_channel_socket);
+	}
 }
 
 /*--------------------------------------------------------------------------
- * FUNCTION:       accept_client_connection
+ * FUNCTION:       init_server_data_channel
  *
  * DATE:           October 6th, 2020
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Bound once at startup and shared by all SEND transfers
+ *                 October 16th, 2026 - Joins the port's SO_REUSEPORT group in sharded mode; backlog set by -q
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void accept_client_connection (int *client_socket, int control_channel_socket, struct sockaddr_in *client)
+ * INTERFACE:      void init_server_data_channel (int *data_channel_socket, struct sockaddr_in *server, int server_len)
  *
  * RETURNS:        void
  *
  * NOTES:
- * Accepts client connects to the server control channel socket
+ * Creates server data channel socket, binds address to socket and listens for client data connections
  * -----------------------------------------------------------------------*/
-void accept_client_connection (int *client_socket, int control_channel_socket, struct sockaddr_in *client)
+void init_server_data_channel (int *data_channel_socket, struct sockaddr_in *server, int server_len)
 {
-	socklen_t client_len = sizeof(client);
-	if ((*client_socket = accept (control_channel_socket, (struct sockaddr *)client, &client_len)) == -1)
+	int option = 1;
+
+	// Create data channel stream socket
+	if ((*data_channel_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1)
 	{
-		fprintf(stderr, "Can't accept client\n");
+		perror ("Can't create a socket");
 		exit(1);
 	}
-	printf("[+]Client connected successfully.\n");
+	printf("[+]Server data channel socket created successfully.\n");
 
-	printf("Client Address: %s\n", inet_ntoa(client->sin_addr));
+	// Allow the server to restart while old connections are in TIME_WAIT
+	if (setsockopt(*data_channel_socket, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option)) == -1)
+	{
+		perror("[-]setsockopt failed");
+		exit(1);
+	}
+
+	// Every shard binds a socket of its own to the port
+	if (shard_count > 0 && setsockopt(*data_channel_socket, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(option)) == -1)
+	{
+		perror("[-]setsockopt failed");
+		exit(1);
+	}
+
+	// Bind an address to the socket
+	bzero((char *)server, sizeof(struct sockaddr_in));
+	server->sin_family = AF_INET;
+	server->sin_port = htons(SERVER_DATA_CHANNEL_PORT);
+	server->sin_addr.s_addr = htonl(INADDR_ANY); // Accept connections from any client
+
+	if (bind(*data_channel_socket, (struct sockaddr *)server, server_len) == -1)
+	{
+		perror("Can't bind name to socket");
+		exit(1);
+	}
+	printf("[+]Server data channel socket binded successfully.\n");
+
+	if (listen(*data_channel_socket, listen_backlog) == -1)
+	{
+		perror("[-]Error in listening");
+		exit(1);
+	}
+	if (shard_count > 0)
+	{
+		steer_connections(*data_channel_socket);
+	}
 }
 
 /*--------------------------------------------------------------------------
- * FUNCTION:       receive_client_request
+ * FUNCTION:       init_event_loop
  *
- * DATE:           October 6th, 2020
+ * DATE:           October 16th, 2026
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Optionally sets up an io_uring for the loop
+ *                 October 16th, 2026 - Registers the loop's counters
+ *                 October 16th, 2026 - Gets a trace ring when tracing
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void receive_client_request (char *ack_request, int client_socket)
+ * INTERFACE:      void init_event_loop (struct event_loop *loop, int use_ring)
  *
  * RETURNS:        void
  *
  * NOTES:
- * Receives a request containing a command in a buffer and reads it; Echo back command to the client and close client control socket
+ * Creates the epoll instance that every server socket is registered with, along with the
+ * eventfd used to wake the loop when sessions are handed to it. With use_ring the loop also
+ * gets an io_uring, unless the kernel can't provide one.
  * -----------------------------------------------------------------------*/
-void receive_client_request (char *ack_request, int client_socket)
+void init_event_loop (struct event_loop *loop, int use_ring)
 {
-	int	n, bytes_to_read;
-	char *request;
-	request = ack_request;
-		bytes_to_read = REQ_BUFLEN;
-		while ((n = recv (client_socket, request, bytes_to_read, 0)) < REQ_BUFLEN)
+	bzero((char *)loop, sizeof(struct event_loop));
+	stats_register(&loop->stats);
+	loop->trace = trace_ring_new();
+	if ((loop->epoll_fd = epoll_create1(0)) == -1)
+	{
+		perror("[-]Can't create epoll instance");
+		exit(1);
+	}
+	if ((loop->wakeup_fd = eventfd(0, EFD_NONBLOCK)) == -1)
+	{
+		perror("[-]Can't create eventfd");
+		exit(1);
+	}
+	watch_connection(loop, new_connection(loop->wakeup_fd, HANDOFF_EVENT, LISTENING));
+
+	if (use_ring)
+	{
+		if ((loop->ring = malloc(sizeof(struct uring))) == NULL)
+		{
+			perror("[-]Out of memory");
+			exit(1);
+		}
+		if (uring_init(loop->ring, RING_ENTRIES) == -1)
 		{
-			request += n;
-			bytes_to_read -= n;
+			perror("[-]Can't set up io_uring, falling back to epoll");
+			free(loop->ring);
+			loop->ring = NULL;
+			return;
 		}
-		printf ("Acknowledging Request:%s\n", ack_request);
-		send (client_socket, ack_request, REQ_BUFLEN, 0);
-		close (client_socket);
+		loop->events_op.type = RING_POLL_EVENTS;
+		ring_poll_events(loop);
+	}
 }
 
 /*--------------------------------------------------------------------------
- * FUNCTION:       init_server_data_channel
+ * FUNCTION:       run_event_loop
  *
- * DATE:           October 6th, 2020
+ * DATE:           October 16th, 2026
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Waits on the io_uring when the loop has one
+ *                 October 16th, 2026 - Gives the sessions on the ready queue their turns
+ *                 October 16th, 2026 - Timers are kept in deadline order, so only due ones are looked at
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void init_server_data_channel (int *data_channel_socket, struct sockaddr_in *server, int server_len)
+ * INTERFACE:      void run_event_loop (struct event_loop *loop)
  *
  * RETURNS:        void
  *
  * NOTES:
- * Creates server data channel socket, binds address to socket
+ * Waits for socket readiness (or the next connect timer to come due) once and
+ * dispatches every ready connection to the handler for its current state, then gives
+ * the sessions waiting on the ready queue their next turn. The wait doesn't block while
+ * any are queued.
  * -----------------------------------------------------------------------*/
-void init_server_data_channel (int *data_channel_socket, struct sockaddr_in *server, int server_len)
+void run_event_loop (struct event_loop *loop)
 {
-	// Create data channel stream socket
-		if ((*data_channel_socket = socket(AF_INET, SOCK_STREAM, 0)) == -1)
-		{
-			perror ("Can't create a socket");
-			exit(1);
-		}
-		printf("[+]Server data channel socket created successfully.\n");
-		
-		// Bind an address to the socket
-		bzero((char *)server, sizeof(struct sockaddr_in));
-		server->sin_family = AF_INET;
-		server->sin_port = htons(SERVER_DATA_CHANNEL_PORT); 
-		server->sin_addr.s_addr = htonl(INADDR_ANY); // Accept connections from any client
-		
-		if (bind(*data_channel_socket, (struct sockaddr *)server, server_len) == -1)
-		{
-			perror("Can't bind name to socket");
-			exit(1);
-		}
-		
-		printf("[+]Server data channel socket binded successfully.\n");
+	struct connection	*conn;
+	long long			now;
+	int					timeout = -1;
+
+	// Sleep no longer than the earliest pending timer, which is first
+	now = now_ms();
+	if (loop->timers != NULL)
+	{
+		timeout = loop->timers->timer_at > now ? (int)(loop->timers->timer_at - now) : 0;
+	}
+	if (loop->ready_head != NULL)
+	{
+		timeout = 0;
+	}
+
+	if (loop->ring != NULL)
+	{
+		run_ring(loop, timeout);
+	}
+	else
+	{
+		poll_events(loop, timeout);
+	}
+
+	// Expiring disarms the timer, so the next one due is always first
+	now = now_ms();
+	while ((conn = loop->timers) != NULL && conn->timer_at <= now)
+	{
+		expire_timer(loop, conn);
+	}
+	run_ready(loop);
 }
 
 /*--------------------------------------------------------------------------
- * FUNCTION:       process_request
+ * FUNCTION:       poll_events
  *
- * DATE:           October 6th, 2020
+ * DATE:           October 16th, 2026
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Accepts on sessions' own data ports
+ *                 October 16th, 2026 - Serves the local socket
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void process_request (char *ack_request, int data_channel_socket, struct sockaddr_in client, int *client_socket)
+ * INTERFACE:      int poll_events (struct event_loop *loop, int timeout)
  *
- * RETURNS:        void
+ * RETURNS:        int - number of ready connections handled
  *
  * NOTES:
- * Depending on what the acknowledged request command is, the server will either send/receive a file to/from client 
+ * Waits up to timeout milliseconds for socket readiness and dispatches every ready
+ * connection to the handler for its current state
  * -----------------------------------------------------------------------*/
-void process_request (char *ack_request, int data_channel_socket, struct sockaddr_in client, int *client_socket)
+int poll_events (struct event_loop *loop, int timeout)
 {
-	socklen_t client_len = sizeof(client);
-	FILE	*fp;
-	// Send file to client
-	if (strcmp(ack_request, GET_COMMAND_NAME) == 0)
-	{
-		connect_with_retry(data_channel_socket, (struct sockaddr *)&client, sizeof(client));
+	struct epoll_event	events[MAX_EVENTS];
+	struct connection	*conn;
+	int					i, n;
 
-		printf("[+]Connected to client successfully.\n");
-		fp = fopen(GET_FILE_NAME, "r");
-		if (fp == NULL)
+	if ((n = epoll_wait(loop->epoll_fd, events, MAX_EVENTS, timeout)) == -1)
+	{
+		if (errno != EINTR)
 		{
-			perror("[-]Error in reading file.");
+			perror("[-]Error in epoll_wait");
 			exit(1);
 		}
-		send_file(fp, data_channel_socket);
-		printf("[+]File data sent successfully.\n");
-		close(data_channel_socket);
-		printf("[+]Closing the connection.\n\n");
+		n = 0;
 	}
-	// Retrieve file from client
-	else if (strcmp(ack_request, SEND_COMMAND_NAME) == 0)
+
+	for (i = 0; i < n; i++)
 	{
-		// Listen for client connections, when a connection is made transfer file over
-		if (listen(data_channel_socket, 5) == -1)
-		{
-			perror("[-]Error in listening");
-			exit(1);
-		}
-		if ((*client_socket = accept (data_channel_socket, (struct sockaddr *)&client, &client_len)) == -1)
+		conn = events[i].data.ptr;
+		switch (conn->kind)
 		{
-			perror("[-]Can't accept client connection");
-			exit(1);
+			case CONTROL_LISTENER:
+				accept_client_connection(loop, conn);
+			break;
+			case DATA_LISTENER:
+				accept_data_connection(loop, conn);
+			break;
+			case HANDOFF_EVENT:
+				receive_handoffs(loop);
+			break;
+			case CONTROL_CONNECTION:
+				receive_client_request(loop, conn);
+			break;
+			case DATA_CONNECTION:
+				if (conn->state == CONNECTING)
+				{
+					finish_connect(loop, conn);
+				}
+				else if (conn->state == ACCEPTING_DATA)
+				{
+					accept_data_port(loop, conn);
+				}
+				else if (conn->state == SENDING_FILE)
+				{
+					send_file(loop, conn);
+				}
+				else if (conn->state == RECEIVING_FILE)
+				{
+					write_file(loop, conn);
+				}
+			break;
+			case MUX_CONNECTION:
+				handle_mux_connection(loop, conn);
+			break;
+			case LOCAL_LISTENER:
+				accept_local_connection(loop, conn);
+			break;
+			case LOCAL_CONNECTION:
+				receive_local_request(loop, conn);
+			break;
 		}
-		printf("[+]Client connected successfully.\n");
-		printf("[+]Client Address:  %s\n", inet_ntoa(client.sin_addr));
-		printf("[+]Server will now retrieve %s from client\n", SEND_FILE_NAME);
-		write_file(*client_socket);
-		printf("[+]Data written locally in the file, %s, successfully.\n", SEND_FILE_NAME);
-		close(*client_socket);
-		close(data_channel_socket);
-		printf("[+]Closing the client and data channel socket connections.\n\n");
 	}
+	return n;
 }
 
 /*--------------------------------------------------------------------------
- * FUNCTION:       connect_with_retry
+ * FUNCTION:       watch_connection
  *
- * DATE:           October 6th, 2020
+ * DATE:           October 16th, 2026
  *
  * REVISIONS:      N/A
  *
@@ -345,99 +1219,4774 @@ void process_request (char *ack_request, int data_channel_socket, struct sockadd
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_entity_len)
+ * INTERFACE:      void watch_connection (struct event_loop *loop, struct connection *conn)
  *
  * RETURNS:        void
  *
  * NOTES:
- * Utility function to help establish a connection between a remote entity and a client; Retries upon failure with a polling rate
+ * Registers a connection's socket with the event loop for edge-triggered read and write readiness
  * -----------------------------------------------------------------------*/
-void connect_with_retry (int socket, struct sockaddr *remote_entity, int remote_entity_len)
+void watch_connection (struct event_loop *loop, struct connection *conn)
 {
-	// Connect to client, sleep when address is currently in use
-	int sleep_time = DEFAULT_SLEEP_TIME;
-	int interval = 1;
-	
-	while (NOT_CONNECTED)
+	struct epoll_event event;
+
+	bzero((char *)&event, sizeof(event));
+	event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	event.data.ptr = conn;
+	if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, conn->fd, &event) == -1)
 	{
-		if (connect (socket, remote_entity, remote_entity_len) == -1)
-		{
-			perror("[-]Can't connect to server");
-			sleep(sleep_time);
-			sleep_time += interval;
-		} 
-		else 
-		{
-			break;
-		}
+		perror("[-]Can't register socket with epoll");
+		exit(1);
 	}
 }
 
 /*--------------------------------------------------------------------------
- * FUNCTION:       send_file
+ * FUNCTION:       close_connection
  *
- * DATE:           October 6th, 2020
+ * DATE:           October 16th, 2026
  *
- * REVISIONS:      N/A
+ * REVISIONS:      October 16th, 2026 - Waits for the connection's io_uring requests before freeing it
+ *                 October 16th, 2026 - Frees the compression buffers
+ *                 October 16th, 2026 - Discards an unfinished delta upload
+ *                 October 16th, 2026 - Releases a cached GET file
+ *                 October 16th, 2026 - Counts an unfinished transfer as failed
+ *                 October 16th, 2026 - Closes a data port the session never used
+ *                 October 16th, 2026 - Closes the file a local SEND passed
+ *                 October 16th, 2026 - Closes the splice pipe
+ *                 October 16th, 2026 - Gives up the session's turn and its client's share
+ *                 October 16th, 2026 - Leaves the SENDs waiting for their data connection
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void send_file (FILE *fp, int sockfd)
+ * INTERFACE:      void close_connection (struct event_loop *loop, struct connection *conn)
  *
  * RETURNS:        void
  *
  * NOTES:
- * Sends file data through a specified socket to a remote entity
+ * Closes a session's socket and file and releases it; closing the socket also removes it from epoll
  * -----------------------------------------------------------------------*/
-void send_file(FILE *fp, int sockfd){
-  char data[FILE_BUFLEN] = {0};
-
-  while(fgets(data, FILE_BUFLEN, fp) != NULL) {
-    if (send(sockfd, data, sizeof(data), 0) == -1) {
-      perror("[-]Error in sending file.");
-      exit(1);
-    }
-    bzero(data, FILE_BUFLEN);
-  }
-}
-
-/*--------------------------------------------------------------------------
- * FUNCTION:       write_file
- *
+void close_connection (struct event_loop *loop, struct connection *conn)
+{
+	// Requests in flight still point at the connection; shutting the socket down makes them finish
+	if (conn->ring_busy > 0)
+	{
+		if (!conn->closing && conn->fd != -1)
+		{
+			shutdown(conn->fd, SHUT_RDWR);
+		}
+		conn->closing = TRUE;
+		return;
+	}
+	if (conn->fd != -1)
+	{
+		close(conn->fd);
+	}
+	if (conn->port_fd != -1)
+	{
+		close(conn->port_fd);
+	}
+	if (conn->local_fd != -1)
+	{
+		close(conn->local_fd);
+	}
+	if (conn->pipe_fds[0] != -1)
+	{
+		close(conn->pipe_fds[0]);
+		close(conn->pipe_fds[1]);
+	}
+	if (conn->transfer_start != 0)
+	{
+		end_transfer(loop, conn, FALSE);
+	}
+	if (conn->state == AWAITING_DATA_CONNECTION)
+	{
+		unlink_pending_send(loop, conn);
+	}
+	abort_upload(conn);
+	close_request_file(conn);
+	end_sending(loop, conn);
+	disarm_timer(loop, conn);
+	free(conn->buffer);
+	free(conn->zbuf);
+	compressor_free(&conn->compressor);
+	stats_add(&loop->stats.active_sessions, -1);
+	free(conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       accept_client_connection
+ *
+ * DATE:           October 6th, 2020
+ *
+ * REVISIONS:      October 16th, 2026 - Drains every pending connection without blocking
+ *                 October 16th, 2026 - Counts failed accepts
+ *                 October 16th, 2026 - Retries later when out of descriptors
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void accept_client_connection (struct event_loop *loop, struct connection *listener)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Accepts client connects to the server control channel socket and starts reading their requests
+ * -----------------------------------------------------------------------*/
+void accept_client_connection (struct event_loop *loop, struct connection *listener)
+{
+	struct sockaddr_in	client;
+	socklen_t			client_len;
+	int					client_socket;
+
+	while (TRUE)
+	{
+		client_len = sizeof(client);
+		if ((client_socket = accept4(listener->fd, (struct sockaddr *)&client, &client_len, SOCK_NONBLOCK)) == -1)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				if (errno == EMFILE || errno == ENFILE)
+				{
+					pause_accepts(loop, listener);
+				}
+				perror("[-]Can't accept client");
+				stats_add(&loop->stats.failed_connections, 1);
+			}
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return;
+		}
+		add_client_connection(loop, client_socket, &client);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       add_client_connection
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Counted in the loop's stats
+ *                 October 16th, 2026 - Numbers the session and starts tracing it
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void add_client_connection (struct event_loop *loop, int client_socket, struct sockaddr_in *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Starts tracking an accepted control connection and waits for its request
+ * -----------------------------------------------------------------------*/
+void add_client_connection (struct event_loop *loop, int client_socket, struct sockaddr_in *client)
+{
+	struct connection *conn;
+
+	printf("[+]Client connected successfully.\n");
+	printf("Client Address: %s\n", inet_ntoa(client->sin_addr));
+
+	conn = new_connection(client_socket, CONTROL_CONNECTION, READING_REQUEST);
+	conn->peer = *client;
+	conn->session = atomic_fetch_add_explicit(&session_count, 1, memory_order_relaxed) + 1;
+	trace_phase(loop, conn, NULL);
+	stats_add(&loop->stats.accepted, 1);
+	stats_add(&loop->stats.active_sessions, 1);
+	if (loop->ring != NULL)
+	{
+		ring_receive_request(loop, conn);
+	}
+	else
+	{
+		watch_connection(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       receive_client_request
+ *
+ * DATE:           October 6th, 2020
+ *
+ * REVISIONS:      October 16th, 2026 - Resumable across readiness events instead of blocking
+ *                 October 16th, 2026 - Counts the bytes received and sent
+ *                 October 16th, 2026 - Traces the wait for the request
+ *                 October 16th, 2026 - Opens the data port a request asks for before echoing it
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void receive_client_request (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Receives a request containing a command in a buffer and reads it; Echo back command to the client and close client control socket
+ * -----------------------------------------------------------------------*/
+void receive_client_request (struct event_loop *loop, struct connection *conn)
+{
+	int n;
+
+	while (conn->state == READING_REQUEST)
+	{
+		n = recv(conn->fd, conn->request + conn->request_len, REQ_BUFLEN - conn->request_len, 0);
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return;
+		}
+		if (n <= 0)
+		{
+			printf("[-]Client closed the control connection before sending a request.\n");
+			close_connection(loop, conn);
+			return;
+		}
+		conn->request_len += n;
+		stats_add(&loop->stats.bytes_in, n);
+		if (conn->request_len == REQ_BUFLEN)
+		{
+			trace_phase(loop, conn, "request");
+			conn->request[REQ_BUFLEN - 1] = '\0';
+			open_data_port(conn);
+			printf ("Acknowledging Request:%s\n", conn->request);
+			conn->state = WRITING_ACK;
+		}
+	}
+
+	while (conn->state == WRITING_ACK)
+	{
+		n = send(conn->fd, conn->request + conn->ack_len, REQ_BUFLEN - conn->ack_len, MSG_NOSIGNAL);
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return;
+		}
+		if (n == -1)
+		{
+			perror("[-]Can't acknowledge request");
+			close_connection(loop, conn);
+			return;
+		}
+		conn->ack_len += n;
+		stats_add(&loop->stats.bytes_out, n);
+		if (conn->ack_len == REQ_BUFLEN)
+		{
+			start_session(loop, conn);
+			return;
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       start_session
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Parses the request's parameters
+ *                 October 16th, 2026 - Answers STATS requests
+ *                 October 16th, 2026 - Traces the echo
+ *                 October 16th, 2026 - A session with its own data port waits for the client there
+ *                 October 16th, 2026 - A SEND waiting for its data connection gives up after DATA_PORT_TIMEOUT_MS
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void start_session (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Hands an acknowledged GET straight to a worker; a SEND waits for its client data connection first,
+ * for up to DATA_PORT_TIMEOUT_MS. A session with a data port of its own waits for the client to connect there instead, GET or
+ * SEND. A MUX session keeps its control connection, which moves to the worker as it is. A STATS
+ * request is answered on the spot.
+ * -----------------------------------------------------------------------*/
+void start_session (struct event_loop *loop, struct connection *conn)
+{
+	trace_phase(loop, conn, "ack");
+	if (parse_request(conn->request, &conn->req) == -1)
+	{
+		printf("[-]Malformed request: %s\n", conn->request);
+		close_connection(loop, conn);
+		return;
+	}
+
+	if (strcmp(conn->req.command, STATS_COMMAND_NAME) == 0)
+	{
+		send_stats(loop, conn);
+		close_connection(loop, conn);
+		return;
+	}
+
+	if (strcmp(conn->req.command, MUX_COMMAND_NAME) == 0)
+	{
+		int option = 1;
+
+		// Frames are small and answered; don't let Nagle hold them back
+		setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option));
+		if (loop->ring == NULL)
+		{
+			unwatch_connection(loop, conn);
+		}
+		conn->kind = MUX_CONNECTION;
+		conn->state = MUX_IDLE;
+		dispatch_session(loop, conn);
+		return;
+	}
+
+	close(conn->fd);
+	conn->fd = -1;
+	conn->kind = DATA_CONNECTION;
+
+	if (conn->port_fd != -1)
+	{
+		conn->fd = conn->port_fd;
+		conn->port_fd = -1;
+		conn->state = ACCEPTING_DATA;
+		watch_connection(loop, conn);
+		conn->port_deadline = now_ms() + DATA_PORT_TIMEOUT_MS;
+		arm_timer(loop, conn, conn->port_deadline);
+	}
+	else if (strcmp(conn->req.command, GET_COMMAND_NAME) == 0)
+	{
+		dispatch_session(loop, conn);
+	}
+	else if (strcmp(conn->req.command, SEND_COMMAND_NAME) == 0)
+	{
+		conn->state = AWAITING_DATA_CONNECTION;
+		conn->next = loop->pending_sends;
+		loop->pending_sends = conn;
+		arm_timer(loop, conn, now_ms() + DATA_PORT_TIMEOUT_MS);
+	}
+	else
+	{
+		printf("[-]Unknown request command: %s\n", conn->request);
+		close_connection(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       process_request
+ *
  * DATE:           October 6th, 2020
  *
+ * REVISIONS:      October 16th, 2026 - Starts the transfer state machine instead of running it to completion
+ *                 October 16th, 2026 - Runs on the worker that owns the session
+ *                 October 16th, 2026 - Uploads go through the loop's io_uring when it has one
+ *                 October 16th, 2026 - Serves and stores the requested byte range
+ *                 October 16th, 2026 - Times the transfer
+ *                 October 16th, 2026 - Traces the handoff
+ *                 October 16th, 2026 - A GET whose client connected to its own data port is sent straight away
+ *                 October 16th, 2026 - Serves local sessions in one go
+ *                 October 16th, 2026 - Uploads on the epoll backend are spliced to their file
+ *                 October 16th, 2026 - Keeps a legacy GET on epoll when its bandwidth is limited
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void process_request (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Depending on what the acknowledged request command is, the server will either send/receive a file to/from client
+ * -----------------------------------------------------------------------*/
+void process_request (struct event_loop *loop, struct connection *conn)
+{
+	trace_phase(loop, conn, "dispatch");
+	if (strcmp(conn->req.command, MUX_COMMAND_NAME) != 0)
+	{
+		start_transfer(loop, conn);
+	}
+
+	// Pass the file to a local client, or copy the one it passed
+	if (conn->kind == LOCAL_CONNECTION)
+	{
+		process_local_request(loop, conn);
+	}
+	// Send file to client
+	else if (strcmp(conn->req.command, GET_COMMAND_NAME) == 0)
+	{
+		if (open_request_file(conn) == -1)
+		{
+			perror("[-]Error in reading file.");
+			// A client already on the data port gets a reset, not what looks like an empty file
+			if (conn->fd != -1)
+			{
+				struct linger linger = { 1, 0 };
+
+				setsockopt(conn->fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+			}
+			close_connection(loop, conn);
+			return;
+		}
+		conn->zero_copy = TRUE;
+		if (conn->fd == -1)
+		{
+			conn->peer.sin_port = htons(CLIENT_DATA_CHANNEL_PORT);
+			backoff_start(&conn->backoff, &connect_back_policy);
+			connect_to_client(loop, conn);
+		}
+		// The client is already connected, to the session's own data port
+		else
+		{
+			conn->state = SENDING_FILE;
+			if (loop->ring == NULL || bandwidth_limited(&bandwidth))
+			{
+				watch_connection(loop, conn);
+			}
+			else if (start_ring_transfer(loop, conn) == 0)
+			{
+				ring_send_file(loop, conn);
+			}
+		}
+	}
+	// Retrieve file from client over its data connection
+	else if (strcmp(conn->req.command, SEND_COMMAND_NAME) == 0)
+	{
+		printf("[+]Server will now retrieve %s from client\n", request_file_name(&conn->req));
+		if (open_request_file(conn) == -1)
+		{
+			perror("[-]Error in opening file.");
+			close_connection(loop, conn);
+			return;
+		}
+		conn->state = RECEIVING_FILE;
+		if (loop->ring == NULL)
+		{
+			// O_DIRECT writes need the aligned buffer
+			conn->zero_copy = !conn->direct && pipe2(conn->pipe_fds, O_NONBLOCK) == 0;
+			if (conn->zero_copy)
+			{
+				fcntl(conn->pipe_fds[1], F_SETPIPE_SZ, TRANSFER_BUFLEN);
+			}
+			watch_connection(loop, conn);
+		}
+		else if (start_ring_transfer(loop, conn) == 0)
+		{
+			ring_write_file(loop, conn);
+		}
+	}
+	// Serve framed transfers until the client hangs up
+	else if (strcmp(conn->req.command, MUX_COMMAND_NAME) == 0)
+	{
+		watch_connection(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       open_request_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - A SEND's request records the size of the file it writes to
+ *                 October 16th, 2026 - A GET takes the file's cached copy when there is one
+ *                 October 16th, 2026 - Opens the file the request names; a GET's must be in the index
+ *                 October 16th, 2026 - A whole-file SEND goes to a temporary file, preallocated when its size is known
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int open_request_file (struct connection *conn)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Opens the file of a GET or SEND and positions the session on the requested range. A GET of
+ * a file missing from the index fails with ENOENT without looking at the directory. A GET's
+ * range is clipped to the file and written back into the request, along with the file's
+ * size. A SEND without an offset builds a new file in a temporary one (see finish_upload),
+ * with O_DIRECT if it is big enough and the file system allows it; one with an offset
+ * writes into the file. A given size cuts or extends the file first, with its blocks
+ * allocated up front where the file system can. The request then carries the file's size,
+ * which tells a client resuming an upload where to pick up.
+ * -----------------------------------------------------------------------*/
+int open_request_file (struct connection *conn)
+{
+	struct file_entry	entry;
+	struct stat			st;
+	const char			*name = request_file_name(&conn->req);
+	int					flags;
+
+	if (strcmp(conn->req.command, GET_COMMAND_NAME) == 0)
+	{
+		if (file_index_lookup(&file_index, name, &entry) == -1)
+		{
+			errno = ENOENT;
+			return -1;
+		}
+		if ((conn->cached = file_cache_acquire(&file_cache, name)) != NULL)
+		{
+			st.st_size = conn->cached->size;
+		}
+		else if ((conn->file_fd = open(name, O_RDONLY)) == -1 || fstat(conn->file_fd, &st) == -1)
+		{
+			return -1;
+		}
+		conn->req.size = st.st_size;
+		if (conn->req.offset < 0 || conn->req.offset > st.st_size)
+		{
+			conn->req.offset = conn->req.offset < 0 ? 0 : st.st_size;
+		}
+		if (conn->req.length < 0 || conn->req.length > st.st_size - conn->req.offset)
+		{
+			conn->req.length = st.st_size - conn->req.offset;
+		}
+		conn->file_offset = conn->req.offset;
+		conn->file_left = conn->req.length;
+		return 0;
+	}
+
+	conn->buffer_len = 0;
+	conn->direct = FALSE;
+	if (conn->req.offset < 0 ? open_temp_file(conn) == -1 : (conn->file_fd = open(name, O_WRONLY | O_CREAT, 0644)) == -1)
+	{
+		return -1;
+	}
+	if (conn->req.offset < 0 && direct_min_size >= 0 && conn->req.size >= direct_min_size &&
+		(flags = fcntl(conn->file_fd, F_GETFL)) != -1 && fcntl(conn->file_fd, F_SETFL, flags | O_DIRECT) == 0)
+	{
+		conn->direct = TRUE;
+	}
+
+	// Keeps the file in few extents, and a SEND that can't fit fails before its data moves
+	if (conn->req.size > 0 && fallocate(conn->file_fd, FALLOC_FL_KEEP_SIZE, 0, conn->req.size) == -1 &&
+		errno != EOPNOTSUPP && errno != ENOSYS)
+	{
+		return -1;
+	}
+	if ((conn->req.size >= 0 && ftruncate(conn->file_fd, conn->req.size) == -1) || fstat(conn->file_fd, &st) == -1)
+	{
+		return -1;
+	}
+	conn->req.size = st.st_size;
+	conn->file_offset = conn->req.offset < 0 ? 0 : conn->req.offset;
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       close_request_file
+ *
+ * DATE:           October 16th, 2026
+ *
  * REVISIONS:      N/A
  *
  * DESIGNER:       Derek Wong
  *
  * PROGRAMMER:     Derek Wong
  *
- * INTERFACE:      void write_file(int sockfd)
+ * INTERFACE:      void close_request_file (struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Closes the file of the session's transfer, or releases its cached copy
+ * -----------------------------------------------------------------------*/
+void close_request_file (struct connection *conn)
+{
+	if (conn->cached != NULL)
+	{
+		file_cache_release(&file_cache, conn->cached);
+		conn->cached = NULL;
+	}
+	if (conn->file_fd != -1)
+	{
+		close(conn->file_fd);
+		conn->file_fd = -1;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       accept_data_connection
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Counts failed accepts
+ *                 October 16th, 2026 - Retries later when out of descriptors
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void accept_data_connection (struct event_loop *loop, struct connection *listener)
  *
  * RETURNS:        void
  *
  * NOTES:
- * Receives file data through a specified socket and file descriptor to write locally to a file called send.txt
+ * Accepts client connections to the data channel and pairs each with the oldest SEND session
+ * acknowledged for the same client address; connections nobody asked for are dropped
  * -----------------------------------------------------------------------*/
-void write_file (int sockfd)
+void accept_data_connection (struct event_loop *loop, struct connection *listener)
 {
-  int n;
-  FILE *fp;
-  char *filename = SEND_FILE_NAME;
-  char buffer[FILE_BUFLEN];
+	struct sockaddr_in	client;
+	socklen_t			client_len;
+	int					client_socket;
+
+	while (TRUE)
+	{
+		client_len = sizeof(client);
+		if ((client_socket = accept4(listener->fd, (struct sockaddr *)&client, &client_len, SOCK_NONBLOCK)) == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				if (errno == EMFILE || errno == ENFILE)
+				{
+					pause_accepts(loop, listener);
+				}
+				perror("[-]Can't accept client connection");
+				stats_add(&loop->stats.failed_connections, 1);
+			}
+			return;
+		}
+		pair_data_connection(loop, client_socket, &client);
+	}
+}
 
-  fp = fopen(filename, "w");
-  while (TRUE) {
-    n = recv(sockfd, buffer, FILE_BUFLEN, 0);
-    if (n <= 0){
-      break;
-      return;
-    }
-    fprintf(fp, "%s", buffer);
-	fflush(fp);
-    bzero(buffer, FILE_BUFLEN);
-  }
-  return;	
+/*--------------------------------------------------------------------------
+ * FUNCTION:       pair_data_connection
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Counted in the loop's stats
+ *                 October 16th, 2026 - Traces the wait for the data connection
+ *                 October 16th, 2026 - Stops the session's wait timer
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void pair_data_connection (struct event_loop *loop, int client_socket, struct sockaddr_in *client)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Gives an accepted data connection to the oldest SEND session acknowledged for the same
+ * client address and hands the session to a worker; connections nobody asked for are dropped
+ * -----------------------------------------------------------------------*/
+void pair_data_connection (struct event_loop *loop, int client_socket, struct sockaddr_in *client)
+{
+	struct connection *conn, **link, **oldest;
+
+	stats_add(&loop->stats.accepted, 1);
+
+	// Sessions are pushed on the front, so the last match is the oldest
+	oldest = NULL;
+	for (link = &loop->pending_sends; *link != NULL; link = &(*link)->next)
+	{
+		if ((*link)->peer.sin_addr.s_addr == client->sin_addr.s_addr)
+		{
+			oldest = link;
+		}
+	}
+	if (oldest == NULL)
+	{
+		printf("[-]Unexpected data connection from %s\n", inet_ntoa(client->sin_addr));
+		stats_add(&loop->stats.failed_connections, 1);
+		close(client_socket);
+		return;
+	}
+	conn = *oldest;
+	*oldest = conn->next;
+	conn->next = NULL;
+	disarm_timer(loop, conn);
+
+	printf("[+]Client connected successfully.\n");
+	printf("[+]Client Address:  %s\n", inet_ntoa(client->sin_addr));
+
+	conn->fd = client_socket;
+	trace_phase(loop, conn, "data connection");
+	dispatch_session(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       connect_to_client
+ *
+ * DATE:           October 6th, 2020
+ *
+ * REVISIONS:      October 16th, 2026 - Non-blocking; retries are scheduled on the event loop
+ *                 October 16th, 2026 - Renamed from connect_with_retry; attempts time out
+ *                 October 16th, 2026 - Traces the connect-back
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void connect_to_client (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Starts a non-blocking connection from a fresh data channel socket to the client's data channel;
+ * failures are retried on the session's backoff schedule without holding up other sessions
+ * -----------------------------------------------------------------------*/
+void connect_to_client (struct event_loop *loop, struct connection *conn)
+{
+	if ((conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1)
+	{
+		perror("[-]Can't create a socket");
+		schedule_retry(loop, conn);
+		return;
+	}
+
+	if (connect(conn->fd, (struct sockaddr *)&conn->peer, sizeof(conn->peer)) == 0)
+	{
+		printf("[+]Connected to client successfully.\n");
+		trace_phase(loop, conn, "connect-back");
+		conn->state = SENDING_FILE;
+	}
+	else if (errno == EINPROGRESS)
+	{
+		conn->state = CONNECTING;
+		arm_timer(loop, conn, now_ms() + connect_back_policy.attempt_timeout_ms);
+	}
+	else
+	{
+		perror("[-]Can't connect to client");
+		schedule_retry(loop, conn);
+		return;
+	}
+	watch_connection(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       finish_connect
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Traces the connect-back
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void finish_connect (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Completes a pending non-blocking connect; starts the file transfer or schedules another attempt
+ * -----------------------------------------------------------------------*/
+void finish_connect (struct event_loop *loop, struct connection *conn)
+{
+	int			error = 0;
+	socklen_t	error_len = sizeof(error);
+
+	if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) == -1)
+	{
+		error = errno;
+	}
+	if (error == EINPROGRESS)
+	{
+		return;
+	}
+	disarm_timer(loop, conn);
+	if (error != 0)
+	{
+		fprintf(stderr, "[-]Can't connect to client: %s\n", strerror(error));
+		schedule_retry(loop, conn);
+		return;
+	}
+
+	printf("[+]Connected to client successfully.\n");
+	trace_phase(loop, conn, "connect-back");
+	conn->state = SENDING_FILE;
+	send_file(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       schedule_retry
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Counts retries and abandoned connect-backs
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void schedule_retry (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Drops a failed connection attempt and queues the session to reconnect once its backoff delay
+ * elapses; the session is abandoned when the retry policy gives up
+ * -----------------------------------------------------------------------*/
+void schedule_retry (struct event_loop *loop, struct connection *conn)
+{
+	int delay;
+
+	if (conn->fd != -1)
+	{
+		close(conn->fd);
+		conn->fd = -1;
+	}
+	if ((delay = backoff_next_delay(&conn->backoff, &connect_back_policy)) == -1)
+	{
+		printf("[-]Giving up on client %s after %d attempts.\n", inet_ntoa(conn->peer.sin_addr), conn->backoff.attempts);
+		stats_add(&loop->stats.failed_connections, 1);
+		close_connection(loop, conn);
+		return;
+	}
+	stats_add(&loop->stats.connect_retries, 1);
+	conn->state = RETRY_WAIT;
+	arm_timer(loop, conn, now_ms() + delay);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       arm_timer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Keeps the timers sorted by deadline
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void arm_timer (struct event_loop *loop, struct connection *conn, long long at)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Schedules expire_timer to run for a connection once now_ms() reaches at, replacing any timer
+ * already armed for it. The loop's timers stay sorted by deadline; new ones are nearly always
+ * the latest, so the place is searched for from the end.
+ * -----------------------------------------------------------------------*/
+void arm_timer (struct event_loop *loop, struct connection *conn, long long at)
+{
+	struct connection *prev;
+
+	disarm_timer(loop, conn);
+	conn->timer_at = at;
+	for (prev = loop->timers_tail; prev != NULL && prev->timer_at > at; prev = prev->timer_prev)
+	{
+	}
+	conn->timer_prev = prev;
+	conn->timer_next = prev != NULL ? prev->timer_next : loop->timers;
+	if (conn->timer_next != NULL)
+	{
+		conn->timer_next->timer_prev = conn;
+	}
+	else
+	{
+		loop->timers_tail = conn;
+	}
+	if (prev != NULL)
+	{
+		prev->timer_next = conn;
+	}
+	else
+	{
+		loop->timers = conn;
+	}
+	conn->timer_armed = TRUE;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       disarm_timer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Maintains the tail of the timer list
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void disarm_timer (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Cancels a connection's timer if one is armed
+ * -----------------------------------------------------------------------*/
+void disarm_timer (struct event_loop *loop, struct connection *conn)
+{
+	if (!conn->timer_armed)
+	{
+		return;
+	}
+	if (conn->timer_prev != NULL)
+	{
+		conn->timer_prev->timer_next = conn->timer_next;
+	}
+	else
+	{
+		loop->timers = conn->timer_next;
+	}
+	if (conn->timer_next != NULL)
+	{
+		conn->timer_next->timer_prev = conn->timer_prev;
+	}
+	else
+	{
+		loop->timers_tail = conn->timer_prev;
+	}
+	conn->timer_armed = FALSE;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       expire_timer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Gives up on a data port its client never connects to
+ *                 October 16th, 2026 - Resumes a throttled session
+ *                 October 16th, 2026 - Gives up on a SEND whose client never opens its data connection
+ *                 October 16th, 2026 - Retries accepts paused for lack of descriptors
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void expire_timer (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Reconnects a session whose retry delay has elapsed, or gives up on a connect attempt that
+ * has been in progress for too long, or on a session whose client never came to its data port
+ * (its own, or the fixed one for a SEND).
+ * A session waiting for tokens goes on with its turn.
+ * -----------------------------------------------------------------------*/
+void expire_timer (struct event_loop *loop, struct connection *conn)
+{
+	disarm_timer(loop, conn);
+	if (conn->turn == TURN_THROTTLED)
+	{
+		conn->turn = TURN_RUNNING;
+		resume_sending(loop, conn);
+	}
+	else if (conn->state == RETRY_WAIT)
+	{
+		connect_to_client(loop, conn);
+	}
+	else if (conn->state == CONNECTING)
+	{
+		printf("[-]Connection attempt to client %s timed out.\n", inet_ntoa(conn->peer.sin_addr));
+		schedule_retry(loop, conn);
+	}
+	else if (conn->state == LISTENING)
+	{
+		retry_accept(loop, conn);
+	}
+	else if (conn->state == ACCEPTING_DATA && conn->port_deadline > now_ms())
+	{
+		// Woken early to retry an accept that ran out of descriptors
+		arm_timer(loop, conn, conn->port_deadline);
+		accept_data_port(loop, conn);
+	}
+	else if (conn->state == ACCEPTING_DATA || conn->state == AWAITING_DATA_CONNECTION)
+	{
+		printf("[-]Client %s never connected to its data port.\n", inet_ntoa(conn->peer.sin_addr));
+		stats_add(&loop->stats.failed_connections, 1);
+		close_connection(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_file
+ *
+ * DATE:           October 6th, 2020
+ *
+ * REVISIONS:      October 16th, 2026 - Sends until the socket would block and resumes on the next event
+ *                 October 16th, 2026 - Zero-copy with sendfile, falling back to a large copy buffer
+ *                 October 16th, 2026 - Hands the transfer to the loop's io_uring when it has one
+ *                 October 16th, 2026 - Sends the requested range only
+ *                 October 16th, 2026 - Counts the bytes sent and the completed transfer
+ *                 October 16th, 2026 - Sends in the session's turns, within its bandwidth allowance
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void send_file (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Sends file data through a specified socket to a remote entity, as much as the session's
+ * turn and bandwidth allow; the scheduler resumes it when it may send more
+ * -----------------------------------------------------------------------*/
+void send_file (struct event_loop *loop, struct connection *conn)
+{
+	ssize_t		n;
+	long long	allowed;
+
+	// Called once the connect-back completes; the ring takes the socket over from epoll
+	if (loop->ring != NULL && !bandwidth_limited(&bandwidth))
+	{
+		unwatch_connection(loop, conn);
+		if (start_ring_transfer(loop, conn) == 0)
+		{
+			ring_send_file(loop, conn);
+		}
+		return;
+	}
+
+	while (conn->file_left > 0)
+	{
+		if ((allowed = send_allowance(loop, conn, conn->file_left < SENDFILE_CHUNK ? conn->file_left : SENDFILE_CHUNK)) == 0)
+		{
+			return;
+		}
+		n = send_file_chunk(conn, allowed);
+		if (n > 0)
+		{
+			conn->file_left -= n;
+			charge_send(conn, n);
+			stats_add(&loop->stats.bytes_out, n);
+			continue;
+		}
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return;
+		}
+		if (n == 0)
+		{
+			printf("[-]File shrank while it was being sent.\n");
+		}
+		else
+		{
+			perror("[-]Error in sending file.");
+		}
+		close_connection(loop, conn);
+		return;
+	}
+	printf("[+]File data sent successfully.\n");
+	printf("[+]Closing the connection.\n\n");
+	end_transfer(loop, conn, TRUE);
+	close_connection(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       write_file
+ *
+ * DATE:           October 6th, 2020
+ *
+ * REVISIONS:      October 16th, 2026 - Receives until the socket would block and resumes on the next event
+ *                 October 16th, 2026 - Writes exactly the bytes received, so binary files survive
+ *                 October 16th, 2026 - Writes from the requested offset
+ *                 October 16th, 2026 - Counts the bytes received and the completed transfer
+ *                 October 16th, 2026 - Writes whole aligned buffers and stores the file through finish_upload
+ *                 October 16th, 2026 - Splices the data into the file when it can
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void write_file (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Receives file data through a specified socket and file descriptor to write locally to the
+ * requested file. With zero_copy the data is spliced into the file; otherwise it collects in
+ * the session's buffer, which is written once it is full.
+ * -----------------------------------------------------------------------*/
+void write_file (struct event_loop *loop, struct connection *conn)
+{
+	int n;
+
+	if (conn->buffer == NULL && (conn->buffer = alloc_buffer(TRANSFER_BUFLEN)) == NULL)
+	{
+		perror("[-]Out of memory");
+		close_connection(loop, conn);
+		return;
+	}
+	while (TRUE)
+	{
+		if (conn->zero_copy)
+		{
+			n = splice_to_file(conn);
+		}
+		else if ((n = recv(conn->fd, conn->buffer + conn->buffer_len, TRANSFER_BUFLEN - conn->buffer_len, 0)) > 0)
+		{
+			conn->buffer_len += n;
+			conn->file_offset += n;
+		}
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				perror("[-]Error in receiving file.");
+				close_connection(loop, conn);
+			}
+			return;
+		}
+		if (n == 0)
+		{
+			if (finish_upload(conn) == -1)
+			{
+				perror("[-]Error in storing file.");
+				close_connection(loop, conn);
+				return;
+			}
+			printf("[+]Data written locally in the file, %s, successfully.\n", request_file_name(&conn->req));
+			printf("[+]Closing the client and data channel socket connections.\n\n");
+			end_transfer(loop, conn, TRUE);
+			close_connection(loop, conn);
+			return;
+		}
+		stats_add(&loop->stats.bytes_in, n);
+		if (conn->buffer_len == TRANSFER_BUFLEN && flush_upload(conn) == -1)
+		{
+			perror("[-]Error in writing file.");
+			close_connection(loop, conn);
+			return;
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       new_connection
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Initializes the delta upload state
+ *                 October 16th, 2026 - No data port of its own yet
+ *                 October 16th, 2026 - No local file yet
+ *                 October 16th, 2026 - No splice pipe yet
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      struct connection *new_connection (int fd, enum connection_kind kind, enum connection_state state)
+ *
+ * RETURNS:        struct connection *
+ *
+ * NOTES:
+ * Allocates the state for a socket tracked by the event loop
+ * -----------------------------------------------------------------------*/
+struct connection *new_connection (int fd, enum connection_kind kind, enum connection_state state)
+{
+	struct connection *conn;
+
+	if ((conn = calloc(1, sizeof(struct connection))) == NULL)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+	conn->fd = fd;
+	conn->kind = kind;
+	conn->state = state;
+	conn->port_fd = -1;
+	conn->file_fd = -1;
+	conn->base_fd = -1;
+	conn->local_fd = -1;
+	conn->pipe_fds[0] = -1;
+	conn->pipe_fds[1] = -1;
+	return conn;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       init_worker_pool
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Workers get an io_uring with use_ring
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void init_worker_pool (struct worker_pool *pool, int count, int use_ring)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Starts the worker threads, each with its own event loop; with no workers the acceptor
+ * runs every transfer itself
+ * -----------------------------------------------------------------------*/
+void init_worker_pool (struct worker_pool *pool, int count, int use_ring)
+{
+	int i;
+
+	pool->count = count;
+	pool->next = 0;
+	if (count == 0)
+	{
+		pool->workers = NULL;
+		return;
+	}
+	if ((pool->workers = calloc(count, sizeof(struct worker))) == NULL)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+	for (i = 0; i < count; i++)
+	{
+		init_event_loop(&pool->workers[i].loop, use_ring);
+		if ((errno = pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i])) != 0)
+		{
+			perror("[-]Can't start worker thread");
+			exit(1);
+		}
+	}
+	printf("[+]Started %d transfer workers.\n", count);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       worker_main
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void *worker_main (void *arg)
+ *
+ * RETURNS:        void *
+ *
+ * NOTES:
+ * Worker thread entrypoint; runs the transfers of the sessions handed to it
+ * -----------------------------------------------------------------------*/
+void *worker_main (void *arg)
+{
+	struct worker *worker = arg;
+
+	while (SERVER_IS_UP)
+	{
+		run_event_loop(&worker->loop);
+	}
+	return NULL;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       dispatch_session
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - The session leaves this loop's count
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void dispatch_session (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Hands an acknowledged session to the next worker in round-robin order and wakes it. Full
+ * queues are skipped; if every queue is full the acceptor runs the transfer itself.
+ * -----------------------------------------------------------------------*/
+void dispatch_session (struct event_loop *loop, struct connection *conn)
+{
+	struct worker_pool	*pool = loop->pool;
+	struct event_loop	*target;
+	size_t				head, tail;
+	uint64_t			one = 1;
+	int					i;
+
+	for (i = 0; pool != NULL && i < pool->count; i++)
+	{
+		target = &pool->workers[pool->next].loop;
+		pool->next = (pool->next + 1) % pool->count;
+
+		tail = atomic_load_explicit(&target->handoff.tail, memory_order_relaxed);
+		head = atomic_load_explicit(&target->handoff.head, memory_order_acquire);
+		if (tail - head == HANDOFF_QUEUE_LEN)
+		{
+			continue;
+		}
+		target->handoff.slots[tail & (HANDOFF_QUEUE_LEN - 1)] = conn;
+		atomic_store_explicit(&target->handoff.tail, tail + 1, memory_order_release);
+		stats_add(&loop->stats.active_sessions, -1);
+
+		if (write(target->wakeup_fd, &one, sizeof(one)) == -1 && errno != EAGAIN)
+		{
+			perror("[-]Can't wake worker");
+		}
+		return;
+	}
+	process_request(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       receive_handoffs
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - The session joins this loop's count
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void receive_handoffs (struct event_loop *loop)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Takes every session queued for this worker and starts its transfer. The wakeup counter is
+ * cleared before the queue is drained so a handoff racing with the drain re-arms the event.
+ * -----------------------------------------------------------------------*/
+void receive_handoffs (struct event_loop *loop)
+{
+	struct connection	*conn;
+	size_t				head, tail;
+	uint64_t			count;
+
+	while (read(loop->wakeup_fd, &count, sizeof(count)) > 0)
+	{
+	}
+
+	head = atomic_load_explicit(&loop->handoff.head, memory_order_relaxed);
+	tail = atomic_load_explicit(&loop->handoff.tail, memory_order_acquire);
+	while (head != tail)
+	{
+		conn = loop->handoff.slots[head & (HANDOFF_QUEUE_LEN - 1)];
+		atomic_store_explicit(&loop->handoff.head, ++head, memory_order_release);
+		stats_add(&loop->stats.active_sessions, 1);
+		process_request(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       unwatch_connection
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void unwatch_connection (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Removes a connection's socket from the event loop so it can be handed to another loop
+ * -----------------------------------------------------------------------*/
+void unwatch_connection (struct event_loop *loop, struct connection *conn)
+{
+	if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL) == -1)
+	{
+		perror("[-]Can't unregister socket from epoll");
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       handle_mux_connection
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void handle_mux_connection (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Drives a framed connection until it would block: queued frames are flushed first, then the
+ * file being sent is streamed, otherwise incoming frames are read and acted on
+ * -----------------------------------------------------------------------*/
+void handle_mux_connection (struct event_loop *loop, struct connection *conn)
+{
+	int progress;
+
+	while (TRUE)
+	{
+		if (flush_frames(loop, conn) <= 0)
+		{
+			return;
+		}
+		if (conn->state == MUX_SENDING)
+		{
+			progress = send_mux_file(loop, conn);
+		}
+		else if (conn->state == MUX_SIGNING)
+		{
+			progress = send_signatures(loop, conn);
+		}
+		else
+		{
+			progress = receive_frames(loop, conn);
+		}
+		if (progress <= 0)
+		{
+			return;
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       receive_frames
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Skips the data of a rejected SEND
+ *                 October 16th, 2026 - Decompresses compressed DATA frames
+ *                 October 16th, 2026 - COPY frames of delta uploads
+ *                 October 16th, 2026 - Checks the CRC in the END frame of a SEND
+ *                 October 16th, 2026 - Counts the bytes received and ends the SEND's timing
+ *                 October 16th, 2026 - Collects DATA payloads into whole buffers before writing them
+ *                 October 16th, 2026 - Reports a lost connection as mid-frame only when part of a frame was read
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int receive_frames (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        int - 1 once a frame needs a reply, 0 if the socket would block,
+ *                       -1 if the connection was closed
+ *
+ * NOTES:
+ * Reads frames from a framed connection. DATA payloads are collected in the session's buffer,
+ * which is written to the file being received whenever it fills, or dropped if the SEND was
+ * rejected; a compressed payload is collected whole and decompressed into the buffer. The COPY frames of a delta upload copy blocks of the old file. REQUEST
+ * and END frames are answered; an END whose CRC doesn't match the data fails the SEND.
+ * -----------------------------------------------------------------------*/
+int receive_frames (struct event_loop *loop, struct connection *conn)
+{
+	char	*dest;
+	int		n, want;
+
+	while (TRUE)
+	{
+		// Read the rest of the header, file data, or a short control payload
+		if (conn->frame_len < FRAME_HEADER_LEN)
+		{
+			dest = conn->frame + conn->frame_len;
+			want = FRAME_HEADER_LEN - conn->frame_len;
+		}
+		else if (conn->header.type == FRAME_DATA)
+		{
+			if ((conn->buffer == NULL && (conn->buffer = alloc_buffer(TRANSFER_BUFLEN)) == NULL) ||
+				(conn->header.flags & FRAME_FLAG_COMPRESSED && conn->zbuf == NULL && (conn->zbuf = alloc_buffer(TRANSFER_BUFLEN)) == NULL))
+			{
+				perror("[-]Out of memory");
+				close_connection(loop, conn);
+				return -1;
+			}
+			if (conn->header.flags & FRAME_FLAG_COMPRESSED)
+			{
+				dest = conn->zbuf + (conn->header.length - conn->payload_left);
+				want = conn->payload_left;
+			}
+			else
+			{
+				dest = conn->buffer + conn->buffer_len;
+				want = TRANSFER_BUFLEN - conn->buffer_len;
+				want = conn->payload_left < (uint32_t)want ? (int)conn->payload_left : want;
+			}
+		}
+		else
+		{
+			dest = conn->request + (conn->header.length - conn->payload_left);
+			want = conn->payload_left;
+		}
+
+		n = recv(conn->fd, dest, want, 0);
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return 0;
+		}
+		if (n <= 0)
+		{
+			// Only a header or payload partly read means the frame itself was cut off
+			if (conn->frame_len > 0)
+			{
+				printf("[-]Multiplexed connection lost in the middle of a frame.\n");
+			}
+			else if (n == -1)
+			{
+				perror("[-]Multiplexed connection lost");
+			}
+			else if (conn->state != MUX_IDLE)
+			{
+				printf("[-]Client closed the multiplexed connection in the middle of a transfer.\n");
+			}
+			else
+			{
+				printf("[+]Client closed the multiplexed connection.\n\n");
+			}
+			close_connection(loop, conn);
+			return -1;
+		}
+		stats_add(&loop->stats.bytes_in, n);
+
+		if (conn->frame_len < FRAME_HEADER_LEN)
+		{
+			conn->frame_len += n;
+			if (conn->frame_len < FRAME_HEADER_LEN)
+			{
+				continue;
+			}
+			decode_frame_header(conn->frame, &conn->header);
+			conn->payload_left = conn->header.length;
+
+			if ((conn->header.type == FRAME_REQUEST && conn->state == MUX_IDLE && conn->header.length < MAX_REQUEST_LEN) ||
+				(conn->header.type == FRAME_DATA && conn->state == MUX_RECEIVING && conn->header.length <= MAX_FRAME_PAYLOAD) ||
+				(conn->header.type == FRAME_COPY && conn->state == MUX_RECEIVING && conn->req.delta >= 0 &&
+				 conn->header.length == COPY_PAYLOAD_LEN) ||
+				(conn->header.type == FRAME_END && conn->state == MUX_RECEIVING &&
+				 (conn->header.length == 0 || conn->header.length == CHECKSUM_LEN)))
+			{
+				// Expected frame
+			}
+			else
+			{
+				printf("[-]Unexpected frame type %d (%u bytes); closing the connection.\n", conn->header.type, conn->header.length);
+				close_connection(loop, conn);
+				return -1;
+			}
+		}
+		else if (conn->header.type == FRAME_DATA && conn->header.flags & FRAME_FLAG_COMPRESSED)
+		{
+			conn->payload_left -= n;
+			if (conn->payload_left == 0 && conn->file_fd != -1)
+			{
+				// The payload may decompress to a whole buffer, so what is collected goes first
+				if (flush_upload(conn) == -1)
+				{
+					perror("[-]Error in writing file.");
+					close_connection(loop, conn);
+					return -1;
+				}
+				if ((n = decompress_block(conn->zbuf, conn->header.length, conn->buffer, TRANSFER_BUFLEN)) == -1)
+				{
+					printf("[-]Corrupt compressed frame; closing the connection.\n");
+					close_connection(loop, conn);
+					return -1;
+				}
+				if (conn->req.crc == 1)
+				{
+					conn->crc = crc32c(conn->crc, conn->buffer, n);
+				}
+				conn->buffer_len = n;
+				conn->file_offset += n;
+				if (conn->buffer_len == TRANSFER_BUFLEN && flush_upload(conn) == -1)
+				{
+					perror("[-]Error in writing file.");
+					close_connection(loop, conn);
+					return -1;
+				}
+			}
+		}
+		else if (conn->header.type == FRAME_DATA)
+		{
+			if (conn->req.crc == 1)
+			{
+				conn->crc = crc32c(conn->crc, dest, n);
+			}
+			conn->payload_left -= n;
+			if (conn->file_fd != -1)
+			{
+				conn->buffer_len += n;
+				conn->file_offset += n;
+				if (conn->buffer_len == TRANSFER_BUFLEN && flush_upload(conn) == -1)
+				{
+					perror("[-]Error in writing file.");
+					close_connection(loop, conn);
+					return -1;
+				}
+			}
+		}
+		else
+		{
+			conn->payload_left -= n;
+		}
+		if (conn->payload_left > 0)
+		{
+			continue;
+		}
+
+		// The whole frame has arrived
+		conn->frame_len = 0;
+		if (conn->header.type == FRAME_REQUEST)
+		{
+			conn->request[conn->header.length] = '\0';
+			return process_mux_request(loop, conn);
+		}
+		if (conn->header.type == FRAME_COPY)
+		{
+			if (flush_upload(conn) == -1 || copy_blocks(conn) == -1)
+			{
+				perror("[-]Error in copying blocks.");
+				close_connection(loop, conn);
+				return -1;
+			}
+			continue;
+		}
+		if (conn->header.type == FRAME_END && conn->file_fd == -1)
+		{
+			// The ERROR frame already answered this SEND
+			conn->state = MUX_IDLE;
+			continue;
+		}
+		if (conn->header.type == FRAME_END && flush_upload(conn) == -1)
+		{
+			perror("[-]Error in writing file.");
+			close_connection(loop, conn);
+			return -1;
+		}
+		if (conn->header.type == FRAME_END && (n = verify_checksum(conn)) != 0)
+		{
+			if (n == -1)
+			{
+				perror("[-]Error in reading file.");
+				close_connection(loop, conn);
+				return -1;
+			}
+			printf("[-]Checksum mismatch; %s is corrupt.\n", request_file_name(&conn->req));
+			end_transfer(loop, conn, FALSE);
+			abort_upload(conn);
+			close_request_file(conn);
+			queue_frame(conn, FRAME_ERROR, 0, "Checksum mismatch", strlen("Checksum mismatch"));
+			conn->state = MUX_IDLE;
+			return 1;
+		}
+		if (conn->header.type == FRAME_END)
+		{
+			if (finish_upload(conn) == -1)
+			{
+				perror("[-]Error in storing file.");
+				close_connection(loop, conn);
+				return -1;
+			}
+			close(conn->file_fd);
+			conn->file_fd = -1;
+			printf("[+]Data written locally in the file, %s, successfully.\n", request_file_name(&conn->req));
+			end_transfer(loop, conn, TRUE);
+			queue_frame(conn, FRAME_END, 0, NULL, 0);
+			conn->state = MUX_IDLE;
+			return 1;
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       process_mux_request
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - A rejected SEND still consumes its pipelined data
+ *                 October 16th, 2026 - Byte ranges; a GET's ACK carries the range and file size
+ *                 October 16th, 2026 - Negotiates compression
+ *                 October 16th, 2026 - Starts delta uploads
+ *                 October 16th, 2026 - Negotiates CRC trailers
+ *                 October 16th, 2026 - Times the transfer; rejected ones count as failed
+ *                 October 16th, 2026 - Throws away the temporary file of a SEND it can't start
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int process_mux_request (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        int - 1, as the request is always answered with an ACK or ERROR frame
+ *
+ * NOTES:
+ * Acknowledges a framed GET or SEND and opens its file; the file is then streamed in DATA
+ * frames (GET) or filled from the client's DATA frames (SEND)
+ * -----------------------------------------------------------------------*/
+int process_mux_request (struct event_loop *loop, struct connection *conn)
+{
+	char	ack[MAX_REQUEST_LEN];
+	int		error;
+
+	printf("Acknowledging Multiplexed Request:%s\n", conn->request);
+
+	if (parse_request(conn->request, &conn->req) == -1)
+	{
+		printf("[-]Malformed request: %s\n", conn->request);
+		queue_frame(conn, FRAME_ERROR, 0, "Malformed request", strlen("Malformed request"));
+		return 1;
+	}
+	conn->req.crc = conn->req.crc == 1 ? 1 : -1;
+	conn->crc = 0;
+	if (strcmp(conn->req.command, GET_COMMAND_NAME) == 0 || strcmp(conn->req.command, SEND_COMMAND_NAME) == 0)
+	{
+		start_transfer(loop, conn);
+	}
+
+	if (strcmp(conn->req.command, GET_COMMAND_NAME) == 0)
+	{
+		if (open_request_file(conn) == -1)
+		{
+			error = errno;
+			perror("[-]Error in reading file.");
+			if (conn->file_fd != -1)
+			{
+				close(conn->file_fd);
+				conn->file_fd = -1;
+			}
+			end_transfer(loop, conn, FALSE);
+			queue_frame(conn, FRAME_ERROR, 0, strerror(error), strlen(strerror(error)));
+			return 1;
+		}
+		conn->data_left = 0;
+		conn->zero_copy = conn->req.crc != 1;
+		conn->buffer_len = conn->buffer_off = 0;
+		conn->state = MUX_SENDING;
+
+		// Without memory for the match tables the file simply goes out uncompressed
+		compressor_init(&conn->compressor, conn->req.compress);
+		conn->req.compress = conn->compressor.level > 0 ? conn->compressor.level : -1;
+	}
+	else if (strcmp(conn->req.command, SEND_COMMAND_NAME) == 0 && conn->req.delta >= 0)
+	{
+		// The client waits for the signatures, so nothing follows a rejected delta
+		if (start_delta(conn) == -1)
+		{
+			error = errno;
+			perror("[-]Error in opening file.");
+			abort_upload(conn);
+			end_transfer(loop, conn, FALSE);
+			queue_frame(conn, FRAME_ERROR, 0, strerror(error), strlen(strerror(error)));
+			return 1;
+		}
+		conn->state = MUX_SIGNING;
+	}
+	else if (strcmp(conn->req.command, SEND_COMMAND_NAME) == 0)
+	{
+		conn->state = MUX_RECEIVING;
+		if (open_request_file(conn) == -1)
+		{
+			// The client may already be sending the file; it is read and dropped up to END
+			error = errno;
+			perror("[-]Error in opening file.");
+			abort_upload(conn);
+			if (conn->file_fd != -1)
+			{
+				close(conn->file_fd);
+				conn->file_fd = -1;
+			}
+			end_transfer(loop, conn, FALSE);
+			queue_frame(conn, FRAME_ERROR, 0, strerror(error), strlen(strerror(error)));
+			return 1;
+		}
+		if (conn->req.compress > COMPRESS_MAX_LEVEL)
+		{
+			conn->req.compress = COMPRESS_MAX_LEVEL;
+		}
+	}
+	else
+	{
+		printf("[-]Unknown request command: %s\n", conn->request);
+		queue_frame(conn, FRAME_ERROR, 0, "Unknown request command", strlen("Unknown request command"));
+		return 1;
+	}
+	format_request(ack, sizeof(ack), &conn->req);
+	queue_frame(conn, FRAME_ACK, 0, ack, strlen(ack));
+	return 1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_mux_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Compresses the frames the compressor picks
+ *                 October 16th, 2026 - Releases a cached file at the end
+ *                 October 16th, 2026 - Ends with the CRC of the data when asked to
+ *                 October 16th, 2026 - Counts the bytes sent and ends the GET's timing
+ *                 October 16th, 2026 - Sends in the session's turns, within its bandwidth allowance
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int send_mux_file (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        int - 1 once the file is sent and END is queued, 0 if the socket would block,
+ *                       -1 if the connection was closed
+ *
+ * NOTES:
+ * Streams the requested file as DATA frames. Payloads go out through sendfile, except the
+ * blocks the compressor picks, which are read and compressed into the session's buffer.
+ * Like a socket that would block, a used-up turn or bandwidth allowance returns 0; the
+ * scheduler resumes the connection.
+ * -----------------------------------------------------------------------*/
+int send_mux_file (struct event_loop *loop, struct connection *conn)
+{
+	ssize_t		n;
+	long long	allowed;
+	int			flushed, block, flags;
+
+	while (TRUE)
+	{
+		if (conn->data_left == 0)
+		{
+			if (conn->file_left == 0)
+			{
+				close_request_file(conn);
+				printf("[+]File data sent successfully.\n");
+				end_transfer(loop, conn, TRUE);
+				end_sending(loop, conn);
+				queue_end(conn);
+				conn->state = MUX_IDLE;
+				return 1;
+			}
+			block = conn->file_left < MAX_FRAME_PAYLOAD ? conn->file_left : MAX_FRAME_PAYLOAD;
+			conn->data_buffered = FALSE;
+			conn->data_left = block;
+			flags = 0;
+			if (compress_next(&conn->compressor) && (flags = compress_file_block(conn, block)) == -1)
+			{
+				perror("[-]Error in reading file.");
+				close_connection(loop, conn);
+				return -1;
+			}
+			if (conn->data_buffered)
+			{
+				conn->data_left = conn->buffer_len;
+			}
+			conn->file_left -= block;
+			queue_frame(conn, FRAME_DATA, flags, NULL, conn->data_left);
+			if ((flushed = flush_frames(loop, conn)) <= 0)
+			{
+				return flushed;
+			}
+		}
+
+		if ((allowed = send_allowance(loop, conn, conn->data_left)) == 0)
+		{
+			return 0;
+		}
+		if (conn->data_buffered)
+		{
+			if ((n = send(conn->fd, conn->buffer + conn->buffer_off, allowed, MSG_NOSIGNAL)) > 0)
+			{
+				conn->buffer_off += n;
+			}
+		}
+		else
+		{
+			n = send_file_chunk(conn, allowed);
+		}
+		if (n > 0)
+		{
+			conn->data_left -= n;
+			charge_send(conn, n);
+			stats_add(&loop->stats.bytes_out, n);
+			continue;
+		}
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return 0;
+		}
+		if (n == 0)
+		{
+			printf("[-]File shrank while it was being sent.\n");
+		}
+		else
+		{
+			perror("[-]Error in sending file.");
+		}
+		close_connection(loop, conn);
+		return -1;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       queue_frame
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Takes the frame's flags
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void queue_frame (struct connection *conn, int type, int flags, const char *payload, int len)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Queues a frame for flush_frames. With a NULL payload only the header is queued and the
+ * caller sends the len payload bytes itself.
+ * -----------------------------------------------------------------------*/
+void queue_frame (struct connection *conn, int type, int flags, const char *payload, int len)
+{
+	struct frame_header header;
+
+	header.type = type;
+	header.flags = flags;
+	header.length = len;
+	encode_frame_header(conn->out, &header);
+	conn->out_len = FRAME_HEADER_LEN;
+	if (payload != NULL)
+	{
+		if (len > MAX_REQUEST_LEN)
+		{
+			len = header.length = MAX_REQUEST_LEN;
+			encode_frame_header(conn->out, &header);
+		}
+		memcpy(conn->out + FRAME_HEADER_LEN, payload, len);
+		conn->out_len += len;
+	}
+	conn->out_off = 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       flush_frames
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Counts the bytes sent
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int flush_frames (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        int - 1 once nothing is queued, 0 if the socket would block,
+ *                       -1 if the connection was closed
+ *
+ * NOTES:
+ * Sends whatever is left of the queued frame
+ * -----------------------------------------------------------------------*/
+int flush_frames (struct event_loop *loop, struct connection *conn)
+{
+	int n;
+
+	while (conn->out_off < conn->out_len)
+	{
+		n = send(conn->fd, conn->out + conn->out_off, conn->out_len - conn->out_off, MSG_NOSIGNAL);
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return 0;
+		}
+		if (n == -1)
+		{
+			perror("[-]Error in sending frame.");
+			close_connection(loop, conn);
+			return -1;
+		}
+		conn->out_off += n;
+		stats_add(&loop->stats.bytes_out, n);
+	}
+	conn->out_len = conn->out_off = 0;
+	return 1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_file_chunk
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Reads at the session's file offset
+ *                 October 16th, 2026 - Sends a cached file straight from memory
+ *                 October 16th, 2026 - Adds the bytes it reads to the transfer's CRC
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      ssize_t send_file_chunk (struct connection *conn, size_t max)
+ *
+ * RETURNS:        ssize_t - bytes sent, 0 at the end of the file, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Moves up to max bytes from the session's file, starting at its file offset, to its socket;
+ * from the cached copy when there is one, with sendfile when the file allows it and through
+ * the session's copy buffer otherwise
+ * -----------------------------------------------------------------------*/
+ssize_t send_file_chunk (struct connection *conn, size_t max)
+{
+	ssize_t	n;
+	size_t	len;
+
+	if (conn->cached != NULL)
+	{
+		if ((n = send(conn->fd, conn->cached->data + conn->file_offset, max, MSG_NOSIGNAL)) > 0)
+		{
+			if (conn->req.crc == 1)
+			{
+				conn->crc = crc32c(conn->crc, conn->cached->data + conn->file_offset, n);
+			}
+			conn->file_offset += n;
+		}
+		return n;
+	}
+
+	// Let the kernel move the file from the page cache straight to the socket
+	if (conn->zero_copy)
+	{
+		n = sendfile(conn->fd, conn->file_fd, &conn->file_offset, max);
+		if (n != -1 || (errno != EINVAL && errno != ENOSYS))
+		{
+			return n;
+		}
+		// The file can't be mapped for sendfile; copy it through a buffer from here on
+		conn->zero_copy = FALSE;
+	}
+
+	if (conn->buffer == NULL && (conn->buffer = alloc_buffer(TRANSFER_BUFLEN)) == NULL)
+	{
+		return -1;
+	}
+	if (conn->buffer_off == conn->buffer_len)
+	{
+		if ((n = pread(conn->file_fd, conn->buffer, max < TRANSFER_BUFLEN ? max : TRANSFER_BUFLEN, conn->file_offset)) <= 0)
+		{
+			return n;
+		}
+		if (conn->req.crc == 1)
+		{
+			conn->crc = crc32c(conn->crc, conn->buffer, n);
+		}
+		conn->file_offset += n;
+		conn->buffer_len = n;
+		conn->buffer_off = 0;
+	}
+	len = conn->buffer_len - conn->buffer_off;
+	if ((n = send(conn->fd, conn->buffer + conn->buffer_off, len < max ? len : max, MSG_NOSIGNAL)) > 0)
+	{
+		conn->buffer_off += n;
+	}
+	return n;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       compress_file_block
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Copies a cached file's block from memory
+ *                 October 16th, 2026 - Adds the block to the transfer's CRC
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int compress_file_block (struct connection *conn, int len)
+ *
+ * RETURNS:        int - flags of the DATA frame, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Reads the next len bytes of the session's file into its buffer, as the payload of the next
+ * DATA frame, and compresses them there unless the compressor finds they don't shrink
+ * -----------------------------------------------------------------------*/
+int compress_file_block (struct connection *conn, int len)
+{
+	char	*swap;
+	int		n;
+
+	if ((conn->buffer == NULL && (conn->buffer = alloc_buffer(TRANSFER_BUFLEN)) == NULL) ||
+		(conn->zbuf == NULL && (conn->zbuf = alloc_buffer(TRANSFER_BUFLEN)) == NULL) ||
+		(conn->cached == NULL && read_at(conn->file_fd, conn->buffer, len, conn->file_offset) == -1))
+	{
+		return -1;
+	}
+	if (conn->cached != NULL)
+	{
+		memcpy(conn->buffer, conn->cached->data + conn->file_offset, len);
+	}
+	if (conn->req.crc == 1)
+	{
+		conn->crc = crc32c(conn->crc, conn->buffer, len);
+	}
+	conn->file_offset += len;
+	conn->buffer_len = len;
+	conn->buffer_off = 0;
+	conn->data_buffered = TRUE;
+
+	if ((n = compress_block(&conn->compressor, conn->buffer, len, conn->zbuf, TRANSFER_BUFLEN)) == 0)
+	{
+		return 0;
+	}
+	swap = conn->buffer;
+	conn->buffer = conn->zbuf;
+	conn->zbuf = swap;
+	conn->buffer_len = n;
+	return FRAME_FLAG_COMPRESSED;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       start_delta
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Works on the file the request names
+ *                 October 16th, 2026 - Creates its temporary file with open_temp_file
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int start_delta (struct connection *conn)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Opens the current send.txt as the base of a delta upload (a missing file is an empty base)
+ * and creates the temporary file the new one is built in. The request is rewritten into the
+ * acknowledgement: the base's size and the block size actually used.
+ * -----------------------------------------------------------------------*/
+int start_delta (struct connection *conn)
+{
+	struct stat	st;
+	const char	*name = request_file_name(&conn->req);
+
+	if ((conn->buffer == NULL && (conn->buffer = alloc_buffer(TRANSFER_BUFLEN)) == NULL) ||
+		(conn->zbuf == NULL && (conn->zbuf = alloc_buffer(TRANSFER_BUFLEN)) == NULL))
+	{
+		return -1;
+	}
+	conn->base_size = 0;
+	if ((conn->base_fd = open(name, O_RDONLY)) == -1 && errno != ENOENT)
+	{
+		return -1;
+	}
+	if (conn->base_fd != -1)
+	{
+		if (fstat(conn->base_fd, &st) == -1)
+		{
+			return -1;
+		}
+		conn->base_size = st.st_size;
+	}
+	if (open_temp_file(conn) == -1)
+	{
+		return -1;
+	}
+	conn->direct = FALSE;
+
+	conn->block_size = conn->req.delta < DELTA_MIN_BLOCK ? DELTA_MIN_BLOCK :
+		(conn->req.delta > DELTA_MAX_BLOCK ? DELTA_MAX_BLOCK : conn->req.delta);
+	conn->file_offset = 0;
+	conn->file_left = conn->base_size;
+	conn->data_left = 0;
+	conn->req.size = conn->base_size;
+	conn->req.delta = conn->block_size;
+	conn->req.offset = conn->req.length = -1;
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_signatures
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Counts the bytes sent
+ *                 October 16th, 2026 - Empties the buffer for the delta's data
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int send_signatures (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        int - 1 once every signature is sent and END is queued, 0 if the socket
+ *                       would block, -1 if the connection was closed
+ *
+ * NOTES:
+ * Signs the base of a delta upload a buffer at a time, one SIGNATURES frame per buffer, then
+ * waits for the client's delta
+ * -----------------------------------------------------------------------*/
+int send_signatures (struct event_loop *loop, struct connection *conn)
+{
+	ssize_t	n;
+	int		flushed, len, i;
+
+	while (TRUE)
+	{
+		if (conn->data_left == 0)
+		{
+			if (conn->file_left == 0)
+			{
+				queue_frame(conn, FRAME_END, 0, NULL, 0);
+				conn->file_offset = 0;
+				conn->buffer_len = 0;
+				conn->state = MUX_RECEIVING;
+				return 1;
+			}
+			len = TRANSFER_BUFLEN / conn->block_size * conn->block_size;
+			len = conn->file_left < len ? conn->file_left : len;
+			if (read_at(conn->base_fd, conn->zbuf, len, conn->file_offset) == -1)
+			{
+				perror("[-]Error in reading file.");
+				close_connection(loop, conn);
+				return -1;
+			}
+			for (i = 0, conn->buffer_len = 0; i < len; i += conn->block_size, conn->buffer_len += SIGNATURE_LEN)
+			{
+				encode_signature(conn->buffer + conn->buffer_len, (unsigned char *)conn->zbuf + i,
+					len - i < conn->block_size ? len - i : conn->block_size);
+			}
+			conn->file_offset += len;
+			conn->file_left -= len;
+			conn->buffer_off = 0;
+			conn->data_left = conn->buffer_len;
+			queue_frame(conn, FRAME_SIGNATURES, 0, NULL, conn->data_left);
+			if ((flushed = flush_frames(loop, conn)) <= 0)
+			{
+				return flushed;
+			}
+		}
+
+		n = send(conn->fd, conn->buffer + conn->buffer_off, conn->data_left, MSG_NOSIGNAL);
+		if (n > 0)
+		{
+			conn->buffer_off += n;
+			conn->data_left -= n;
+			stats_add(&loop->stats.bytes_out, n);
+			continue;
+		}
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return 0;
+		}
+		perror("[-]Error in sending signatures.");
+		close_connection(loop, conn);
+		return -1;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       copy_blocks
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - The copy itself moved to copy_file_data
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int copy_blocks (struct connection *conn)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Appends the run of base blocks named by a COPY frame to the new file
+ * -----------------------------------------------------------------------*/
+int copy_blocks (struct connection *conn)
+{
+	uint32_t	index, count;
+	off_t		from, len;
+
+	memcpy(&index, conn->request, 4);
+	memcpy(&count, conn->request + 4, 4);
+	from = (off_t)ntohl(index) * conn->block_size;
+	len = (off_t)ntohl(count) * conn->block_size;
+	if (from >= conn->base_size || len == 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	len = len < conn->base_size - from ? len : conn->base_size - from;
+	return copy_file_data(conn, conn->base_fd, from, len);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       copy_file_data
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int copy_file_data (struct connection *conn, int fd, off_t from, off_t len)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set; EIO if fd ends early)
+ *
+ * NOTES:
+ * Appends len bytes of fd, starting at from, to the session's file. The kernel copies
+ * them with copy_file_range, or they go through the session's buffer when it can't.
+ * -----------------------------------------------------------------------*/
+int copy_file_data (struct connection *conn, int fd, off_t from, off_t len)
+{
+	ssize_t	n;
+	int		in_kernel = TRUE;
+
+	while (len > 0)
+	{
+		if (in_kernel)
+		{
+			n = copy_file_range(fd, &from, conn->file_fd, &conn->file_offset, len, 0);
+			if (n == -1 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP))
+			{
+				in_kernel = FALSE;
+				continue;
+			}
+		}
+		else if ((n = pread(fd, conn->buffer, len < TRANSFER_BUFLEN ? len : TRANSFER_BUFLEN, from)) > 0)
+		{
+			if (write_all(conn->file_fd, conn->buffer, n, conn->file_offset) == -1)
+			{
+				return -1;
+			}
+			from += n;
+			conn->file_offset += n;
+		}
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			// The source shrank under the copy
+			errno = n == 0 ? EIO : errno;
+			return -1;
+		}
+		len -= n;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       finish_upload
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Replaces the file the request names
+ *                 October 16th, 2026 - Renamed from finish_delta; finishes every SEND
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int finish_upload (struct connection *conn)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set; EPIPE if the file came up short)
+ *
+ * NOTES:
+ * Writes what is left in the session's buffer and, for a SEND that built a new file, renames
+ * it over the one the request names. A whole file shorter than the size its SEND announced
+ * is refused: a legacy client that dies mid-upload ends its data connection just like one
+ * that is done.
+ * -----------------------------------------------------------------------*/
+int finish_upload (struct connection *conn)
+{
+	if (flush_upload(conn) == -1)
+	{
+		return -1;
+	}
+	if (conn->temp_name[0] != '\0')
+	{
+		if (conn->req.delta < 0 && conn->req.size >= 0 && conn->file_offset < conn->req.size)
+		{
+			errno = EPIPE;
+			return -1;
+		}
+		if (rename(conn->temp_name, request_file_name(&conn->req)) == -1)
+		{
+			return -1;
+		}
+		conn->temp_name[0] = '\0';
+	}
+	if (conn->base_fd != -1)
+	{
+		close(conn->base_fd);
+		conn->base_fd = -1;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       abort_upload
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Renamed from abort_delta; aborts every SEND
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void abort_upload (struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Throws away the new file of an unfinished upload, leaving the old one as it was. A ranged
+ * SEND writes in place, and what it received is kept for a resumed upload.
+ * -----------------------------------------------------------------------*/
+void abort_upload (struct connection *conn)
+{
+	if (conn->base_fd != -1)
+	{
+		close(conn->base_fd);
+		conn->base_fd = -1;
+	}
+	if (conn->temp_name[0] != '\0')
+	{
+		unlink(conn->temp_name);
+		conn->temp_name[0] = '\0';
+		close(conn->file_fd);
+		conn->file_fd = -1;
+	}
+	else if (conn->file_fd != -1 && (conn->state == RECEIVING_FILE || conn->state == MUX_RECEIVING))
+	{
+		flush_upload(conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       queue_end
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void queue_end (struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Queues the END frame closing a GET's data, with its CRC if the request asked for one
+ * -----------------------------------------------------------------------*/
+void queue_end (struct connection *conn)
+{
+	uint32_t crc = htonl(conn->crc);
+
+	if (conn->req.crc == 1)
+	{
+		queue_frame(conn, FRAME_END, 0, (char *)&crc, CHECKSUM_LEN);
+	}
+	else
+	{
+		queue_frame(conn, FRAME_END, 0, NULL, 0);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       verify_checksum
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Only delta uploads are read back
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int verify_checksum (struct connection *conn)
+ *
+ * RETURNS:        int - 0 if the CRC matches or there is none to check, 1 if it doesn't
+ *                       match, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Compares the CRC in the END frame of a SEND, held in the request buffer, with the data
+ * received. The blocks a delta upload copied never passed through the server, so its new
+ * file is read back whole instead.
+ * -----------------------------------------------------------------------*/
+int verify_checksum (struct connection *conn)
+{
+	uint32_t	expected;
+	off_t		offset;
+	int			len;
+
+	if (conn->req.crc != 1 || conn->header.length != CHECKSUM_LEN || conn->file_fd == -1)
+	{
+		return 0;
+	}
+	memcpy(&expected, conn->request, CHECKSUM_LEN);
+
+	if (conn->req.delta >= 0)
+	{
+		for (conn->crc = 0, offset = 0; offset < conn->file_offset; offset += len)
+		{
+			len = conn->file_offset - offset < TRANSFER_BUFLEN ? conn->file_offset - offset : TRANSFER_BUFLEN;
+			if (read_at(conn->file_fd, conn->zbuf, len, offset) == -1)
+			{
+				return -1;
+			}
+			conn->crc = crc32c(conn->crc, conn->zbuf, len);
+		}
+	}
+	return ntohl(expected) == conn->crc ? 0 : 1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       read_at
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int read_at (int fd, char *data, int len, off_t offset)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set; EIO if the file ends first)
+ *
+ * NOTES:
+ * Reads exactly len bytes of a file from offset, retrying short and interrupted reads
+ * -----------------------------------------------------------------------*/
+int read_at (int fd, char *data, int len, off_t offset)
+{
+	ssize_t n;
+
+	while (len > 0)
+	{
+		if ((n = pread(fd, data, len, offset)) <= 0)
+		{
+			if (n == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			errno = n == 0 ? EIO : errno;
+			return -1;
+		}
+		data += n;
+		len -= n;
+		offset += n;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       write_all
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Positional, so ranges of one file can be written side by side
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int write_all (int fd, const char *data, int len, off_t offset)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Writes len bytes to a file at offset, retrying short and interrupted writes
+ * -----------------------------------------------------------------------*/
+int write_all (int fd, const char *data, int len, off_t offset)
+{
+	int n;
+
+	while (len > 0)
+	{
+		if ((n = pwrite(fd, data, len, offset)) == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		data += n;
+		len -= n;
+		offset += n;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       run_ring
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void run_ring (struct event_loop *loop, int timeout)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Submits every request queued since the last pass and waits up to timeout milliseconds for
+ * completions, then hands each completion to the connection it belongs to
+ * -----------------------------------------------------------------------*/
+void run_ring (struct event_loop *loop, int timeout)
+{
+	struct io_uring_cqe	*cqe;
+	struct ring_op		*op;
+	int					res, more;
+
+	if (uring_wait(loop->ring, timeout) == -1)
+	{
+		perror("[-]Error waiting on io_uring");
+		exit(1);
+	}
+	while ((cqe = uring_peek_cqe(loop->ring)) != NULL)
+	{
+		op = (struct ring_op *)(uintptr_t)cqe->user_data;
+		res = cqe->res;
+		more = cqe->flags & IORING_CQE_F_MORE;
+		uring_cqe_seen(loop->ring);
+		complete_ring_op(loop, op, res, more);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       complete_ring_op
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Counts accepts and the bytes received and sent
+ *                 October 16th, 2026 - Traces the wait for the request
+ *                 October 16th, 2026 - A receive adds to its buffer until the buffer is full
+ *                 October 16th, 2026 - Opens the data port a request asks for before echoing it
+ *                 October 16th, 2026 - Pauses accepts when out of descriptors instead of requeueing them
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void complete_ring_op (struct event_loop *loop, struct ring_op *op, int res, int more)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Acts on one completed request; res is the system call's result or a negated errno, and more
+ * is set when a multishot request stays armed. Every case queues whatever the connection
+ * needs next.
+ * -----------------------------------------------------------------------*/
+void complete_ring_op (struct event_loop *loop, struct ring_op *op, int res, int more)
+{
+	struct connection *conn = op->conn;
+
+	if (!more)
+	{
+		op->busy = FALSE;
+		if (conn != NULL)
+		{
+			conn->ring_busy--;
+		}
+	}
+
+	// Readiness for everything still driven by epoll
+	if (op->type == RING_POLL_EVENTS)
+	{
+		while (poll_events(loop, 0) == MAX_EVENTS)
+		{
+		}
+		if (!more)
+		{
+			ring_poll_events(loop);
+		}
+		return;
+	}
+	if (conn->closing)
+	{
+		if (conn->ring_busy == 0)
+		{
+			close_connection(loop, conn);
+		}
+		return;
+	}
+	if (res < 0)
+	{
+		errno = -res;
+	}
+
+	switch (op->type)
+	{
+		case RING_POLL_EVENTS:
+		break;
+		case RING_ACCEPT:
+			if (res >= 0 && conn->kind == CONTROL_LISTENER)
+			{
+				add_client_connection(loop, res, &conn->peer);
+			}
+			else if (res >= 0)
+			{
+				pair_data_connection(loop, res, &conn->peer);
+			}
+			else if (errno == EMFILE || errno == ENFILE)
+			{
+				// Requeued now, the accept would fail again at once
+				perror("[-]Can't accept client");
+				stats_add(&loop->stats.failed_connections, 1);
+				pause_accepts(loop, conn);
+				break;
+			}
+			else if (errno != EINTR && errno != EAGAIN)
+			{
+				perror("[-]Can't accept client");
+				stats_add(&loop->stats.failed_connections, 1);
+			}
+			ring_accept(loop, conn);
+		break;
+		case RING_RECV_REQUEST:
+			if (res <= 0)
+			{
+				printf("[-]Client closed the control connection before sending a request.\n");
+				close_connection(loop, conn);
+				return;
+			}
+			conn->request_len += res;
+			stats_add(&loop->stats.bytes_in, res);
+			if (conn->request_len == REQ_BUFLEN)
+			{
+				trace_phase(loop, conn, "request");
+				conn->request[REQ_BUFLEN - 1] = '\0';
+				open_data_port(conn);
+				printf ("Acknowledging Request:%s\n", conn->request);
+				conn->state = WRITING_ACK;
+			}
+			ring_receive_request(loop, conn);
+		break;
+		case RING_SEND_ACK:
+			if (res < 0)
+			{
+				perror("[-]Can't acknowledge request");
+				close_connection(loop, conn);
+				return;
+			}
+			conn->ack_len += res;
+			stats_add(&loop->stats.bytes_out, res);
+			if (conn->ack_len == REQ_BUFLEN)
+			{
+				start_session(loop, conn);
+				return;
+			}
+			ring_receive_request(loop, conn);
+		break;
+		case RING_READ_FILE:
+			if (res != op->len)
+			{
+				if (res < 0)
+				{
+					perror("[-]Error in reading file.");
+				}
+				else
+				{
+					printf("[-]File shrank while it was being sent.\n");
+				}
+				close_connection(loop, conn);
+				return;
+			}
+			ring_send_file(loop, conn);
+		break;
+		case RING_SEND_DATA:
+			if (res < 0)
+			{
+				perror("[-]Error in sending file.");
+				close_connection(loop, conn);
+				return;
+			}
+			op->done += res;
+			stats_add(&loop->stats.bytes_out, res);
+			if (op->done == op->len)
+			{
+				op->len = op->done = 0;
+				conn->ring_next = (conn->ring_next + 1) % RING_SLOTS;
+			}
+			ring_send_file(loop, conn);
+		break;
+		case RING_RECV_DATA:
+			if (res < 0)
+			{
+				perror("[-]Error in receiving file.");
+				close_connection(loop, conn);
+				return;
+			}
+			if (res == 0)
+			{
+				conn->ring_eof = TRUE;
+			}
+			stats_add(&loop->stats.bytes_in, res);
+			if (op->len == 0)
+			{
+				op->offset = conn->ring_offset;
+			}
+			op->len += res;
+			op->done = 0;
+			conn->ring_offset += res;
+			ring_write_file(loop, conn);
+		break;
+		case RING_WRITE_FILE:
+			if (res < 0)
+			{
+				perror("[-]Error in writing file.");
+				close_connection(loop, conn);
+				return;
+			}
+			op->done += res;
+			if (op->done == op->len)
+			{
+				op->len = op->done = 0;
+			}
+			ring_write_file(loop, conn);
+		break;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       queue_ring_op
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      struct io_uring_sqe *queue_ring_op (struct event_loop *loop, struct ring_op *op, int opcode,
+ *                                                     int fd, const void *addr, unsigned len, off_t offset)
+ *
+ * RETURNS:        struct io_uring_sqe * - the queued request, for the caller to add flags to
+ *
+ * NOTES:
+ * Queues a request for op; it is submitted the next time the loop waits on the ring
+ * -----------------------------------------------------------------------*/
+struct io_uring_sqe *queue_ring_op (struct event_loop *loop, struct ring_op *op, int opcode, int fd, const void *addr, unsigned len, off_t offset)
+{
+	struct io_uring_sqe *sqe;
+
+	if ((sqe = uring_get_sqe(loop->ring)) == NULL)
+	{
+		perror("[-]Can't queue io_uring request");
+		exit(1);
+	}
+	uring_prep(sqe, opcode, fd, addr, len, offset, op);
+	op->busy = TRUE;
+	if (op->conn != NULL)
+	{
+		op->conn->ring_busy++;
+	}
+	return sqe;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       ring_poll_events
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void ring_poll_events (struct event_loop *loop)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Watches the loop's epoll instance from the ring, so the sockets still driven by readiness
+ * are served by the same wait as the ring's own requests
+ * -----------------------------------------------------------------------*/
+void ring_poll_events (struct event_loop *loop)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = queue_ring_op(loop, &loop->events_op, IORING_OP_POLL_ADD, loop->epoll_fd, NULL, IORING_POLL_ADD_MULTI, 0);
+	sqe->poll32_events = POLLIN;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       ring_accept
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void ring_accept (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Queues an accept on a listening socket; the client's address lands in the listener's peer
+ * -----------------------------------------------------------------------*/
+void ring_accept (struct event_loop *loop, struct connection *conn)
+{
+	struct io_uring_sqe	*sqe;
+	struct ring_op		*op = &conn->ring_ops[0];
+
+	op->conn = conn;
+	op->type = RING_ACCEPT;
+	conn->peer_len = sizeof(conn->peer);
+	sqe = queue_ring_op(loop, op, IORING_OP_ACCEPT, conn->fd, &conn->peer, 0, 0);
+	sqe->addr2 = (uint64_t)(uintptr_t)&conn->peer_len;
+	sqe->accept_flags = SOCK_NONBLOCK;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       ring_receive_request
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void ring_receive_request (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Queues the rest of a control connection's request, or the rest of its echo once the
+ * request is complete
+ * -----------------------------------------------------------------------*/
+void ring_receive_request (struct event_loop *loop, struct connection *conn)
+{
+	struct io_uring_sqe	*sqe;
+	struct ring_op		*op = &conn->ring_ops[0];
+
+	op->conn = conn;
+	if (conn->state == READING_REQUEST)
+	{
+		op->type = RING_RECV_REQUEST;
+		queue_ring_op(loop, op, IORING_OP_RECV, conn->fd, conn->request + conn->request_len, REQ_BUFLEN - conn->request_len, 0);
+	}
+	else
+	{
+		op->type = RING_SEND_ACK;
+		sqe = queue_ring_op(loop, op, IORING_OP_SEND, conn->fd, conn->request + conn->ack_len, REQ_BUFLEN - conn->ack_len, 0);
+		sqe->msg_flags = MSG_NOSIGNAL;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       start_ring_transfer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Starts at the requested range
+ *                 October 16th, 2026 - Aligned buffers, so O_DIRECT uploads can be written from them
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int start_ring_transfer (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        int - 0 on success, -1 if the connection had to be closed
+ *
+ * NOTES:
+ * Gives a data connection its transfer buffers, one per slot, before its first ring request
+ * -----------------------------------------------------------------------*/
+int start_ring_transfer (struct event_loop *loop, struct connection *conn)
+{
+	int i;
+
+	if ((conn->buffer = alloc_buffer(RING_SLOTS * TRANSFER_BUFLEN)) == NULL)
+	{
+		perror("[-]Out of memory");
+		close_connection(loop, conn);
+		return -1;
+	}
+	for (i = 0; i < RING_SLOTS; i++)
+	{
+		conn->ring_ops[i].conn = conn;
+		conn->ring_ops[i].data = conn->buffer + i * TRANSFER_BUFLEN;
+		conn->ring_ops[i].len = conn->ring_ops[i].done = 0;
+	}
+	conn->ring_next = 0;
+	conn->ring_offset = conn->file_offset;
+	conn->ring_size = conn->file_offset + conn->file_left;
+	conn->ring_eof = FALSE;
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       ring_send_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Sends a cached file straight from memory
+ *                 October 16th, 2026 - Counts the completed transfer
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void ring_send_file (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Queues the next steps of a GET: every empty buffer is filled with the next piece of the file
+ * while the buffer whose turn it is goes out on the socket. Buffers are sent in file order, one
+ * at a time; the connection is closed once the whole file is sent. A cached file needs no
+ * reads: its slots point straight into the cached copy.
+ * -----------------------------------------------------------------------*/
+void ring_send_file (struct event_loop *loop, struct connection *conn)
+{
+	struct io_uring_sqe	*sqe;
+	struct ring_op		*op;
+	int					i;
+
+	for (i = 0; i < RING_SLOTS; i++)
+	{
+		op = &conn->ring_ops[i];
+		if (!op->busy && op->len == 0 && conn->ring_offset < conn->ring_size && conn->cached != NULL)
+		{
+			op->offset = conn->ring_offset;
+			op->len = conn->ring_size - conn->ring_offset < SENDFILE_CHUNK ? conn->ring_size - conn->ring_offset : SENDFILE_CHUNK;
+			op->data = conn->cached->data + op->offset;
+			conn->ring_offset += op->len;
+		}
+		else if (!op->busy && op->len == 0 && conn->ring_offset < conn->ring_size)
+		{
+			op->type = RING_READ_FILE;
+			op->offset = conn->ring_offset;
+			op->len = conn->ring_size - conn->ring_offset < TRANSFER_BUFLEN ? conn->ring_size - conn->ring_offset : TRANSFER_BUFLEN;
+			conn->ring_offset += op->len;
+			queue_ring_op(loop, op, IORING_OP_READ, conn->file_fd, op->data, op->len, op->offset);
+		}
+	}
+
+	op = &conn->ring_ops[conn->ring_next];
+	if (!op->busy && op->len > 0)
+	{
+		op->type = RING_SEND_DATA;
+		sqe = queue_ring_op(loop, op, IORING_OP_SEND, conn->fd, op->data + op->done, op->len - op->done, 0);
+		sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+	}
+
+	if (conn->ring_busy == 0)
+	{
+		printf("[+]File data sent successfully.\n");
+		printf("[+]Closing the connection.\n\n");
+		end_transfer(loop, conn, TRUE);
+		close_connection(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       ring_write_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Counts the completed transfer
+ *                 October 16th, 2026 - Writes whole buffers and stores the file through finish_upload
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void ring_write_file (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Queues the next steps of a SEND: every full buffer is written at its own file offset while
+ * the next one receives from the socket. A buffer takes as many receives as it needs to fill,
+ * so the file is written a whole buffer at a time, save for its end. Only one receive is in
+ * flight, which keeps the data in order; the connection is closed once the client is done
+ * and everything is written.
+ * -----------------------------------------------------------------------*/
+void ring_write_file (struct event_loop *loop, struct connection *conn)
+{
+	struct ring_op	*op, *fill_op = NULL;
+	int				i, receiving = FALSE;
+
+	for (i = 0; i < RING_SLOTS; i++)
+	{
+		op = &conn->ring_ops[i];
+		if (op->busy)
+		{
+			receiving |= op->type == RING_RECV_DATA;
+		}
+		else if (op->len == TRANSFER_BUFLEN || (conn->ring_eof && op->len > 0))
+		{
+			if (conn->direct && (op->len - op->done) % DIRECT_IO_ALIGN != 0 && stop_direct_io(conn) == -1)
+			{
+				perror("[-]Error in writing file.");
+				close_connection(loop, conn);
+				return;
+			}
+			op->type = RING_WRITE_FILE;
+			queue_ring_op(loop, op, IORING_OP_WRITE, conn->file_fd, op->data + op->done, op->len - op->done, op->offset + op->done);
+		}
+		else if (fill_op == NULL || op->len > 0)
+		{
+			// A partly filled buffer must be finished before the next one starts
+			fill_op = op;
+		}
+	}
+
+	if (!conn->ring_eof && !receiving && fill_op != NULL)
+	{
+		fill_op->type = RING_RECV_DATA;
+		queue_ring_op(loop, fill_op, IORING_OP_RECV, conn->fd, fill_op->data + fill_op->len, TRANSFER_BUFLEN - fill_op->len, 0);
+	}
+
+	if (conn->ring_busy == 0)
+	{
+		conn->file_offset = conn->ring_offset;
+		if (finish_upload(conn) == -1)
+		{
+			perror("[-]Error in storing file.");
+			close_connection(loop, conn);
+			return;
+		}
+		printf("[+]Data written locally in the file, %s, successfully.\n", request_file_name(&conn->req));
+		printf("[+]Closing the client and data channel socket connections.\n\n");
+		end_transfer(loop, conn, TRUE);
+		close_connection(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       start_transfer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Starts the transfer's span
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void start_transfer (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Starts timing the GET or SEND a session was just asked for
+ * -----------------------------------------------------------------------*/
+void start_transfer (struct event_loop *loop, struct connection *conn)
+{
+	conn->transfer_start = now_ns();
+	trace_phase(loop, conn, NULL);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       end_transfer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Ends the transfer's span
+ *                 October 16th, 2026 - Refreshes the index entry of a SEND's file
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void end_transfer (struct event_loop *loop, struct connection *conn, int completed)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Counts a session's transfer as completed, recording how long it took, or as failed.
+ * Transfers still running when their connection closes are ended as failed there.
+ * -----------------------------------------------------------------------*/
+void end_transfer (struct event_loop *loop, struct connection *conn, int completed)
+{
+	static const char	*spans[STATS_COMMANDS][2] = {{"GET failed", "GET"}, {"SEND failed", "SEND"}};
+	int					command = strcmp(conn->req.command, GET_COMMAND_NAME) == 0 ? STATS_GET : STATS_SEND;
+
+	trace_phase(loop, conn, spans[command][completed ? 1 : 0]);
+
+	// Even a failed SEND may have changed the file; GETs see the new copy straight away
+	if (command == STATS_SEND)
+	{
+		file_index_refresh(&file_index, request_file_name(&conn->req));
+	}
+	if (completed)
+	{
+		stats_add(&loop->stats.transfers[command], 1);
+		histogram_record(&loop->stats.latency[command], now_ns() - conn->transfer_start);
+	}
+	else
+	{
+		stats_add(&loop->stats.failed_transfers[command], 1);
+	}
+	conn->transfer_start = 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_stats
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void send_stats (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Answers an acknowledged STATS request with the server's counters. Only the echo has been
+ * sent on the connection, so the reply fits its send buffer and goes out in one call
+ * without blocking the acceptor; the caller then closes the connection.
+ * -----------------------------------------------------------------------*/
+void send_stats (struct event_loop *loop, struct connection *conn)
+{
+	char	buf[STATS_BUFLEN];
+	int		len, n;
+
+	len = format_stats(buf, sizeof(buf));
+	if ((n = send(conn->fd, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT)) > 0)
+	{
+		stats_add(&loop->stats.bytes_out, n);
+	}
+	if (n != len)
+	{
+		printf("[-]Stats reply cut short.\n");
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       format_stats
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Reports the sends throttled
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int format_stats (char *buf, int buflen)
+ *
+ * RETURNS:        int - length of the text written to buf
+ *
+ * NOTES:
+ * Writes the totals of every event loop's counters, the file cache's hits and misses and
+ * the latency percentiles of each command, one "name value" line each. Latencies are in
+ * microseconds.
+ * -----------------------------------------------------------------------*/
+int format_stats (char *buf, int buflen)
+{
+	static const char		*names[STATS_COMMANDS] = {"get", "send"};
+	struct server_stats		*total;
+	unsigned long long		hits, misses;
+	int						len, i;
+
+	if ((total = malloc(sizeof(struct server_stats))) == NULL)
+	{
+		return snprintf(buf, buflen, "error out_of_memory\n");
+	}
+	stats_collect(total);
+	pthread_mutex_lock(&file_cache.lock);
+	hits = file_cache.hits;
+	misses = file_cache.misses;
+	pthread_mutex_unlock(&file_cache.lock);
+
+	len = snprintf(buf, buflen,
+		"active_sessions %lld\n"
+		"connections_accepted %lld\n"
+		"connections_failed %lld\n"
+		"connect_retries %lld\n"
+		"bytes_in %lld\n"
+		"bytes_out %lld\n"
+		"sends_throttled %lld\n"
+		"cache_hits %llu\n"
+		"cache_misses %llu\n",
+		(long long)total->active_sessions, (long long)total->accepted, (long long)total->failed_connections,
+		(long long)total->connect_retries, (long long)total->bytes_in, (long long)total->bytes_out,
+		(long long)total->throttled, hits, misses);
+	for (i = 0; i < STATS_COMMANDS && len < buflen; i++)
+	{
+		len += snprintf(buf + len, buflen - len,
+			"%s_transfers %lld\n"
+			"%s_failed %lld\n"
+			"%s_latency_us_p50 %llu\n"
+			"%s_latency_us_p99 %llu\n"
+			"%s_latency_us_p999 %llu\n"
+			"%s_latency_us_max %llu\n",
+			names[i], (long long)total->transfers[i],
+			names[i], (long long)total->failed_transfers[i],
+			names[i], (unsigned long long)histogram_percentile(&total->latency[i], 50) / 1000,
+			names[i], (unsigned long long)histogram_percentile(&total->latency[i], 99) / 1000,
+			names[i], (unsigned long long)histogram_percentile(&total->latency[i], 99.9) / 1000,
+			names[i], (unsigned long long)histogram_percentile(&total->latency[i], 100) / 1000);
+	}
+	free(total);
+	return len < buflen ? len : buflen - 1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       trace_phase
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void trace_phase (struct event_loop *loop, struct connection *conn, const char *name)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Ends the session's current span, recording it under name unless name is NULL, and starts
+ * the next one. Does nothing unless the server is tracing.
+ * -----------------------------------------------------------------------*/
+void trace_phase (struct event_loop *loop, struct connection *conn, const char *name)
+{
+	long long now;
+
+	if (loop->trace == NULL)
+	{
+		return;
+	}
+	now = now_ns();
+	if (name != NULL)
+	{
+		trace_span(loop->trace, name, conn->session, conn->trace_mark, now);
+	}
+	conn->trace_mark = now;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       run_shards
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int run_shards (int *control_channel_socket, int *data_channel_socket, struct sockaddr_in *server)
+ *
+ * RETURNS:        int - the shard's number, in a shard; the supervisor never returns
+ *
+ * NOTES:
+ * Binds the control and data sockets of every shard, in shard order, so shard i is
+ * member i of both ports' SO_REUSEPORT groups, then forks the shards. The supervisor keeps
+ * all the sockets open, which keeps every shard's place in the groups while it restarts
+ * one that exited. SIGTERM or SIGINT stops the shards and then the supervisor.
+ * -----------------------------------------------------------------------*/
+int run_shards (int *control_channel_socket, int *data_channel_socket, struct sockaddr_in *server)
+{
+	struct sigaction	action;
+	long long			*started;
+	pid_t				*pids, pid;
+	int					*sockets, i, status, shard = -1;
+
+	sockets = malloc(shard_count * 2 * sizeof(int));
+	pids = malloc(shard_count * sizeof(pid_t));
+	started = malloc(shard_count * sizeof(long long));
+	if (sockets == NULL || pids == NULL || started == NULL)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+	for (i = 0; i < shard_count; i++)
+	{
+		init_server_control_channel(&sockets[i * 2], server, sizeof(*server));
+		init_server_data_channel(&sockets[i * 2 + 1], server, sizeof(*server));
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop_shards;
+	sigaction(SIGTERM, &action, NULL);
+	sigaction(SIGINT, &action, NULL);
+	printf("[+]Starting %d shards.\n", shard_count);
+	for (i = 0; i < shard_count && shard == -1; i++)
+	{
+		started[i] = now_ms();
+		if ((pids[i] = start_shard(i, sockets)) == 0)
+		{
+			shard = i;
+		}
+	}
+
+	// Supervise: restart any shard that exits, but not more than once a SHARD_RESTART_DELAY_MS
+	while (shard == -1 && !shards_stopping)
+	{
+		if ((pid = waitpid(-1, &status, 0)) == -1)
+		{
+			if (errno != EINTR)
+			{
+				perror("[-]Can't wait for shards");
+				break;
+			}
+			continue;
+		}
+		for (i = 0; i < shard_count && pids[i] != pid; i++)
+		{
+		}
+		if (i == shard_count || shards_stopping)
+		{
+			continue;
+		}
+		if (WIFSIGNALED(status))
+		{
+			printf("[-]Shard %d (pid %d) killed by signal %d; restarting it.\n", i, (int)pid, WTERMSIG(status));
+		}
+		else
+		{
+			printf("[-]Shard %d (pid %d) exited with status %d; restarting it.\n", i, (int)pid, WEXITSTATUS(status));
+		}
+		if (now_ms() - started[i] < SHARD_RESTART_DELAY_MS)
+		{
+			usleep((SHARD_RESTART_DELAY_MS - (now_ms() - started[i])) * 1000);
+		}
+		started[i] = now_ms();
+		if ((pids[i] = start_shard(i, sockets)) == 0)
+		{
+			shard = i;
+		}
+	}
+
+	if (shard != -1)
+	{
+		*control_channel_socket = sockets[shard * 2];
+		*data_channel_socket = sockets[shard * 2 + 1];
+		free(sockets);
+		free(pids);
+		free(started);
+		return shard;
+	}
+
+	printf("[+]Stopping the shards.\n");
+	for (i = 0; i < shard_count; i++)
+	{
+		kill(pids[i], SIGTERM);
+	}
+	while (wait(NULL) != -1 || errno == EINTR)
+	{
+	}
+	exit(0);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       start_shard
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      pid_t start_shard (int shard, const int *sockets)
+ *
+ * RETURNS:        pid_t - the shard's pid in the supervisor, 0 in the shard
+ *
+ * NOTES:
+ * Forks a shard, which keeps only its own two sockets and dies with the supervisor. The
+ * supervisor can't run without its shards, so a failed fork ends it.
+ * -----------------------------------------------------------------------*/
+pid_t start_shard (int shard, const int *sockets)
+{
+	pid_t	pid, supervisor = getpid();
+	int		i;
+
+	// Output still buffered would be written again by the shard
+	fflush(stdout);
+	if ((pid = fork()) == -1)
+	{
+		perror("[-]Can't start shard");
+		exit(1);
+	}
+	if (pid != 0)
+	{
+		return pid;
+	}
+
+	signal(SIGTERM, SIG_DFL);
+	signal(SIGINT, SIG_DFL);
+	prctl(PR_SET_PDEATHSIG, SIGTERM);
+	if (getppid() != supervisor)
+	{
+		exit(1);
+	}
+	for (i = 0; i < shard_count * 2; i++)
+	{
+		if (i / 2 != shard)
+		{
+			close(sockets[i]);
+		}
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       stop_shards
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void stop_shards (int signo)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Signal handler of the supervisor; it stops the shards once waitpid returns
+ * -----------------------------------------------------------------------*/
+void stop_shards (int signo)
+{
+	shards_stopping = 1;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       steer_connections
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void steer_connections (int listen_socket)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Attaches a classic BPF program to the socket's SO_REUSEPORT group that picks the member
+ * for a new connection from its client's IPv4 address, modulo the shard count. Without
+ * it the kernel hashes the whole 4-tuple and a SEND's data connection may land on a shard
+ * that never saw its request. If the kernel refuses the program, SENDs may fail to pair
+ * but everything else still works, so that is only reported.
+ * -----------------------------------------------------------------------*/
+void steer_connections (int listen_socket)
+{
+	struct sock_filter code[] =
+	{
+		{ BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_NET_OFF + 12 },	// IPv4 source address
+		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)shard_count },
+		{ BPF_RET | BPF_A, 0, 0, 0 }
+	};
+	struct sock_fprog program = { sizeof(code) / sizeof(code[0]), code };
+
+	if (setsockopt(listen_socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) == -1)
+	{
+		perror("[-]Can't steer connections to shards");
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       open_temp_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int open_temp_file (struct connection *conn)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Creates the hidden file a SEND builds its new file in, beside the one the request names,
+ * so that finish_upload can rename it over that one
+ * -----------------------------------------------------------------------*/
+int open_temp_file (struct connection *conn)
+{
+	// No request can name a file starting with '.', nor the index list one
+	snprintf(conn->temp_name, sizeof(conn->temp_name), ".%s.XXXXXX", request_file_name(&conn->req));
+	if ((conn->file_fd = mkstemp(conn->temp_name)) == -1)
+	{
+		conn->temp_name[0] = '\0';
+		return -1;
+	}
+	fchmod(conn->file_fd, 0644);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       flush_upload
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int flush_upload (struct connection *conn)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Writes the data collected in the session's buffer, which ends at file_offset. A partial
+ * block can't be written with O_DIRECT, so the rest of the file goes through the page cache.
+ * -----------------------------------------------------------------------*/
+int flush_upload (struct connection *conn)
+{
+	if (conn->buffer_len == 0)
+	{
+		return 0;
+	}
+	if (conn->direct && conn->buffer_len % DIRECT_IO_ALIGN != 0 && stop_direct_io(conn) == -1)
+	{
+		return -1;
+	}
+	if (write_all(conn->file_fd, conn->buffer, conn->buffer_len, conn->file_offset - conn->buffer_len) == -1)
+	{
+		return -1;
+	}
+	conn->buffer_len = 0;
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       stop_direct_io
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int stop_direct_io (struct connection *conn)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Takes O_DIRECT off a SEND's file, before a write that isn't made of whole blocks
+ * -----------------------------------------------------------------------*/
+int stop_direct_io (struct connection *conn)
+{
+	int flags;
+
+	if ((flags = fcntl(conn->file_fd, F_GETFL)) == -1 || fcntl(conn->file_fd, F_SETFL, flags & ~O_DIRECT) == -1)
+	{
+		return -1;
+	}
+	conn->direct = FALSE;
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       alloc_buffer
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      char *alloc_buffer (size_t len)
+ *
+ * RETURNS:        char * - the buffer, to be freed with free; NULL if out of memory
+ *
+ * NOTES:
+ * Allocates a transfer buffer aligned for O_DIRECT. Any session buffer may end up holding
+ * an upload (compressed GETs swap theirs), so all of them are allocated this way.
+ * -----------------------------------------------------------------------*/
+char *alloc_buffer (size_t len)
+{
+	void *buffer;
+
+	return posix_memalign(&buffer, DIRECT_IO_ALIGN, len) == 0 ? buffer : NULL;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       open_data_port
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void open_data_port (struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Opens a listener of its own for a GET or SEND whose request asks for one with port=0 and
+ * writes its port into the request, which is echoed next. Ports come from the -p pool in
+ * turn, or are ephemeral. Without a free port the request is echoed unchanged, and the
+ * client falls back to the fixed ports.
+ * -----------------------------------------------------------------------*/
+void open_data_port (struct connection *conn)
+{
+	struct sockaddr_in	addr;
+	socklen_t			addr_len = sizeof(addr);
+	struct request		req;
+	int					fd, option = 1, ports, i;
+
+	if (parse_request(conn->request, &req) == -1 || req.port != 0 ||
+		(strcmp(req.command, GET_COMMAND_NAME) != 0 && strcmp(req.command, SEND_COMMAND_NAME) != 0))
+	{
+		return;
+	}
+	if ((fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1)
+	{
+		perror("[-]Can't create a socket");
+		return;
+	}
+
+	// Pool ports are reused as soon as their last transfer is done
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option));
+	bzero((char *)&addr, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	ports = data_port_first > 0 ? data_port_last - data_port_first + 1 : 1;
+	for (i = 0; i < ports; i++)
+	{
+		addr.sin_port = htons(data_port_first > 0 ? data_port_first + data_port_next : 0);
+		data_port_next = (data_port_next + 1) % ports;
+		if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+		{
+			break;
+		}
+	}
+	if (i == ports || listen(fd, 1) == -1 || getsockname(fd, (struct sockaddr *)&addr, &addr_len) == -1)
+	{
+		perror("[-]Can't open a data port");
+		close(fd);
+		return;
+	}
+
+	conn->port_fd = fd;
+	req.port = ntohs(addr.sin_port);
+	bzero(conn->request, REQ_BUFLEN);
+	format_request(conn->request, REQ_BUFLEN, &req);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       accept_data_port
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Keeps the session and retries later when out of descriptors
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void accept_data_port (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Accepts the client's connection to its session's own data port, closes the port and hands
+ * the session to a worker. Connections from other addresses are dropped.
+ * -----------------------------------------------------------------------*/
+void accept_data_port (struct event_loop *loop, struct connection *conn)
+{
+	struct sockaddr_in	client;
+	socklen_t			client_len;
+	int					client_socket;
+
+	while (TRUE)
+	{
+		client_len = sizeof(client);
+		if ((client_socket = accept4(conn->fd, (struct sockaddr *)&client, &client_len, SOCK_NONBLOCK)) == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EMFILE || errno == ENFILE)
+			{
+				perror("[-]Can't accept client connection");
+				pause_accepts(loop, conn);
+			}
+			else if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				perror("[-]Can't accept client connection");
+				stats_add(&loop->stats.failed_connections, 1);
+				close_connection(loop, conn);
+			}
+			return;
+		}
+		stats_add(&loop->stats.accepted, 1);
+		if (client.sin_addr.s_addr == conn->peer.sin_addr.s_addr)
+		{
+			break;
+		}
+		printf("[-]Unexpected data connection from %s\n", inet_ntoa(client.sin_addr));
+		stats_add(&loop->stats.failed_connections, 1);
+		close(client_socket);
+	}
+
+	printf("[+]Client connected successfully.\n");
+	printf("[+]Client Address:  %s\n", inet_ntoa(client.sin_addr));
+
+	disarm_timer(loop, conn);
+	close(conn->fd);
+	conn->fd = client_socket;
+	trace_phase(loop, conn, "data connection");
+	dispatch_session(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       init_server_local_channel
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Binds the configured path in a private directory, only replacing a dead socket
+ *                 October 16th, 2026 - Copies the path whole; its length was checked with -l
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void init_server_local_channel (int *local_channel_socket)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Creates the Unix domain socket local clients connect to at local_path and listens on it.
+ * The socket goes only in a directory other users can't write to (local_channel_dir_private),
+ * and one already there is only replaced if no server answers on it. Local transfers only
+ * save the clients some copies, so a server that can't have the socket runs without it and
+ * sets local_channel_socket to -1.
+ * -----------------------------------------------------------------------*/
+void init_server_local_channel (int *local_channel_socket)
+{
+	struct sockaddr_un server;
+
+	*local_channel_socket = -1;
+	if (local_path[0] == '\0' || local_channel_dir_private(local_path) == FALSE)
+	{
+		return;
+	}
+	if (local_channel_in_use(local_path) == TRUE)
+	{
+		fprintf(stderr, "[-]%s is in use; running without the local socket.\n", local_path);
+		return;
+	}
+	if ((*local_channel_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0)) == -1)
+	{
+		perror("[-]Can't create local socket");
+		return;
+	}
+	bzero((char *)&server, sizeof(server));
+	server.sun_family = AF_UNIX;
+	memcpy(server.sun_path, local_path, strlen(local_path) + 1);
+
+	// Only this user's clients (and root's) are served, so nobody else needs to connect
+	if (bind(*local_channel_socket, (struct sockaddr *)&server, sizeof(server)) == -1 ||
+		chmod(local_path, 0600) == -1 || listen(*local_channel_socket, listen_backlog) == -1)
+	{
+		perror("[-]Can't listen on local socket");
+		close(*local_channel_socket);
+		*local_channel_socket = -1;
+		return;
+	}
+	printf("[+]Server local socket listening at %s.\n", local_path);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       accept_local_connection
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Turns away clients running as another user
+ *                 October 16th, 2026 - Retries later when out of descriptors
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void accept_local_connection (struct event_loop *loop, struct connection *listener)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Accepts local clients and waits for their requests. A client not running as this user or
+ * root is closed before anything is read from it, so the server never takes its descriptors.
+ * With -b uring too the local socket is watched through epoll, since its requests need recvmsg.
+ * -----------------------------------------------------------------------*/
+void accept_local_connection (struct event_loop *loop, struct connection *listener)
+{
+	struct connection	*conn;
+	int					client_socket;
+
+	while (TRUE)
+	{
+		if ((client_socket = accept4(listener->fd, NULL, NULL, SOCK_NONBLOCK)) == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				if (errno == EMFILE || errno == ENFILE)
+				{
+					pause_accepts(loop, listener);
+				}
+				perror("[-]Can't accept local client");
+				stats_add(&loop->stats.failed_connections, 1);
+			}
+			return;
+		}
+		if (!local_peer_trusted(client_socket))
+		{
+			fprintf(stderr, "[-]Local client runs as another user; closed.\n");
+			stats_add(&loop->stats.failed_connections, 1);
+			close(client_socket);
+			continue;
+		}
+		printf("[+]Local client connected successfully.\n");
+
+		conn = new_connection(client_socket, LOCAL_CONNECTION, READING_REQUEST);
+		conn->session = atomic_fetch_add_explicit(&session_count, 1, memory_order_relaxed) + 1;
+		trace_phase(loop, conn, NULL);
+		stats_add(&loop->stats.accepted, 1);
+		stats_add(&loop->stats.active_sessions, 1);
+		watch_connection(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       receive_local_request
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void receive_local_request (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Reads a local client's request, along with the file a SEND passes, and hands the session
+ * to a worker. Only whole-file GETs and SENDs are taken.
+ * -----------------------------------------------------------------------*/
+void receive_local_request (struct event_loop *loop, struct connection *conn)
+{
+	char			control[CMSG_SPACE(sizeof(int))];
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct cmsghdr	*cmsg;
+	int				n, fd;
+
+	while (conn->request_len < REQ_BUFLEN)
+	{
+		bzero((char *)&msg, sizeof(msg));
+		iov.iov_base = conn->request + conn->request_len;
+		iov.iov_len = REQ_BUFLEN - conn->request_len;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		n = recvmsg(conn->fd, &msg, MSG_CMSG_CLOEXEC);
+		if (n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return;
+		}
+		if (n <= 0)
+		{
+			printf("[-]Local client closed its connection before sending a request.\n");
+			close_connection(loop, conn);
+			return;
+		}
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			{
+				memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+				if (conn->local_fd != -1)
+				{
+					close(conn->local_fd);
+				}
+				conn->local_fd = fd;
+			}
+		}
+		conn->request_len += n;
+		stats_add(&loop->stats.bytes_in, n);
+	}
+
+	trace_phase(loop, conn, "request");
+	conn->request[REQ_BUFLEN - 1] = '\0';
+	printf("Local Request:%s\n", conn->request);
+	if (parse_request(conn->request, &conn->req) == -1 || conn->req.offset >= 0 || conn->req.length >= 0 ||
+		(strcmp(conn->req.command, GET_COMMAND_NAME) != 0 &&
+		 (strcmp(conn->req.command, SEND_COMMAND_NAME) != 0 || conn->local_fd == -1)))
+	{
+		printf("[-]Can't serve local request: %s\n", conn->request);
+		close_connection(loop, conn);
+		return;
+	}
+	unwatch_connection(loop, conn);
+	dispatch_session(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       process_local_request
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Hands a SEND to copy_local_file instead of copying it all at once
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void process_local_request (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Answers a local GET with its file, opened read-only, and ends the session, or starts
+ * copying the file a local SEND passed into place (see copy_local_file). Only regular
+ * files are copied.
+ * -----------------------------------------------------------------------*/
+void process_local_request (struct event_loop *loop, struct connection *conn)
+{
+	struct stat st;
+
+	if (strcmp(conn->req.command, GET_COMMAND_NAME) == 0)
+	{
+		// A cached copy can't be passed; the client gets the file
+		if (open_request_file(conn) == -1 ||
+			(conn->file_fd == -1 && (conn->file_fd = open(request_file_name(&conn->req), O_RDONLY)) == -1))
+		{
+			perror("[-]Error in reading file.");
+			close_connection(loop, conn);
+			return;
+		}
+		conn->req.offset = -1;
+		conn->req.length = -1;
+		if (send_local_reply(conn, conn->file_fd) == -1)
+		{
+			perror("[-]Can't pass file to local client");
+			close_connection(loop, conn);
+			return;
+		}
+		printf("[+]Passed %s to local client.\n", request_file_name(&conn->req));
+	}
+	else
+	{
+		printf("[+]Server will now copy %s from local client\n", request_file_name(&conn->req));
+		if (fstat(conn->local_fd, &st) == -1 || !S_ISREG(st.st_mode))
+		{
+			printf("[-]Local client didn't pass a regular file.\n");
+			close_connection(loop, conn);
+			return;
+		}
+		conn->req.size = st.st_size;
+		if (open_request_file(conn) == -1 || (conn->direct && stop_direct_io(conn) == -1) ||
+			(conn->buffer == NULL && (conn->buffer = alloc_buffer(TRANSFER_BUFLEN)) == NULL))
+		{
+			perror("[-]Error in storing file.");
+			close_connection(loop, conn);
+			return;
+		}
+		conn->state = RECEIVING_FILE;
+		conn->file_left = st.st_size;
+		copy_local_file(loop, conn);
+		return;
+	}
+	stats_add(&loop->stats.bytes_out, REQ_BUFLEN);
+	end_transfer(loop, conn, TRUE);
+	close_connection(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_local_reply
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int send_local_reply (struct connection *conn, int fd)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Answers a local request with the session's parsed request in REQ_BUFLEN bytes, passing fd
+ * with it unless it is -1. The connection has carried nothing else, so its send buffer
+ * takes the whole reply at once.
+ * -----------------------------------------------------------------------*/
+int send_local_reply (struct connection *conn, int fd)
+{
+	char			control[CMSG_SPACE(sizeof(int))];
+	char			reply[REQ_BUFLEN];
+	struct msghdr	msg;
+	struct iovec	iov;
+	struct cmsghdr	*cmsg;
+	int				n;
+
+	bzero(reply, REQ_BUFLEN);
+	format_request(reply, REQ_BUFLEN, &conn->req);
+	bzero((char *)&msg, sizeof(msg));
+	iov.iov_base = reply;
+	iov.iov_len = REQ_BUFLEN;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (fd != -1)
+	{
+		bzero(control, sizeof(control));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+	}
+	while ((n = sendmsg(conn->fd, &msg, MSG_NOSIGNAL)) == -1 && errno == EINTR)
+	{
+	}
+	if (n != REQ_BUFLEN)
+	{
+		errno = n == -1 ? errno : EAGAIN;
+		return -1;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       splice_to_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      ssize_t splice_to_file (struct connection *conn)
+ *
+ * RETURNS:        ssize_t - bytes received, 0 at the end of the data, -1 on error (errno is set;
+ *                           EAGAIN when the socket has nothing yet)
+ *
+ * NOTES:
+ * Splices what the socket has, up to a buffer's worth, into the session's pipe and from there
+ * into the file. If the file can't be spliced to, zero_copy is cleared and what is in the
+ * pipe goes to the session's buffer instead, to be written with the rest.
+ * -----------------------------------------------------------------------*/
+ssize_t splice_to_file (struct connection *conn)
+{
+	ssize_t n, m, left;
+
+	if ((n = splice(conn->fd, NULL, conn->pipe_fds[1], NULL, TRANSFER_BUFLEN, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) <= 0)
+	{
+		return n;
+	}
+	for (left = n; left > 0 && conn->zero_copy; left -= m)
+	{
+		m = splice(conn->pipe_fds[0], NULL, conn->file_fd, &conn->file_offset, left, SPLICE_F_MOVE);
+		if (m == -1 && errno == EINTR)
+		{
+			m = 0;
+		}
+		else if (m == -1 && errno == EINVAL)
+		{
+			conn->zero_copy = FALSE;
+			m = 0;
+		}
+		else if (m <= 0)
+		{
+			errno = m == 0 ? EIO : errno;
+			return -1;
+		}
+	}
+	while (left > 0)
+	{
+		if ((m = read(conn->pipe_fds[0], conn->buffer + conn->buffer_len, left)) == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if (m <= 0)
+		{
+			errno = m == 0 ? EIO : errno;
+			return -1;
+		}
+		conn->buffer_len += m;
+		conn->file_offset += m;
+		left -= m;
+	}
+	return n;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       send_allowance
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      long long send_allowance (struct event_loop *loop, struct connection *conn, long long want)
+ *
+ * RETURNS:        long long - bytes the session may send now, at most want; 0 if none
+ *
+ * NOTES:
+ * Starts a turn for a session that hasn't one, joining its client's share on its first.
+ * The quantum is divided among the client's running transfers, so every client gets the
+ * same turn however many it opens. A session whose quantum is used up goes to the back of
+ * the ready queue, and one its buckets can't pay for waits on its timer; both get 0 and
+ * must stop sending until the scheduler resumes them.
+ * -----------------------------------------------------------------------*/
+long long send_allowance (struct event_loop *loop, struct connection *conn, long long want)
+{
+	long long	allowed;
+	int			transfers, wait_ms;
+
+	if (conn->turn == TURN_READY || conn->turn == TURN_THROTTLED)
+	{
+		return 0;
+	}
+	if (conn->turn == TURN_NONE)
+	{
+		if (conn->share == NULL)
+		{
+			conn->share = bandwidth_join(&bandwidth, conn->peer.sin_addr);
+		}
+		transfers = conn->share != NULL && conn->share->transfers > 1 ? conn->share->transfers : 1;
+		conn->turn_left = SCHED_QUANTUM / transfers > SCHED_MIN_QUANTUM ? SCHED_QUANTUM / transfers : SCHED_MIN_QUANTUM;
+		conn->turn = TURN_RUNNING;
+	}
+	if (conn->turn_left <= 0)
+	{
+		queue_ready(loop, conn);
+		return 0;
+	}
+	want = want < conn->turn_left ? want : conn->turn_left;
+	if ((allowed = bandwidth_allowance(&bandwidth, conn->share, want, &wait_ms)) == 0)
+	{
+		conn->turn = TURN_THROTTLED;
+		arm_timer(loop, conn, now_ms() + wait_ms);
+		stats_add(&loop->stats.throttled, 1);
+	}
+	return allowed;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       charge_send
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void charge_send (struct connection *conn, long long bytes)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Takes bytes just sent out of the session's quantum and its buckets
+ * -----------------------------------------------------------------------*/
+void charge_send (struct connection *conn, long long bytes)
+{
+	conn->turn_left -= bytes;
+	bandwidth_charge(&bandwidth, conn->share, bytes);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       end_sending
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void end_sending (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Ends a session's turns once its file is sent, or it closes: it leaves the ready queue
+ * or its throttle timer, and its client's share
+ * -----------------------------------------------------------------------*/
+void end_sending (struct event_loop *loop, struct connection *conn)
+{
+	if (conn->turn == TURN_READY)
+	{
+		dequeue_ready(loop, conn);
+	}
+	else if (conn->turn == TURN_THROTTLED)
+	{
+		disarm_timer(loop, conn);
+	}
+	conn->turn = TURN_NONE;
+	if (conn->share != NULL)
+	{
+		bandwidth_leave(&bandwidth, conn->share);
+		conn->share = NULL;
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       queue_ready
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void queue_ready (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Puts a session whose quantum is used up at the back of the loop's ready queue
+ * -----------------------------------------------------------------------*/
+void queue_ready (struct event_loop *loop, struct connection *conn)
+{
+	conn->turn = TURN_READY;
+	conn->ready_next = NULL;
+	conn->ready_prev = loop->ready_tail;
+	if (loop->ready_tail != NULL)
+	{
+		loop->ready_tail->ready_next = conn;
+	}
+	else
+	{
+		loop->ready_head = conn;
+	}
+	loop->ready_tail = conn;
+	loop->ready_count++;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       dequeue_ready
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void dequeue_ready (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Takes a session off the ready queue, wherever it is; its turn is over
+ * -----------------------------------------------------------------------*/
+void dequeue_ready (struct event_loop *loop, struct connection *conn)
+{
+	if (conn->ready_prev != NULL)
+	{
+		conn->ready_prev->ready_next = conn->ready_next;
+	}
+	else
+	{
+		loop->ready_head = conn->ready_next;
+	}
+	if (conn->ready_next != NULL)
+	{
+		conn->ready_next->ready_prev = conn->ready_prev;
+	}
+	else
+	{
+		loop->ready_tail = conn->ready_prev;
+	}
+	loop->ready_count--;
+	conn->turn = TURN_NONE;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       run_ready
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void run_ready (struct event_loop *loop)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Gives each session on the ready queue its next turn, in the order they were queued.
+ * Sessions queued again meanwhile wait for the next round, after the loop has polled.
+ * -----------------------------------------------------------------------*/
+void run_ready (struct event_loop *loop)
+{
+	struct connection	*conn;
+	int					turns = loop->ready_count;
+
+	while (turns-- > 0 && (conn = loop->ready_head) != NULL)
+	{
+		dequeue_ready(loop, conn);
+		resume_sending(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       resume_sending
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Resumes local copies
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void resume_sending (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Goes on sending a session's file, or copying a local SEND's. The socket was writable
+ * when it stopped, so no readiness event will come for it.
+ * -----------------------------------------------------------------------*/
+void resume_sending (struct event_loop *loop, struct connection *conn)
+{
+	if (conn->kind == MUX_CONNECTION)
+	{
+		handle_mux_connection(loop, conn);
+	}
+	else if (conn->kind == LOCAL_CONNECTION)
+	{
+		copy_local_file(loop, conn);
+	}
+	else
+	{
+		send_file(loop, conn);
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       unlink_pending_send
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void unlink_pending_send (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Takes a SEND session closing before its data connection arrived off the loop's pending
+ * list, so no later connection from its client is paired with it
+ * -----------------------------------------------------------------------*/
+void unlink_pending_send (struct event_loop *loop, struct connection *conn)
+{
+	struct connection **link;
+
+	for (link = &loop->pending_sends; *link != NULL; link = &(*link)->next)
+	{
+		if (*link == conn)
+		{
+			*link = conn->next;
+			conn->next = NULL;
+			return;
+		}
+	}
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       copy_local_file
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void copy_local_file (struct event_loop *loop, struct connection *conn)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Copies the next LOCAL_COPY_CHUNK bytes of the file a local SEND passed, then goes to the
+ * back of the ready queue, so a huge file doesn't hold up the loop's other sessions. After
+ * the last chunk the file is stored and the client is answered with its size.
+ * -----------------------------------------------------------------------*/
+void copy_local_file (struct event_loop *loop, struct connection *conn)
+{
+	off_t len = conn->file_left < LOCAL_COPY_CHUNK ? conn->file_left : LOCAL_COPY_CHUNK;
+
+	if (copy_file_data(conn, conn->local_fd, conn->req.size - conn->file_left, len) == -1 ||
+		((conn->file_left -= len) == 0 && finish_upload(conn) == -1))
+	{
+		perror("[-]Error in storing file.");
+		close_connection(loop, conn);
+		return;
+	}
+	if (conn->file_left > 0)
+	{
+		queue_ready(loop, conn);
+		return;
+	}
+	if (send_local_reply(conn, -1) == -1)
+	{
+		perror("[-]Can't acknowledge local request");
+		close_connection(loop, conn);
+		return;
+	}
+	printf("[+]Data written locally in the file, %s, successfully.\n", request_file_name(&conn->req));
+	stats_add(&loop->stats.bytes_out, REQ_BUFLEN);
+	end_transfer(loop, conn, TRUE);
+	close_connection(loop, conn);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       local_channel_dir_private
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int local_channel_dir_private (const char *path)
+ *
+ * RETURNS:        int - TRUE if the socket may be made at path, FALSE if not
+ *
+ * NOTES:
+ * Makes the socket's directory, mode 0700, if it doesn't exist, then checks that it is a real
+ * directory owned by this user or root that nobody else can write to, unless it is sticky
+ * like /tmp. Anyone who could would be able to put their own socket in the server's place.
+ * path fits in local_path, as checked where that was set.
+ * -----------------------------------------------------------------------*/
+int local_channel_dir_private (const char *path)
+{
+	char		dir[sizeof(local_path)];
+	char		*slash;
+	struct stat	st;
+
+	memcpy(dir, path, strlen(path) + 1);
+	if ((slash = strrchr(dir, '/')) == NULL)
+	{
+		strcpy(dir, ".");
+	}
+	else
+	{
+		*(slash == dir ? slash + 1 : slash) = '\0';
+	}
+	if (mkdir(dir, 0700) == -1 && errno != EEXIST)
+	{
+		perror("[-]Can't make local socket directory");
+		return FALSE;
+	}
+	if (lstat(dir, &st) == -1)
+	{
+		perror("[-]Can't check local socket directory");
+		return FALSE;
+	}
+	if (!S_ISDIR(st.st_mode) || (st.st_uid != geteuid() && st.st_uid != 0) ||
+		((st.st_mode & (S_IWGRP | S_IWOTH)) != 0 && (st.st_mode & S_ISVTX) == 0))
+	{
+		fprintf(stderr, "[-]Other users can write to %s; running without the local socket.\n", dir);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       local_channel_in_use
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int local_channel_in_use (const char *path)
+ *
+ * RETURNS:        int - TRUE if something else holds path, FALSE once it is free
+ *
+ * NOTES:
+ * Connects to a socket already at path. A refused connection means its server is gone, and
+ * the socket is removed; one that is accepted belongs to a live server, which keeps it. Anything
+ * at path that isn't a socket is never removed. path fits in local_path.
+ * -----------------------------------------------------------------------*/
+int local_channel_in_use (const char *path)
+{
+	struct sockaddr_un	server;
+	struct stat			st;
+	int					probe, in_use;
+
+	if (lstat(path, &st) == -1)
+	{
+		return errno == ENOENT ? FALSE : TRUE;
+	}
+	if (!S_ISSOCK(st.st_mode) || (probe = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+	{
+		return TRUE;
+	}
+	bzero((char *)&server, sizeof(server));
+	server.sun_family = AF_UNIX;
+	memcpy(server.sun_path, path, strlen(path) + 1);
+	in_use = connect(probe, (struct sockaddr *)&server, sizeof(server)) == 0 || errno != ECONNREFUSED;
+	close(probe);
+	if (in_use)
+	{
+		return TRUE;
+	}
+	printf("[+]Removing stale local socket %s.\n", path);
+	return unlink(path) == -1 ? TRUE : FALSE;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       pause_accepts
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void pause_accepts (struct event_loop *loop, struct connection *listener)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Called when an accept failed for want of a descriptor. The connections still queued on the
+ * listener won't raise another edge, so its timer retries the accept in ACCEPT_RETRY_MS,
+ * unless it is already due sooner (a retry already pending, or a data port's deadline).
+ * -----------------------------------------------------------------------*/
+void pause_accepts (struct event_loop *loop, struct connection *listener)
+{
+	long long at = now_ms() + ACCEPT_RETRY_MS;
+
+	if (listener->timer_armed && listener->timer_at <= at)
+	{
+		return;
+	}
+	arm_timer(loop, listener, at);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       retry_accept
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void retry_accept (struct event_loop *loop, struct connection *listener)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Accepts again on a listener paused by pause_accepts, through the ring if it takes the
+ * listener's accepts
+ * -----------------------------------------------------------------------*/
+void retry_accept (struct event_loop *loop, struct connection *listener)
+{
+	if (loop->ring != NULL && listener->kind != LOCAL_LISTENER)
+	{
+		ring_accept(loop, listener);
+	}
+	else if (listener->kind == CONTROL_LISTENER)
+	{
+		accept_client_connection(loop, listener);
+	}
+	else if (listener->kind == DATA_LISTENER)
+	{
+		accept_data_connection(loop, listener);
+	}
+	else if (listener->kind == LOCAL_LISTENER)
+	{
+		accept_local_connection(loop, listener);
+	}
 }
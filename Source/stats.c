@@ -0,0 +1,127 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	stats.c - Server counters reported by the STATS command
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		stats_register (struct server_stats *stats);
+--					stats_add (_Atomic long long *counter, long long n);
+--					stats_collect (struct server_stats *total);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- How the counters are kept is described in stats.h
+---------------------------------------------------------------------------------------*/
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "stats.h"
+
+// Counter sets of every event loop
+pthread_mutex_t		stats_lock = PTHREAD_MUTEX_INITIALIZER;
+struct server_stats	*stats_list = NULL;
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       stats_register
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void stats_register (struct server_stats *stats)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Clears a counter set and adds it to the ones stats_collect reads; it must stay allocated
+ * for the life of the program
+ * -----------------------------------------------------------------------*/
+void stats_register (struct server_stats *stats)
+{
+	memset(stats, 0, sizeof(struct server_stats));
+	pthread_mutex_lock(&stats_lock);
+	stats->next = stats_list;
+	stats_list = stats;
+	pthread_mutex_unlock(&stats_lock);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       stats_add
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void stats_add (_Atomic long long *counter, long long n)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Adds n to a counter of the calling thread's own set. Nothing else writes to it, so the
+ * read and the write don't need to be one atomic step.
+ * -----------------------------------------------------------------------*/
+void stats_add (_Atomic long long *counter, long long n)
+{
+	atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       stats_collect
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      October 16th, 2026 - Adds up the throttled sends
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void stats_collect (struct server_stats *total)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Adds up every registered counter set into total. The sets keep changing meanwhile, so
+ * the totals are a near, not an exact, snapshot.
+ * -----------------------------------------------------------------------*/
+void stats_collect (struct server_stats *total)
+{
+	struct server_stats	*stats;
+	int					i;
+
+	memset(total, 0, sizeof(struct server_stats));
+	pthread_mutex_lock(&stats_lock);
+	for (stats = stats_list; stats != NULL; stats = stats->next)
+	{
+		total->active_sessions += atomic_load_explicit(&stats->active_sessions, memory_order_relaxed);
+		total->accepted += atomic_load_explicit(&stats->accepted, memory_order_relaxed);
+		total->failed_connections += atomic_load_explicit(&stats->failed_connections, memory_order_relaxed);
+		total->connect_retries += atomic_load_explicit(&stats->connect_retries, memory_order_relaxed);
+		total->bytes_in += atomic_load_explicit(&stats->bytes_in, memory_order_relaxed);
+		total->bytes_out += atomic_load_explicit(&stats->bytes_out, memory_order_relaxed);
+		total->throttled += atomic_load_explicit(&stats->throttled, memory_order_relaxed);
+		for (i = 0; i < STATS_COMMANDS; i++)
+		{
+			total->transfers[i] += atomic_load_explicit(&stats->transfers[i], memory_order_relaxed);
+			total->failed_transfers[i] += atomic_load_explicit(&stats->failed_transfers[i], memory_order_relaxed);
+			histogram_add(&total->latency[i], &stats->latency[i]);
+		}
+	}
+	pthread_mutex_unlock(&stats_lock);
+}
@@ -0,0 +1,54 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	stats.h - Server counters reported by the STATS command
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		stats_register (struct server_stats *stats);
+--					stats_add (_Atomic long long *counter, long long n);
+--					stats_collect (struct server_stats *total);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- Every event loop keeps its own set of counters and only its own thread updates them, so
+-- counting is a plain load and store with no locked instructions or shared cache lines.
+-- The counters are still atomic so that stats_collect can read them from another thread
+-- at any time; it adds up the sets of all registered loops.
+---------------------------------------------------------------------------------------*/
+#ifndef STATS_H
+#define STATS_H
+
+#include "histogram.h"
+
+// Transfers are counted per command
+#define STATS_GET			0
+#define STATS_SEND			1
+#define STATS_COMMANDS		2
+
+struct server_stats
+{
+	_Atomic long long	active_sessions;				// Gauge; a loop's count may go negative
+	_Atomic long long	accepted;						// Control and data connections accepted
+	_Atomic long long	failed_connections;				// Failed accepts, stray data connections, abandoned connect-backs
+	_Atomic long long	connect_retries;				// GET connect-backs retried
+	_Atomic long long	bytes_in;
+	_Atomic long long	bytes_out;
+	_Atomic long long	throttled;						// Sends held back for bandwidth tokens
+	_Atomic long long	transfers[STATS_COMMANDS];		// Completed transfers
+	_Atomic long long	failed_transfers[STATS_COMMANDS];
+	struct histogram	latency[STATS_COMMANDS];		// Nanoseconds from request to completion
+	struct server_stats	*next;
+};
+
+void stats_register (struct server_stats *stats);
+void stats_add (_Atomic long long *counter, long long n);
+void stats_collect (struct server_stats *total);
+
+#endif
@@ -0,0 +1,248 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	trace.c - Span tracing of server sessions
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		trace_open (const char *path);
+--					trace_ring_new (void);
+--					trace_span (struct trace_ring *ring, const char *name, unsigned long long session, long long start, long long end);
+--					trace_main (void *arg);
+--					drain_ring (struct trace_ring *ring);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The trace file is a JSON array of complete ("X") events with microsecond timestamps
+-- counted from trace_open. The array is never closed, since the server only stops when
+-- it is killed; the trace event format allows the closing bracket to be left out.
+---------------------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "trace.h"
+#include "connect_retry.h"
+
+#define TRUE					1
+#define FALSE					0
+
+void *trace_main (void *arg);
+void drain_ring (struct trace_ring *ring);
+
+// Rings of every event loop, and the file the trace thread writes them to
+pthread_mutex_t		trace_lock = PTHREAD_MUTEX_INITIALIZER;
+struct trace_ring	*trace_rings = NULL;
+FILE				*trace_file = NULL;
+long long			trace_epoch;
+int					trace_events = 0;
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       trace_open
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int trace_open (const char *path)
+ *
+ * RETURNS:        int - 0 on success, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Creates the trace file and starts the thread that writes it. Must be called before the
+ * event loops ask for their rings.
+ * -----------------------------------------------------------------------*/
+int trace_open (const char *path)
+{
+	pthread_t thread;
+
+	if ((trace_file = fopen(path, "w")) == NULL)
+	{
+		return -1;
+	}
+	fputs("[", trace_file);
+	trace_epoch = now_ns();
+	if ((errno = pthread_create(&thread, NULL, trace_main, NULL)) != 0)
+	{
+		fclose(trace_file);
+		trace_file = NULL;
+		return -1;
+	}
+	pthread_detach(thread);
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       trace_ring_new
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      struct trace_ring *trace_ring_new (void)
+ *
+ * RETURNS:        struct trace_ring * - a ring the trace thread drains, NULL if tracing is off
+ *
+ * NOTES:
+ * Gives an event loop its ring; only the loop's own thread may record spans in it
+ * -----------------------------------------------------------------------*/
+struct trace_ring *trace_ring_new (void)
+{
+	struct trace_ring *ring;
+
+	if (trace_file == NULL)
+	{
+		return NULL;
+	}
+	if ((ring = calloc(1, sizeof(struct trace_ring))) == NULL)
+	{
+		perror("[-]Out of memory");
+		exit(1);
+	}
+	pthread_mutex_lock(&trace_lock);
+	ring->next = trace_rings;
+	trace_rings = ring;
+	pthread_mutex_unlock(&trace_lock);
+	return ring;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       trace_span
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void trace_span (struct trace_ring *ring, const char *name, unsigned long long session,
+ *                                  long long start, long long end)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Records a span of a session in a loop's ring; a NULL ring records nothing
+ * -----------------------------------------------------------------------*/
+void trace_span (struct trace_ring *ring, const char *name, unsigned long long session, long long start, long long end)
+{
+	struct trace_event	*event;
+	size_t				head, tail;
+
+	if (ring == NULL)
+	{
+		return;
+	}
+	tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	if (tail - head == TRACE_RING_LEN)
+	{
+		atomic_store_explicit(&ring->dropped, atomic_load_explicit(&ring->dropped, memory_order_relaxed) + 1,
+			memory_order_relaxed);
+		return;
+	}
+	event = &ring->slots[tail & (TRACE_RING_LEN - 1)];
+	event->name = name;
+	event->session = session;
+	event->start = start;
+	event->end = end;
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       trace_main
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void *trace_main (void *arg)
+ *
+ * RETURNS:        void *
+ *
+ * NOTES:
+ * Trace thread entrypoint; empties every ring into the trace file, flushing it each round,
+ * and reports spans that were dropped since the last round
+ * -----------------------------------------------------------------------*/
+void *trace_main (void *arg)
+{
+	struct trace_ring	*ring;
+	long long			dropped, reported = 0;
+
+	while (TRUE)
+	{
+		usleep(TRACE_FLUSH_MS * 1000);
+		dropped = 0;
+		pthread_mutex_lock(&trace_lock);
+		for (ring = trace_rings; ring != NULL; ring = ring->next)
+		{
+			drain_ring(ring);
+			dropped += atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+		}
+		pthread_mutex_unlock(&trace_lock);
+		fflush(trace_file);
+		if (dropped > reported)
+		{
+			printf("[-]Trace ring full; %lld spans dropped so far.\n", dropped);
+			reported = dropped;
+		}
+	}
+	return NULL;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       drain_ring
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void drain_ring (struct trace_ring *ring)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Writes every span queued in a ring to the trace file as a complete event
+ * -----------------------------------------------------------------------*/
+void drain_ring (struct trace_ring *ring)
+{
+	struct trace_event	*event;
+	size_t				head, tail;
+
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	while (head != tail)
+	{
+		event = &ring->slots[head & (TRACE_RING_LEN - 1)];
+		fprintf(trace_file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f}",
+			trace_events++ == 0 ? "" : ",", event->name, event->session,
+			(event->start - trace_epoch) / 1e3, (event->end - event->start) / 1e3);
+		atomic_store_explicit(&ring->head, ++head, memory_order_release);
+	}
+}
@@ -0,0 +1,61 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	trace.h - Span tracing of server sessions
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		trace_open (const char *path);
+--					trace_ring_new (void);
+--					trace_span (struct trace_ring *ring, const char *name, unsigned long long session, long long start, long long end);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- A span is a named stretch of a session's life between two now_ns() timestamps. Every
+-- event loop records its spans in a ring of its own, which only that loop's thread fills
+-- and only the trace thread empties, so recording takes no locks. The trace thread
+-- drains the rings every TRACE_FLUSH_MS into a file in the Chrome trace event format,
+-- which chrome://tracing and Perfetto open directly: each session is a thread of its
+-- own, its spans laid out on one row. Spans that find their ring full are dropped and
+-- counted.
+--
+-- Without trace_open there are no rings; trace_ring_new returns NULL and the server
+-- skips every span.
+---------------------------------------------------------------------------------------*/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+
+#define TRACE_RING_LEN		4096	// Must be a power of two
+#define TRACE_FLUSH_MS		100
+
+struct trace_event
+{
+	const char			*name;			// Must be a string constant
+	unsigned long long	session;
+	long long			start;
+	long long			end;
+};
+
+// Single-producer, single-consumer ring of spans recorded by one event loop
+struct trace_ring
+{
+	struct trace_event	slots[TRACE_RING_LEN];
+	_Atomic size_t		head;			// Next slot the trace thread takes
+	_Atomic size_t		tail;			// Next slot the loop fills
+	_Atomic long long	dropped;
+	struct trace_ring	*next;
+};
+
+int trace_open (const char *path);
+struct trace_ring *trace_ring_new (void);
+void trace_span (struct trace_ring *ring, const char *name, unsigned long long session, long long start, long long end);
+
+#endif
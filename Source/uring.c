@@ -0,0 +1,339 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	uring.c - Minimal io_uring submission/completion rings
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		uring_init (struct uring *ring, unsigned entries);
+--					uring_get_sqe (struct uring *ring);
+--					uring_prep (struct io_uring_sqe *sqe, int opcode, int fd, const void *addr, unsigned len, off_t offset, void *user_data);
+--					uring_submit (struct uring *ring);
+--					uring_wait (struct uring *ring, int timeout_ms);
+--					uring_peek_cqe (struct uring *ring);
+--					uring_cqe_seen (struct uring *ring);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- The rings are memory shared with the kernel. The side that produces entries publishes
+-- its tail with a release store and the side that consumes them reads it with an acquire
+-- load, so an entry is always complete before the other side can see it.
+---------------------------------------------------------------------------------------*/
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       uring_init
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int uring_init (struct uring *ring, unsigned entries)
+ *
+ * RETURNS:        int - 0 on success, -1 if the kernel can't provide a ring (errno is set)
+ *
+ * NOTES:
+ * Creates an io_uring instance with room for entries queued requests and maps its rings.
+ * Kernels without timed waits (IORING_FEAT_EXT_ARG, 5.11) are refused with ENOSYS.
+ * -----------------------------------------------------------------------*/
+int uring_init (struct uring *ring, unsigned entries)
+{
+	struct io_uring_params	params;
+	char					*sq_ring, *cq_ring;
+	size_t					sq_size, cq_size, sqes_size;
+	unsigned				*sq_array, i;
+
+	bzero((char *)ring, sizeof(struct uring));
+	bzero((char *)&params, sizeof(params));
+	params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+	if ((ring->fd = syscall(__NR_io_uring_setup, entries, &params)) == -1 && errno == EINVAL)
+	{
+		// Kernels before 5.19 don't know these flags
+		bzero((char *)&params, sizeof(params));
+		ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+	}
+	if (ring->fd == -1)
+	{
+		return -1;
+	}
+	if (!(params.features & IORING_FEAT_EXT_ARG))
+	{
+		close(ring->fd);
+		errno = ENOSYS;
+		return -1;
+	}
+
+	sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		sq_size = cq_size = sq_size > cq_size ? sq_size : cq_size;
+	}
+
+	sq_ring = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (sq_ring == MAP_FAILED)
+	{
+		close(ring->fd);
+		return -1;
+	}
+	cq_ring = sq_ring;
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+	{
+		cq_ring = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (cq_ring == MAP_FAILED)
+		{
+			munmap(sq_ring, sq_size);
+			close(ring->fd);
+			return -1;
+		}
+	}
+	ring->sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+	{
+		if (cq_ring != sq_ring)
+		{
+			munmap(cq_ring, cq_size);
+		}
+		munmap(sq_ring, sq_size);
+		close(ring->fd);
+		return -1;
+	}
+
+	ring->sq_head = (unsigned *)(sq_ring + params.sq_off.head);
+	ring->sq_tail = (unsigned *)(sq_ring + params.sq_off.tail);
+	ring->sq_mask = *(unsigned *)(sq_ring + params.sq_off.ring_mask);
+	ring->sq_entries = params.sq_entries;
+	ring->sqe_tail = *ring->sq_tail;
+	ring->cq_head = (unsigned *)(cq_ring + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq_ring + params.cq_off.tail);
+	ring->cq_mask = *(unsigned *)(cq_ring + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+
+	// Submission slot i always holds request entry i
+	sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+	for (i = 0; i < params.sq_entries; i++)
+	{
+		sq_array[i] = i;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       uring_get_sqe
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      struct io_uring_sqe *uring_get_sqe (struct uring *ring)
+ *
+ * RETURNS:        struct io_uring_sqe * - a cleared request entry, NULL if none can be freed up
+ *
+ * NOTES:
+ * Takes the next free request entry. When the queue is full the queued requests are
+ * submitted first to make room.
+ * -----------------------------------------------------------------------*/
+struct io_uring_sqe *uring_get_sqe (struct uring *ring)
+{
+	struct io_uring_sqe *sqe;
+
+	if (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_entries)
+	{
+		if (uring_submit(ring) == -1 || ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_entries)
+		{
+			return NULL;
+		}
+	}
+	sqe = &ring->sqes[ring->sqe_tail & ring->sq_mask];
+	ring->sqe_tail++;
+	bzero((char *)sqe, sizeof(struct io_uring_sqe));
+	return sqe;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       uring_prep
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void uring_prep (struct io_uring_sqe *sqe, int opcode, int fd, const void *addr,
+ *                                  unsigned len, off_t offset, void *user_data)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Fills in the fields every request uses; user_data comes back in the request's completion.
+ * Operation specific flags are set on the entry by the caller afterwards.
+ * -----------------------------------------------------------------------*/
+void uring_prep (struct io_uring_sqe *sqe, int opcode, int fd, const void *addr, unsigned len, off_t offset, void *user_data)
+{
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)addr;
+	sqe->len = len;
+	sqe->off = (uint64_t)offset;
+	sqe->user_data = (uint64_t)(uintptr_t)user_data;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       uring_submit
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int uring_submit (struct uring *ring)
+ *
+ * RETURNS:        int - requests submitted, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Hands every queued request to the kernel without waiting for any of them
+ * -----------------------------------------------------------------------*/
+int uring_submit (struct uring *ring)
+{
+	unsigned	pending;
+	int			n;
+
+	__atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+	pending = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	if (pending == 0)
+	{
+		return 0;
+	}
+	while ((n = syscall(__NR_io_uring_enter, ring->fd, pending, 0, 0, NULL, 0)) == -1 && errno == EINTR)
+	{
+	}
+	return n;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       uring_wait
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      int uring_wait (struct uring *ring, int timeout_ms)
+ *
+ * RETURNS:        int - 0 once completions are ready or the wait timed out, -1 on error (errno is set)
+ *
+ * NOTES:
+ * Submits every queued request and, unless completions are already waiting, sleeps until
+ * one arrives or timeout_ms passes (-1 waits indefinitely). Both happen in one system call.
+ * -----------------------------------------------------------------------*/
+int uring_wait (struct uring *ring, int timeout_ms)
+{
+	struct io_uring_getevents_arg	arg;
+	struct __kernel_timespec		ts;
+	unsigned						pending, wait;
+
+	__atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+	pending = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	wait = *ring->cq_head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	if (pending == 0 && !wait)
+	{
+		return 0;
+	}
+
+	bzero((char *)&arg, sizeof(arg));
+	if (timeout_ms >= 0)
+	{
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+		arg.ts = (uint64_t)(uintptr_t)&ts;
+	}
+	if (syscall(__NR_io_uring_enter, ring->fd, pending, wait, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) == -1 &&
+		errno != ETIME && errno != EINTR)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       uring_peek_cqe
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      struct io_uring_cqe *uring_peek_cqe (struct uring *ring)
+ *
+ * RETURNS:        struct io_uring_cqe * - the oldest unconsumed completion, NULL if there is none
+ *
+ * NOTES:
+ * The completion stays valid until uring_cqe_seen is called
+ * -----------------------------------------------------------------------*/
+struct io_uring_cqe *uring_peek_cqe (struct uring *ring)
+{
+	unsigned head = *ring->cq_head;
+
+	if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+	{
+		return NULL;
+	}
+	return &ring->cqes[head & ring->cq_mask];
+}
+
+/*--------------------------------------------------------------------------
+ * FUNCTION:       uring_cqe_seen
+ *
+ * DATE:           October 16th, 2026
+ *
+ * REVISIONS:      N/A
+ *
+ * DESIGNER:       Derek Wong
+ *
+ * PROGRAMMER:     Derek Wong
+ *
+ * INTERFACE:      void uring_cqe_seen (struct uring *ring)
+ *
+ * RETURNS:        void
+ *
+ * NOTES:
+ * Releases the completion returned by uring_peek_cqe back to the kernel
+ * -----------------------------------------------------------------------*/
+void uring_cqe_seen (struct uring *ring)
+{
+	__atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
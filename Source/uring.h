@@ -0,0 +1,62 @@
+/*---------------------------------------------------------------------------------------
+--	SOURCE FILE:	uring.h - Minimal io_uring submission/completion rings
+--
+--	PROGRAM:		tserver
+--
+--	FUNCTIONS:		uring_init (struct uring *ring, unsigned entries);
+--					uring_get_sqe (struct uring *ring);
+--					uring_prep (struct io_uring_sqe *sqe, int opcode, int fd, const void *addr, unsigned len, off_t offset, void *user_data);
+--					uring_submit (struct uring *ring);
+--					uring_wait (struct uring *ring, int timeout_ms);
+--					uring_peek_cqe (struct uring *ring);
+--					uring_cqe_seen (struct uring *ring);
+--
+--	DATE:			October 16, 2026
+--
+--	REVISIONS:		N/A
+--
+--
+--	DESIGNERS:		Derek Wong
+--
+--	PROGRAMMERS:	Derek Wong
+--
+--	NOTES:
+-- Talks to the kernel through the raw io_uring system calls, so the server needs no
+-- library beyond the kernel headers. Requests are queued with uring_get_sqe/uring_prep
+-- and only handed to the kernel by uring_wait, which submits everything queued and waits
+-- for completions in the same system call.
+---------------------------------------------------------------------------------------*/
+#ifndef URING_H
+#define URING_H
+
+#include <sys/types.h>
+#include <linux/io_uring.h>
+
+struct uring
+{
+	int						fd;
+
+	// Submission queue, shared with the kernel
+	unsigned				*sq_head;
+	unsigned				*sq_tail;
+	unsigned				sq_mask;
+	unsigned				sq_entries;
+	struct io_uring_sqe		*sqes;
+	unsigned				sqe_tail;		// Requests queued so far, submitted or not
+
+	// Completion queue, shared with the kernel
+	unsigned				*cq_head;
+	unsigned				*cq_tail;
+	unsigned				cq_mask;
+	struct io_uring_cqe		*cqes;
+};
+
+int uring_init (struct uring *ring, unsigned entries);
+struct io_uring_sqe *uring_get_sqe (struct uring *ring);
+void uring_prep (struct io_uring_sqe *sqe, int opcode, int fd, const void *addr, unsigned len, off_t offset, void *user_data);
+int uring_submit (struct uring *ring);
+int uring_wait (struct uring *ring, int timeout_ms);
+struct io_uring_cqe *uring_peek_cqe (struct uring *ring);
+void uring_cqe_seen (struct uring *ring);
+
+#endif